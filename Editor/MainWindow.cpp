@@ -662,8 +662,10 @@ amuse::ObjToken<amuse::Voice> MainWindow::startSFX(amuse::GroupId groupId, amuse
   if (ProjectModel::INode* node = getEditorNode()) {
     amuse::AudioGroupDatabase* group = projectModel()->getGroupNode(node)->getAudioGroup();
     auto ret = m_engine->fxStart(group, groupId, sfxId, 1.f, 0.f);
-    ret->setReverbVol(m_auxAVol);
-    ret->setAuxBVol(m_auxBVol);
+    if (ret) {
+      ret->setReverbVol(m_auxAVol);
+      ret->setAuxBVol(m_auxBVol);
+    }
     return ret;
   }
   return {};
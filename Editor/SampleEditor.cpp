@@ -1,6 +1,7 @@
 #include "SampleEditor.hpp"
 
 #include <cfloat>
+#include <cstring>
 
 #include <QCheckBox>
 #include <QPaintEvent>
@@ -13,6 +14,102 @@
 
 #include <amuse/DSPCodec.hpp>
 
+SamplePeaks::SamplePeaks(const amuse::SampleEntryData& entry, const unsigned char* data, QWidget* notify)
+: m_entry(&entry), m_source(data), m_sourceModTime(entry.m_looseModTime) {
+  const uint32_t numSamples = entry.getNumSamples();
+  const bool dsp = entry.isFormatDSP();
+  size_t dataLen = 0;
+  if (data && dsp)
+    dataLen = (numSamples + 13) / 14 * 8;
+  else if (data && entry.getSampleFormat() == amuse::SampleFormat::PCM_PC)
+    dataLen = numSamples * 2;
+  if (dsp)
+    std::memcpy(m_coefs, entry.m_ADPCMParms.dsp.m_coefs, sizeof(m_coefs));
+
+  /* Loose data is replaced on reload, so the worker decodes a private copy */
+  std::vector<unsigned char> copy(data, data + dataLen);
+  m_thread = std::thread(&SamplePeaks::_build, this, std::move(copy), dsp, numSamples, notify);
+}
+
+SamplePeaks::~SamplePeaks() {
+  m_cancel.store(true, std::memory_order_relaxed);
+  m_thread.join();
+}
+
+static void MergeRange(SamplePeaks::Range& out, const SamplePeaks::Range& in) {
+  out.m_sum += in.m_sum;
+  out.m_count += in.m_count;
+  out.m_min = std::min(out.m_min, in.m_min);
+  out.m_max = std::max(out.m_max, in.m_max);
+}
+
+static void MergeSample(SamplePeaks::Range& out, int16_t sample) {
+  out.m_sum += sample;
+  out.m_count += 1;
+  out.m_min = std::min(out.m_min, sample);
+  out.m_max = std::max(out.m_max, sample);
+}
+
+void SamplePeaks::_build(std::vector<unsigned char> data, bool dsp, uint32_t numSamples, QWidget* notify) {
+  if (dsp && !data.empty()) {
+    m_pcm.resize(numSamples);
+    int16_t prev1 = 0;
+    int16_t prev2 = 0;
+    for (uint32_t b = 0; b < (numSamples + 13) / 14; ++b) {
+      if ((b & 0xfff) == 0 && m_cancel.load(std::memory_order_relaxed))
+        return;
+      DSPDecompressFrame(m_pcm.data() + b * 14, data.data() + 8 * b, m_coefs, &prev1, &prev2,
+                         std::min(14u, numSamples - b * 14));
+    }
+  } else if (!data.empty()) {
+    m_pcm.resize(numSamples);
+    std::memcpy(m_pcm.data(), data.data(), numSamples * 2);
+  }
+
+  /* Each level halves the previous; the last bin of a level may be partial */
+  size_t binCount = (m_pcm.size() + BinSamples - 1) / BinSamples;
+  if (binCount) {
+    std::vector<Range>& base = m_levels.emplace_back(binCount);
+    for (size_t s = 0; s < m_pcm.size(); ++s)
+      MergeSample(base[s / BinSamples], m_pcm[s]);
+  }
+  while (binCount > 1) {
+    if (m_cancel.load(std::memory_order_relaxed))
+      return;
+    binCount = (binCount + 1) / 2;
+    std::vector<Range> level(binCount);
+    const std::vector<Range>& prev = m_levels.back();
+    for (size_t b = 0; b < prev.size(); ++b)
+      MergeRange(level[b / 2], prev[b]);
+    m_levels.push_back(std::move(level));
+  }
+
+  m_ready.store(true, std::memory_order_release);
+  QMetaObject::invokeMethod(notify, [notify]() { notify->update(); }, Qt::QueuedConnection);
+}
+
+SamplePeaks::Range SamplePeaks::query(uint32_t begin, uint32_t end) const {
+  Range ret;
+  end = std::min(end, uint32_t(m_pcm.size()));
+  while (begin < end) {
+    /* Take the largest aligned bin that fits; unaligned edges fall back to single samples */
+    size_t level = m_levels.size();
+    uint32_t span = 0;
+    for (; level > 0; --level) {
+      span = BinSamples << (level - 1);
+      if (begin % span == 0 && end - begin >= span)
+        break;
+    }
+    if (level == 0) {
+      MergeSample(ret, m_pcm[begin++]);
+      continue;
+    }
+    MergeRange(ret, m_levels[level - 1][begin / span]);
+    begin += span;
+  }
+  return ret;
+}
+
 SampleEditor* SampleView::getEditor() const {
   return qobject_cast<SampleEditor*>(parentWidget()->parentWidget()->parentWidget());
 }
@@ -20,10 +117,12 @@ SampleEditor* SampleView::getEditor() const {
 void SampleView::seekToSample(qreal sample) {
   sample = std::min(sample, qreal(m_sample->getNumSamples()));
 
-  if (m_sample->isFormatDSP()) {
+  if (m_sample->isFormatDSP() && !peaksReady()) {
     if (sample < m_curSamplePos) {
-      m_prev1 = m_prev2 = 0;
-      m_curSamplePos = 0.0;
+      /* Restart from the nearest seek point rather than block 0 */
+      const uint32_t block = uint32_t(sample) / 14;
+      m_sample->seekDSP(block, m_prev1, m_prev2, [this](uint32_t b) { return m_sampleData + 8 * b; });
+      m_curSamplePos = block * 14;
     }
 
     uint32_t startBlock = uint32_t(m_curSamplePos) / 14;
@@ -70,7 +169,15 @@ std::pair<std::pair<qreal, qreal>, std::pair<qreal, qreal>> SampleView::iterateS
     ret.second.second = std::max(ret.second.second, sampleF);
   };
 
-  if (m_sample->isFormatDSP()) {
+  if (peaksReady()) {
+    const SamplePeaks::Range range = m_peaks->query(uint32_t(m_curSamplePos), uint32_t(endSample));
+    if (range.m_count) {
+      avg = range.m_sum / 32768.0;
+      div = range.m_count;
+      ret.first.second = std::min(ret.first.second, range.m_min / 32768.0);
+      ret.second.second = std::max(ret.second.second, range.m_max / 32768.0);
+    }
+  } else if (m_sample->isFormatDSP()) {
     uint32_t startBlock = uint32_t(m_curSamplePos) / 14;
     uint32_t startRem = uint32_t(m_curSamplePos) % 14;
     uint32_t endBlock = uint32_t(endSample) / 14;
@@ -339,6 +446,13 @@ bool SampleView::loadData(ProjectModel::SampleNode* node) {
 
   ProjectModel::GroupNode* group = g_MainWindow->projectModel()->getGroupNode(m_node.get());
   std::tie(m_sample, m_sampleData) = group->getAudioGroup()->getSampleData(m_node->id(), m_node->m_obj.get());
+  if (!m_peaks || !m_peaks->matches(*m_sample, m_sampleData)) {
+    if (m_sample->needsDSPSeekTable())
+      m_sample->buildDSPSeekTable([this](uint32_t b) { return m_sampleData + 8 * b; });
+    m_peaks = std::make_unique<SamplePeaks>(*m_sample, m_sampleData, this);
+    m_prev1 = m_prev2 = 0;
+    m_curSamplePos = 0.0;
+  }
   if (reset)
     resetZoom();
 
@@ -361,6 +475,7 @@ bool SampleView::loadData(ProjectModel::SampleNode* node) {
 void SampleView::unloadData() {
   m_node.reset();
   m_sample.reset();
+  m_peaks.reset();
   m_playbackMacro.reset();
   update();
 }
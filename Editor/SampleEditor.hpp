@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <ctime>
+#include <memory>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <QFont>
 #include <QWidget>
@@ -20,6 +25,48 @@ class QPushButton;
 class QScrollArea;
 class QSlider;
 
+/** Min/max/sum summaries of a decoded sample at power-of-two bin sizes.
+ *  Built on a worker thread so waveform painting costs O(pixels) at any zoom. */
+class SamplePeaks {
+public:
+  struct Range {
+    int64_t m_sum = 0;
+    uint32_t m_count = 0;
+    int16_t m_min = INT16_MAX;
+    int16_t m_max = INT16_MIN;
+  };
+
+private:
+  static constexpr uint32_t BinSamples = 16;
+  const amuse::SampleEntryData* m_entry;
+  const unsigned char* m_source;
+  time_t m_sourceModTime;
+  int16_t m_coefs[8][2] = {};
+  std::vector<int16_t> m_pcm;
+  std::vector<std::vector<Range>> m_levels; /**< Bins of level n span BinSamples << n samples */
+  std::atomic_bool m_ready = false;
+  std::atomic_bool m_cancel = false;
+  std::thread m_thread;
+
+  void _build(std::vector<unsigned char> data, bool dsp, uint32_t numSamples, QWidget* notify);
+
+public:
+  /** Starts building from a copy of `data`; `notify` is repainted once the pyramid is ready */
+  SamplePeaks(const amuse::SampleEntryData& entry, const unsigned char* data, QWidget* notify);
+  ~SamplePeaks();
+  SamplePeaks(const SamplePeaks&) = delete;
+  SamplePeaks& operator=(const SamplePeaks&) = delete;
+
+  /** False once the entry's data has been reloaded from a newer loose file */
+  bool matches(const amuse::SampleEntryData& entry, const unsigned char* data) const {
+    return m_entry == &entry && m_source == data && m_sourceModTime == entry.m_looseModTime;
+  }
+  bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+
+  /** Summarize samples [begin, end); only valid once isReady() */
+  Range query(uint32_t begin, uint32_t end) const;
+};
+
 class SampleView : public QWidget {
   Q_OBJECT
   friend class SampleControls;
@@ -30,6 +77,7 @@ class SampleView : public QWidget {
   amuse::ObjToken<amuse::SampleEntryData> m_sample;
   amuse::ObjToken<amuse::SoundMacro> m_playbackMacro;
   const unsigned char* m_sampleData = nullptr;
+  std::unique_ptr<SamplePeaks> m_peaks;
   qreal m_curSamplePos = 0.0;
   int16_t m_prev1 = 0;
   int16_t m_prev2 = 0;
@@ -40,6 +88,7 @@ class SampleView : public QWidget {
   void seekToSample(qreal sample);
   std::pair<std::pair<qreal, qreal>, std::pair<qreal, qreal>> iterateSampleInterval(qreal interval);
   void calculateSamplesPerPx();
+  bool peaksReady() const { return m_peaks && m_peaks->isReady(); }
   SampleEditor* getEditor() const;
 
 public:
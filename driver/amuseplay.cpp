@@ -794,7 +794,7 @@ struct AppCallback : boo::IApplicationCallback {
       /* Build voice engine */
       std::unique_ptr<boo::IAudioVoiceEngine> voxEngine = boo::NewAudioVoiceEngine();
       m_booBackend.reset(new amuse::BooBackendVoiceAllocator(*voxEngine));
-      m_engine.reset(new amuse::Engine(*m_booBackend, amuse::AmplitudeMode::PerSample));
+      m_engine.reset(new amuse::Engine(*m_booBackend, amuse::AmplitudeMode::PerSample, amuse::EffectMode::Planar));
 
       /* Load group into engine */
       const amuse::AudioGroup* group = m_engine->addAudioGroup(*selData);
@@ -8,6 +8,7 @@
 #include <cstdio>
 #include <cstring>
 #include <signal.h>
+#include <atomic>
 #include <thread>
 #include <map>
 #include <set>
@@ -65,9 +66,182 @@ static void abortHandler(int signum) {
 #endif
 
 /* SIGINT will gracefully break write loop */
-static bool g_BreakLoop = false;
+static std::atomic_bool g_BreakLoop = false;
 static void SIGINTHandler(int sig) { g_BreakLoop = true; }
 
+/* Minimal 16-bit PCM RIFF writer used with the native offline mixer */
+class WAVFileWriter {
+  FILE* m_fp = nullptr;
+  uint32_t m_dataBytes = 0;
+
+  void _writeU32(uint32_t val) {
+    val = amuse::SLittle(val);
+    fwrite(&val, 4, 1, m_fp);
+  }
+  void _writeU16(uint16_t val) {
+    val = amuse::SLittle(val);
+    fwrite(&val, 2, 1, m_fp);
+  }
+
+public:
+  WAVFileWriter(const amuse::SystemChar* path, uint32_t sampleRate, uint16_t channelCount) {
+    m_fp = amuse::FOpen(path, _SYS_STR("wb"));
+    if (!m_fp)
+      return;
+    fwrite("RIFF", 1, 4, m_fp);
+    _writeU32(0);
+    fwrite("WAVEfmt ", 1, 8, m_fp);
+    _writeU32(16);
+    _writeU16(1);
+    _writeU16(channelCount);
+    _writeU32(sampleRate);
+    _writeU32(sampleRate * channelCount * 2);
+    _writeU16(channelCount * 2);
+    _writeU16(16);
+    fwrite("data", 1, 4, m_fp);
+    _writeU32(0);
+  }
+  ~WAVFileWriter() {
+    if (!m_fp)
+      return;
+    amuse::FSeek(m_fp, 4, SEEK_SET);
+    _writeU32(36 + m_dataBytes);
+    amuse::FSeek(m_fp, 40, SEEK_SET);
+    _writeU32(m_dataBytes);
+    fclose(m_fp);
+  }
+  explicit operator bool() const { return m_fp != nullptr; }
+  void write(const int16_t* samples, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      const int16_t samp = amuse::SLittle(samples[i]);
+      fwrite(&samp, 2, 1, m_fp);
+    }
+    m_dataBytes += count * 2;
+  }
+};
+
+using GroupDataPair = std::pair<amuse::SystemString, amuse::IntrusiveAudioGroupData>;
+using SongGroupMap = std::map<amuse::GroupId, std::pair<GroupDataPair*, amuse::ObjToken<amuse::SongGroupIndex>>>;
+using SFXGroupMap = std::map<amuse::GroupId, std::pair<GroupDataPair*, amuse::ObjToken<amuse::SFXGroupIndex>>>;
+
+/* Songs without an explicit group are matched to the first SongGroup declaring their setup */
+static int ResolveSongGroupId(const amuse::ContainerRegistry::SongData& sngData, const SongGroupMap& allSongGroups) {
+  int grpId = sngData.m_groupId;
+  if (grpId == -1 && sngData.m_setupId != -1) {
+    for (const auto& pair : allSongGroups) {
+      for (const auto& setup : pair.second.second->m_midiSetups) {
+        if (setup.first == sngData.m_setupId) {
+          grpId = pair.first.id;
+          break;
+        }
+      }
+      if (grpId != -1)
+        break;
+    }
+  }
+  return grpId;
+}
+
+static amuse::AudioChannelSet ChannelSetForCount(int chCount) {
+  switch (chCount) {
+  case 4:
+    return amuse::AudioChannelSet::Quad;
+  case 6:
+    return amuse::AudioChannelSet::Surround51;
+  case 8:
+    return amuse::AudioChannelSet::Surround71;
+  default:
+    return amuse::AudioChannelSet::Stereo;
+  }
+}
+
+/* One song of a batch render, resolved up-front on the main thread */
+struct RenderJob {
+  const amuse::IntrusiveAudioGroupData* m_groupData;
+  const amuse::ContainerRegistry::SongData* m_song;
+  int m_groupId;
+  int m_setupId;
+  amuse::SystemString m_pathOut;
+};
+
+struct BatchRenderSettings {
+  double m_rate;
+  int m_chCount;
+  double m_volume;
+};
+
+/* Renders one song through the native offline mixer; returns written frame count */
+static std::optional<size_t> RenderSongOffline(const RenderJob& job, const BatchRenderSettings& settings,
+                                               amuse::OfflineEffectWorkers* effectWorkers) {
+  amuse::OfflineBackendVoiceAllocator backend(settings.m_rate, ChannelSetForCount(settings.m_chCount), effectWorkers);
+  const size_t chanCount = backend.getChannelMap().m_channelCount;
+  WAVFileWriter wavWriter(job.m_pathOut.c_str(), uint32_t(settings.m_rate), uint16_t(chanCount));
+  if (!wavWriter) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open {} for writing")), job.m_pathOut);
+    return std::nullopt;
+  }
+
+  /* Each song gets a fresh engine so effect tails never bleed between renders */
+  amuse::Engine engine(backend, amuse::AmplitudeMode::PerSample);
+  engine.setVolume(float(std::clamp(0.0, settings.m_volume, 1.0)));
+  const amuse::AudioGroup* group = engine.addAudioGroup(*job.m_groupData);
+  if (!group) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to add audio group for {}")), job.m_pathOut);
+    return std::nullopt;
+  }
+
+  amuse::ObjToken<amuse::Sequencer> seq =
+      engine.seqPlay(group, job.m_groupId, job.m_setupId, job.m_song->m_data.get(), false);
+  if (!seq) {
+    Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to start sequencer for {}")), job.m_pathOut);
+    return std::nullopt;
+  }
+
+  const size_t frames = backend.get5MsFrames();
+  std::vector<int16_t> pcmBuf(frames * chanCount);
+  size_t wroteFrames = 0;
+  do {
+    backend.pumpAndMixVoices(frames, pcmBuf.data());
+    wavWriter.write(pcmBuf.data(), pcmBuf.size());
+    wroteFrames += frames;
+  } while (!g_BreakLoop && (seq->state() == amuse::SequencerState::Playing || seq->getVoiceCount() != 0));
+
+  return wroteFrames;
+}
+
+/* Renders every job across a pool of worker threads; returns number of failed songs */
+static size_t RenderBatch(const std::vector<RenderJob>& jobs, const BatchRenderSettings& settings,
+                          unsigned threadCount) {
+  std::atomic_size_t nextJob = 0;
+  std::atomic_size_t failCount = 0;
+  threadCount = std::max(1u, std::min(threadCount, unsigned(jobs.size())));
+
+  /* Songs already occupy every worker; a lone worker shares one effect pool across all of its songs
+   * rather than starting and joining threads for each backend */
+  std::unique_ptr<amuse::OfflineEffectWorkers> effectPool;
+  if (threadCount == 1)
+    effectPool = amuse::OfflineEffectWorkers::Create(amuse::OfflineBackendVoiceAllocator::DefaultEffectWorkers);
+  amuse::OfflineEffectWorkers* const effectWorkers = effectPool.get();
+  auto worker = [&]() {
+    for (size_t i = nextJob++; i < jobs.size() && !g_BreakLoop; i = nextJob++) {
+      const RenderJob& job = jobs[i];
+      if (std::optional<size_t> frames = RenderSongOffline(job, settings, effectWorkers))
+        Log.report(logvisor::Info, FMT_STRING(_SYS_STR("Wrote {} ({} frames)")), job.m_pathOut, *frames);
+      else
+        ++failCount;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threadCount);
+  for (unsigned i = 0; i < threadCount; ++i)
+    workers.emplace_back(worker);
+  for (std::thread& thr : workers)
+    thr.join();
+
+  return failCount;
+}
+
 #if _WIN32
 int wmain(int argc, const boo::SystemChar** argv)
 #else
@@ -81,6 +255,9 @@ int main(int argc, const boo::SystemChar** argv)
   double rate = NativeSampleRate;
   int chCount = 2;
   double volume = 1.0;
+  bool native = false;
+  bool batch = false;
+  unsigned threadCount = std::thread::hardware_concurrency();
   for (int i = 1; i < argc; ++i) {
 #if _WIN32
     if (!wcsncmp(argv[i], L"-r", 2)) {
@@ -104,6 +281,17 @@ int main(int argc, const boo::SystemChar** argv)
         volume = wcstod(argv[i + 1], nullptr);
         ++i;
       }
+    } else if (!wcsncmp(argv[i], L"-j", 2)) {
+      if (argv[i][2])
+        threadCount = wcstoul(&argv[i][2], nullptr, 0);
+      else if (argc > (i + 1)) {
+        threadCount = wcstoul(argv[i + 1], nullptr, 0);
+        ++i;
+      }
+    } else if (!wcscmp(argv[i], L"-n")) {
+      native = true;
+    } else if (!wcscmp(argv[i], L"-b")) {
+      batch = true;
     } else
       m_args.push_back(argv[i]);
 #else
@@ -128,6 +316,17 @@ int main(int argc, const boo::SystemChar** argv)
         volume = strtod(argv[i + 1], nullptr);
         ++i;
       }
+    } else if (!strncmp(argv[i], "-j", 2)) {
+      if (argv[i][2])
+        threadCount = strtoul(&argv[i][2], nullptr, 0);
+      else if (argc > (i + 1)) {
+        threadCount = strtoul(argv[i + 1], nullptr, 0);
+        ++i;
+      }
+    } else if (!strcmp(argv[i], "-n")) {
+      native = true;
+    } else if (!strcmp(argv[i], "-b")) {
+      batch = true;
     } else
       m_args.push_back(argv[i]);
 #endif
@@ -137,7 +336,7 @@ int main(int argc, const boo::SystemChar** argv)
   if (m_args.size() < 1) {
     Log.report(logvisor::Error,
                FMT_STRING("Usage: amuserender <group-file> [<songs-file>] [-r <sample-rate>] [-c <channel-count>] [-v <volume "
-                   "0.0-1.0>]"));
+                   "0.0-1.0>] [-n (native offline mixer)] [-b (render all songs)] [-j <thread-count>]"));
     return 1;
   }
 
@@ -149,7 +348,7 @@ int main(int argc, const boo::SystemChar** argv)
   Log.report(logvisor::Info, FMT_STRING(_SYS_STR("Found '{}' Audio Group data")), amuse::ContainerRegistry::TypeToName(cType));
 
   std::vector<std::pair<amuse::SystemString, amuse::IntrusiveAudioGroupData>> data =
-      amuse::ContainerRegistry::LoadContainer(m_args[0].c_str());
+      amuse::ContainerRegistry::LoadContainer(m_args[0].c_str(), amuse::ContainerRegistry::LoadMode::MemoryMap);
   if (data.empty()) {
     Log.report(logvisor::Error, FMT_STRING("invalid/no data at path argument"));
     return 1;
@@ -163,12 +362,8 @@ int main(int argc, const boo::SystemChar** argv)
   bool m_sfxGroup = false;
 
   std::list<amuse::AudioGroupProject> m_projs;
-  std::map<amuse::GroupId, std::pair<std::pair<amuse::SystemString, amuse::IntrusiveAudioGroupData>*,
-                           amuse::ObjToken<amuse::SongGroupIndex>>>
-      allSongGroups;
-  std::map<amuse::GroupId, std::pair<std::pair<amuse::SystemString, amuse::IntrusiveAudioGroupData>*,
-                           amuse::ObjToken<amuse::SFXGroupIndex>>>
-      allSFXGroups;
+  SongGroupMap allSongGroups;
+  SFXGroupMap allSFXGroups;
   size_t totalGroups = 0;
 
   for (auto& grp : data) {
@@ -191,6 +386,40 @@ int main(int argc, const boo::SystemChar** argv)
   else
     songs = amuse::ContainerRegistry::LoadSongs(m_args[0].c_str());
 
+  if (batch) {
+    /* Resolve every song up-front; workers only read the shared group data */
+    std::vector<RenderJob> jobs;
+    jobs.reserve(songs.size());
+    for (const auto& pair : songs) {
+      const amuse::ContainerRegistry::SongData& sngData = pair.second;
+      const int grpId = ResolveSongGroupId(sngData, allSongGroups);
+      auto songSearch = allSongGroups.find(grpId);
+      if (songSearch == allSongGroups.end()) {
+        Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("skipping {}: unable to find SongGroup {}")), pair.first,
+                   grpId);
+        continue;
+      }
+      if (songSearch->second.second->m_midiSetups.find(sngData.m_setupId) ==
+          songSearch->second.second->m_midiSetups.cend()) {
+        Log.report(logvisor::Warning, FMT_STRING(_SYS_STR("skipping {}: unable to find setup {}")), pair.first,
+                   sngData.m_setupId);
+        continue;
+      }
+      jobs.push_back({&songSearch->second.first->second, &sngData, grpId, sngData.m_setupId,
+                      fmt::format(FMT_STRING(_SYS_STR("{}-{}.wav")), songSearch->second.first->first, pair.first)});
+    }
+
+    if (jobs.empty()) {
+      Log.report(logvisor::Error, FMT_STRING("no renderable songs found"));
+      return 1;
+    }
+
+    Log.report(logvisor::Info, FMT_STRING("Rendering {} songs"), jobs.size());
+    signal(SIGINT, SIGINTHandler);
+    const size_t failCount = RenderBatch(jobs, {rate, chCount, volume}, threadCount);
+    return failCount ? 1 : 0;
+  }
+
   if (songs.size()) {
     bool play = true;
     if (m_args.size() <= 1) {
@@ -222,20 +451,8 @@ int main(int argc, const boo::SystemChar** argv)
         int idx = 0;
         for (const auto& pair : songs) {
           const amuse::ContainerRegistry::SongData& sngData = pair.second;
-          int16_t grpId = sngData.m_groupId;
-          int16_t setupId = sngData.m_setupId;
-          if (sngData.m_groupId == -1 && sngData.m_setupId != -1) {
-            for (const auto& pair : allSongGroups) {
-              for (const auto& setup : pair.second.second->m_midiSetups) {
-                if (setup.first == sngData.m_setupId) {
-                  grpId = pair.first.id;
-                  break;
-                }
-              }
-              if (grpId != -1)
-                break;
-            }
-          }
+          const int grpId = ResolveSongGroupId(sngData, allSongGroups);
+          const int16_t setupId = sngData.m_setupId;
           fmt::print(FMT_STRING(_SYS_STR("    {} {} (Group {}, Setup {})\n")), idx++, pair.first, grpId, setupId);
         }
 
@@ -396,9 +613,26 @@ int main(int argc, const boo::SystemChar** argv)
   Log.report(logvisor::Info, FMT_STRING(_SYS_STR("Writing to {}")), pathOut);
 
   /* Build voice engine */
-  std::unique_ptr<boo::IAudioVoiceEngine> voxEngine = boo::NewWAVAudioVoiceEngine(pathOut.c_str(), rate, chCount);
-  amuse::BooBackendVoiceAllocator booBackend(*voxEngine);
-  amuse::Engine engine(booBackend, amuse::AmplitudeMode::PerSample);
+  std::unique_ptr<boo::IAudioVoiceEngine> voxEngine;
+  std::unique_ptr<amuse::IBackendVoiceAllocator> backend;
+  amuse::OfflineBackendVoiceAllocator* offlineBackend = nullptr;
+  std::optional<WAVFileWriter> wavWriter;
+  if (native) {
+    auto offline = std::make_unique<amuse::OfflineBackendVoiceAllocator>(rate, ChannelSetForCount(chCount));
+    offlineBackend = offline.get();
+    backend = std::move(offline);
+    wavWriter.emplace(pathOut.c_str(), uint32_t(rate), uint16_t(offlineBackend->getChannelMap().m_channelCount));
+    if (!*wavWriter) {
+      Log.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open {} for writing")), pathOut);
+      return 1;
+    }
+  } else {
+    voxEngine = boo::NewWAVAudioVoiceEngine(pathOut.c_str(), rate, chCount);
+    backend = std::make_unique<amuse::BooBackendVoiceAllocator>(*voxEngine);
+  }
+  /* boo submixes may mix in integer formats; keep the effect stacks in float throughout */
+  amuse::Engine engine(*backend, amuse::AmplitudeMode::PerSample,
+                       native ? amuse::EffectMode::Native : amuse::EffectMode::Planar);
   engine.setVolume(float(std::clamp(0.0, volume, 1.0)));
 
   /* Load group into engine */
@@ -411,10 +645,20 @@ int main(int argc, const boo::SystemChar** argv)
   /* Enter playback loop */
   amuse::ObjToken<amuse::Sequencer> seq = engine.seqPlay(m_groupId, m_setupId, m_arrData->m_data.get(), false);
   size_t wroteFrames = 0;
+  std::vector<int16_t> pcmBuf;
   signal(SIGINT, SIGINTHandler);
   do {
-    voxEngine->pumpAndMixVoices();
-    wroteFrames += voxEngine->get5MsFrames();
+    if (offlineBackend) {
+      /* Mix as fast as the CPU allows */
+      const size_t frames = offlineBackend->get5MsFrames();
+      pcmBuf.resize(frames * offlineBackend->getChannelMap().m_channelCount);
+      offlineBackend->pumpAndMixVoices(frames, pcmBuf.data());
+      wavWriter->write(pcmBuf.data(), pcmBuf.size());
+      wroteFrames += frames;
+    } else {
+      voxEngine->pumpAndMixVoices();
+      wroteFrames += voxEngine->get5MsFrames();
+    }
     fmt::print(FMT_STRING("\rFrame {}"), wroteFrames);
     fflush(stdout);
   } while (!g_BreakLoop && (seq->state() == amuse::SequencerState::Playing || seq->getVoiceCount() != 0));
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_set>
 
@@ -7,6 +8,7 @@
 #include "amuse/AudioGroupProject.hpp"
 #include "amuse/AudioGroupSampleDirectory.hpp"
 #include "amuse/Common.hpp"
+#include "amuse/SampleStream.hpp"
 
 namespace amuse {
 class AudioGroupData;
@@ -21,8 +23,10 @@ protected:
   AudioGroupPool m_pool;
   AudioGroupSampleDirectory m_sdir;
   const unsigned char* m_samp = nullptr;
+  std::shared_ptr<SampleStreamer> m_streamer; /**< Set when SAMP is paged in from a provider */
   SystemString m_groupPath; /* Typically only set by editor */
   bool m_valid;
+  bool m_cacheDecodedSamples = true;
 
 public:
   SystemString getSampleBasePath(SampleId sfxId) const;
@@ -37,9 +41,26 @@ public:
   void assign(const AudioGroup& data, SystemStringView groupPath);
   void setGroupPath(SystemStringView groupPath) { m_groupPath = groupPath; }
 
+  /** Allow the engine's SampleCache to hold decoded PCM of this group's compressed samples */
+  void setDecodedSampleCaching(bool enable) { m_cacheDecodedSamples = enable; }
+  bool cachesDecodedSamples() const { return m_cacheDecodedSamples; }
+
+  /** Page SAMP in through `provider` instead of requiring it resident.
+   *  At most `streamCount` voices stream this group's samples at once; further starts are dropped. */
+  void setSampleProvider(std::shared_ptr<ISampleProvider> provider,
+                         size_t headBytes = SampleStreamer::DefaultHeadBytes,
+                         size_t segmentBytes = SampleStreamer::DefaultSegmentBytes,
+                         size_t streamCount = SampleStreamer::DefaultStreamCount);
+  bool isStreamed() const { return m_streamer != nullptr; }
+
   const SampleEntry* getSample(SampleId sfxId) const;
+
+  /** Obtain sample data; streamed groups page the whole sample in and keep it resident */
   std::pair<ObjToken<SampleEntryData>, const unsigned char*> getSampleData(SampleId sfxId,
                                                                            const SampleEntry* sample) const;
+
+  /** Obtain a bounded-memory playback view of a sample in a streamed group */
+  ObjToken<SampleStream> openSampleStream(SampleId sfxId, const SampleEntry* sample) const;
   SampleFileState getSampleFileState(SampleId sfxId, const SampleEntry* sample, SystemString* pathOut = nullptr) const;
   void patchSampleMetadata(SampleId sfxId, const SampleEntry* sample) const;
   void makeWAVVersion(SampleId sfxId, const SampleEntry* sample) const;
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 #include "amuse/Common.hpp"
 
 namespace amuse {
+class ISampleProvider;
+class MemoryMappedFile;
 
 /** Simple pointer-container of the four Audio Group chunks */
 class AudioGroupData {
@@ -22,6 +26,7 @@ protected:
 
   DataFormat m_fmt;
   bool m_absOffs;
+  std::shared_ptr<ISampleProvider> m_sampProvider; /**< Streams SAMP from disk when m_samp is not resident */
 
   AudioGroupData(unsigned char* proj, size_t projSz, unsigned char* pool, size_t poolSz, unsigned char* sdir,
                  size_t sdirSz, unsigned char* samp, size_t sampSz, DataFormat fmt, bool absOffs)
@@ -90,9 +95,13 @@ public:
   size_t getSampSize() const { return m_sampSz; }
 
   explicit operator bool() const {
-    return m_proj != nullptr && m_pool != nullptr && m_sdir != nullptr && m_samp != nullptr;
+    return m_proj != nullptr && m_pool != nullptr && m_sdir != nullptr && (m_samp != nullptr || m_sampProvider);
   }
 
+  /** Leave SAMP non-resident and page sample data in through `provider` instead */
+  void setSampleProvider(std::shared_ptr<ISampleProvider> provider) { m_sampProvider = std::move(provider); }
+  const std::shared_ptr<ISampleProvider>& getSampleProvider() const { return m_sampProvider; }
+
   DataFormat getDataFormat() const { return m_fmt; }
   bool getAbsoluteProjOffsets() const { return m_absOffs; }
 };
@@ -100,9 +109,15 @@ public:
 /** A buffer-owning version of AudioGroupData */
 class IntrusiveAudioGroupData : public AudioGroupData {
   bool m_owns = true;
+  std::vector<std::shared_ptr<MemoryMappedFile>> m_mappings; /**< Files the chunks of a mapped view point into */
 
 public:
   using AudioGroupData::AudioGroupData;
+
+  /** Construct a zero-copy view of chunks residing within `mappings`, which are kept alive */
+  IntrusiveAudioGroupData(const AudioGroupData& view, std::vector<std::shared_ptr<MemoryMappedFile>>&& mappings)
+  : AudioGroupData(view), m_owns(false), m_mappings(std::move(mappings)) {}
+
   ~IntrusiveAudioGroupData();
 
   IntrusiveAudioGroupData(const IntrusiveAudioGroupData&) = delete;
@@ -112,5 +127,8 @@ public:
   IntrusiveAudioGroupData& operator=(IntrusiveAudioGroupData&& other) noexcept;
 
   void dangleOwnership() { m_owns = false; }
+
+  /** True when chunks are views into memory-mapped files rather than owned buffers */
+  bool isMapped() const { return !m_mappings.empty(); }
 };
 } // namespace amuse
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "amuse/Common.hpp"
+#include "amuse/DSPCodec.hpp"
 
 #include <athena/DNA.hpp>
 
@@ -215,6 +220,14 @@ public:
     time_t m_looseModTime = 0;
     std::unique_ptr<uint8_t[]> m_looseData;
 
+    /* DSP predictor history at the start of every DSPSeekBlocks-th block. Built off the audio thread
+     * (at load, or by the streamer's I/O thread) and immutable once published through m_dspSeekReady;
+     * loose reloads replace the whole EntryData and with it the table. */
+    static constexpr uint32_t DSPSeekBlocks = 64;
+    mutable std::mutex m_dspSeekLock;
+    mutable std::atomic_bool m_dspSeekReady = false;
+    mutable std::vector<std::pair<int16_t, int16_t>> m_dspSeekTable;
+
     /* Use middle C when pitch is (impossibly low) default */
     atUint8 getPitch() const { return m_pitch == 0 ? atUint8(60) : m_pitch; }
     atUint32 getNumSamples() const { return m_numSamples & 0xffffff; }
@@ -235,6 +248,59 @@ public:
     void setLoopEndSample(atUint32 sample) { m_loopLengthSamples = sample + 1 - m_loopStartSample; }
     atUint32 getLoopEndSample() const { return m_loopStartSample + m_loopLengthSamples - 1; }
 
+    /** True for DSP samples long enough that seeking without a table decodes more than DSPSeekBlocks blocks */
+    bool needsDSPSeekTable() const { return isFormatDSP() && (getNumSamples() + 13) / 14 > DSPSeekBlocks; }
+
+    /** Decode the predictor history of every block into the seek table. `blockBytes(b)` returns the 8 bytes
+     *  of block `b`, or null to abandon the build unpublished. Reads the whole sample; never call from the
+     *  audio thread. Does nothing once a table is published. */
+    template <typename BlockBytes>
+    void buildDSPSeekTable(BlockBytes&& blockBytes) const {
+      std::lock_guard<std::mutex> lk(m_dspSeekLock);
+      if (m_dspSeekReady.load(std::memory_order_relaxed))
+        return;
+      const uint32_t numBlocks = (getNumSamples() + 13) / 14;
+      std::vector<std::pair<int16_t, int16_t>> table;
+      table.reserve(numBlocks / DSPSeekBlocks + 1);
+      int16_t hist1 = 0;
+      int16_t hist2 = 0;
+      for (uint32_t b = 0; b < numBlocks; ++b) {
+        if (b % DSPSeekBlocks == 0)
+          table.emplace_back(hist1, hist2);
+        const uint8_t* bytes = blockBytes(b);
+        if (!bytes)
+          return;
+        DSPDecompressFrameStateOnly(bytes, m_ADPCMParms.dsp.m_coefs, &hist1, &hist2, 14);
+      }
+      m_dspSeekTable = std::move(table);
+      m_dspSeekReady.store(true, std::memory_order_release);
+    }
+
+    /** Set `prev1`/`prev2` to the DSP predictor history in effect before `block`, decoding fewer than
+     *  DSPSeekBlocks blocks. Without a published table the decoder warms up from silent history
+     *  DSPSeekBlocks blocks back, which the predictor converges from well before `block`.
+     *  `blockBytes(b)` returns the 8 bytes of block `b`, or null when they are not resident, in which case
+     *  history restarts from silence at the next block. Never builds the table, so safe on the audio thread. */
+    template <typename BlockBytes>
+    void seekDSP(uint32_t block, int16_t& prev1, int16_t& prev2, BlockBytes&& blockBytes) const {
+      uint32_t b = block > DSPSeekBlocks ? block - DSPSeekBlocks : 0;
+      prev1 = 0;
+      prev2 = 0;
+      if (m_dspSeekReady.load(std::memory_order_acquire) && !m_dspSeekTable.empty()) {
+        const size_t point = std::min(size_t(block / DSPSeekBlocks), m_dspSeekTable.size() - 1);
+        std::tie(prev1, prev2) = m_dspSeekTable[point];
+        b = uint32_t(point) * DSPSeekBlocks;
+      }
+      for (; b < block; ++b) {
+        if (const uint8_t* bytes = blockBytes(b)) {
+          DSPDecompressFrameStateOnly(bytes, m_ADPCMParms.dsp.m_coefs, &prev1, &prev2, 14);
+        } else {
+          prev1 = 0;
+          prev2 = 0;
+        }
+      }
+    }
+
     EntryData() = default;
 
     template <athena::Endian DNAE>
@@ -321,7 +387,16 @@ public:
   };
 
 private:
+  /** DSP payload of a sample as last packed by toGCNData; reused while its .dsp file is unchanged */
+  struct PackedSample {
+    int64_t m_dspModTime = 0;
+    int64_t m_dspSize = 0;
+    DSPADPCMHeader m_header;
+    std::vector<uint8_t> m_data;
+  };
+
   std::unordered_map<SampleId, ObjToken<Entry>> m_entries;
+  mutable std::unordered_map<SampleId, PackedSample> m_packCache;
   static void _extractWAV(SampleId id, const EntryData& ent, amuse::SystemStringView destDir,
                           const unsigned char* samp);
   static void _extractCompressed(SampleId id, const EntryData& ent, amuse::SystemStringView destDir,
@@ -345,6 +420,9 @@ public:
 
   void reloadSampleData(SystemStringView groupPath);
 
+  /** Pack SDIR and SAMP data for GameCube. Stale samples are encoded in parallel; .dsp files unchanged
+   *  since the last pack are not re-read, and WAVs whose content matches the `!samples.manifest` record
+   *  of their .dsp are not re-encoded */
   std::pair<std::vector<uint8_t>, std::vector<uint8_t>> toGCNData(const AudioGroupDatabase& group) const;
 
   AudioGroupSampleDirectory(const AudioGroupSampleDirectory&) = delete;
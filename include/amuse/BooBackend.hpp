@@ -1,9 +1,9 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -12,6 +12,7 @@
 #include "amuse/IBackendVoice.hpp"
 #include "amuse/IBackendSubmix.hpp"
 #include "amuse/IBackendVoiceAllocator.hpp"
+#include "amuse/SlabAllocator.hpp"
 
 #include <boo/audiodev/IAudioSubmix.hpp>
 #include <boo/audiodev/IAudioVoiceEngine.hpp>
@@ -19,6 +20,7 @@
 #include <boo/audiodev/MIDIDecoder.hpp>
 
 namespace amuse {
+class BooBackendVoiceAllocator;
 
 /** Backend voice implementation for boo mixer */
 class BooBackendVoice : public IBackendVoice {
@@ -36,6 +38,11 @@ class BooBackendVoice : public IBackendVoice {
   boo::ObjToken<boo::IAudioVoice> m_booVoice;
 
 public:
+  /** Wrapper objects are recycled through the allocator's slab pool (boo owns the mixer voice itself) */
+  static void* operator new(size_t size, BooBackendVoiceAllocator& root);
+  static void operator delete(void* ptr, BooBackendVoiceAllocator& root) noexcept;
+  static void operator delete(void* ptr) noexcept;
+
   BooBackendVoice(boo::IAudioVoiceEngine& engine, Voice& clientVox, double sampleRate, bool dynamicPitch);
   void resetSampleRate(double sampleRate) override;
 
@@ -46,6 +53,8 @@ public:
   void stop() override;
 };
 
+using BooVoicePool = SlabAllocator<sizeof(BooBackendVoice), alignof(BooBackendVoice)>;
+
 /** Backend submix implementation for boo mixer */
 class BooBackendSubmix : public IBackendSubmix {
   friend class BooBackendVoiceAllocator;
@@ -81,9 +90,24 @@ protected:
   std::unique_ptr<boo::IMIDIIn> m_virtualIn;
   boo::MIDIDecoder m_decoder;
 
+  /** Timestamped MIDI message stored inline in the input ring */
+  struct QueuedMessage {
+    static constexpr size_t MaxBytes = 16; /**< Channel and system messages; longer SysEx is dropped */
+    double m_time = 0.0;
+    uint8_t m_size = 0;
+    std::array<uint8_t, MaxBytes> m_bytes{};
+  };
+  static constexpr size_t QueueCapacity = 1024; /**< Must be a power of two */
+
+  /** Single-consumer ring: MIDI threads publish through m_queueHead, the audio thread
+   *  retires through m_queueTail and never blocks or frees memory */
   bool m_useLock;
-  std::list<std::pair<double, std::vector<uint8_t>>> m_queue;
-  std::mutex m_midiMutex;
+  std::array<QueuedMessage, QueueCapacity> m_queue;
+  alignas(64) std::atomic<size_t> m_queueHead = 0;
+  alignas(64) std::atomic<size_t> m_queueTail = 0;
+  std::atomic<size_t> m_droppedMessages = 0;
+  std::mutex m_midiMutex;           /**< Serializes multiple MIDI input threads; never taken by the audio thread */
+  std::vector<uint8_t> m_decodeBuf; /**< Reserved up front; boo's decoder consumes vector iterators */
   void _MIDIReceive(std::vector<uint8_t>&& bytes, double time);
 
 public:
@@ -96,6 +120,9 @@ public:
   void setVirtualIn(bool v);
   bool hasVirtualIn() const;
 
+  /** Messages discarded because the ring was full or they exceeded inline storage */
+  size_t getDroppedMessageCount() const { return m_droppedMessages.load(std::memory_order_relaxed); }
+
   void pumpReader(double dt) override;
 
   void noteOff(uint8_t chan, uint8_t key, uint8_t velocity) override;
@@ -129,10 +156,12 @@ public:
 /** Backend voice allocator implementation for boo mixer */
 class BooBackendVoiceAllocator : public IBackendVoiceAllocator, public boo::IAudioVoiceEngineCallback {
   friend class BooBackendMIDIReader;
+  friend class BooBackendVoice;
 
 protected:
   boo::IAudioVoiceEngine& m_booEngine;
   Engine* m_cbInterface = nullptr;
+  BooVoicePool::Handle m_voicePool = BooVoicePool::Create();
 
 public:
   BooBackendVoiceAllocator(boo::IAudioVoiceEngine& booEngine);
@@ -4,10 +4,14 @@
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <exception>
 #include <limits>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <athena/DNA.hpp>
 #include <logvisor/logvisor.hpp>
@@ -608,6 +612,54 @@ inline std::vector<typename T::key_type> SortUnorderedSet(const T& us) {
   std::sort(ret.begin(), ret.end());
   return ret;
 }
+
+/** Set while a thread runs ParallelFor work; nested ParallelFor calls then run serially on that thread */
+inline thread_local bool InParallelFor = false;
+
+/** Run func(i) for every i in [0, count) across the hardware threads, including the calling one.
+ *  Calls made from inside another ParallelFor run serially, so nesting never multiplies the threads.
+ *  The first exception thrown by func stops further work and is rethrown on the calling thread. */
+template <typename Func>
+inline void ParallelFor(size_t count, Func&& func) {
+  const size_t workers = std::min(count, size_t(std::max(1u, std::thread::hardware_concurrency())));
+  if (InParallelFor || workers < 2) {
+    for (size_t i = 0; i < count; ++i)
+      func(i);
+    return;
+  }
+
+  std::atomic_size_t next = 0;
+  std::mutex errorLock;
+  std::exception_ptr error;
+  auto run = [&]() {
+    InParallelFor = true;
+    try {
+      for (size_t i = next++; i < count; i = next++)
+        func(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lk(errorLock);
+      if (!error)
+        error = std::current_exception();
+      next = count;
+    }
+    InParallelFor = false;
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (size_t t = 1; t < workers; ++t) {
+    try {
+      threads.emplace_back(run);
+    } catch (const std::system_error&) {
+      break; /* Out of threads; the ones already running share the work */
+    }
+  }
+  run();
+  for (std::thread& thread : threads)
+    thread.join();
+  if (error)
+    std::rethrow_exception(error);
+}
 } // namespace amuse
 
 namespace std {
@@ -31,11 +31,20 @@ public:
     SongData(std::unique_ptr<uint8_t[]>&& data, size_t size, int16_t groupId, int16_t setupId)
     : m_data(std::move(data)), m_size(size), m_groupId(groupId), m_setupId(setupId) {}
   };
+  /** How LoadContainer obtains audio group chunks */
+  enum class LoadMode {
+    Copy,     /**< Read every chunk into an owned buffer */
+    MemoryMap, /**< Map the container and view uncompressed chunks in place (raw chunks, MP1, MP2);
+                    other containers and compressed resources fall back to Copy */
+    Stream     /**< Copy every chunk except SAMP, which is read from disk on demand (raw chunks, MP1,
+                    uncompressed MP2); other containers fall back to Copy */
+  };
   static const SystemChar* TypeToName(Type tp);
   static Type DetectContainerType(const SystemChar* path);
-  static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadContainer(const SystemChar* path);
   static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadContainer(const SystemChar* path,
-                                                                                     Type& typeOut);
+                                                                                     LoadMode mode = LoadMode::Copy);
+  static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>>
+  LoadContainer(const SystemChar* path, Type& typeOut, LoadMode mode = LoadMode::Copy);
   static std::vector<std::pair<SystemString, SongData>> LoadSongs(const SystemChar* path);
 };
 } // namespace amuse
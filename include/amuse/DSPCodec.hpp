@@ -29,3 +29,7 @@ unsigned DSPDecompressFrameRangedStateOnly(const uint8_t* in, const int16_t coef
 void DSPCorrelateCoefs(const short* source, int samples, short coefsOut[8][2]);
 
 void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2]);
+
+/* Scalar encoder trying one coefficient pair at a time; DSPEncodeFrame produces identical output */
+void DSPEncodeFrameReference(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8],
+                             const short coefsIn[8][2]);
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+
+#include "amuse/IBackendVoice.hpp"
+
 namespace amuse {
-struct ChannelMap;
 
 enum class EffectType { Invalid, ReverbStd, ReverbHi, Delay, Chorus, EffectTypeMAX };
 
@@ -10,11 +16,52 @@ public:
   virtual ~EffectBaseTypeless() = default;
   virtual void resetOutputSampleRate(double sampleRate) = 0;
   virtual EffectType Isa() const = 0;
+
+  /** Frames of output the effect may still produce once its input falls silent, or
+   *  `std::numeric_limits<size_t>::max()` when it rings indefinitely */
+  virtual size_t tailFrames() const = 0;
 };
 
 template <typename T>
 class EffectBase : public EffectBaseTypeless {
 public:
+  /** Process interleaved frames in place */
   virtual void applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) = 0;
+
+  /** Process de-interleaved channels in place; `chans[c]` holds `frameCount` contiguous samples */
+  virtual void applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) = 0;
+};
+
+/** Per-channel sample pointers into a block, with consecutive samples of a channel `m_stride` apart.
+ *  Lets one effect kernel serve both interleaved and planar layouts. */
+template <typename T>
+struct EffectChannels {
+  std::array<T*, NumChannels> m_chans{};
+  size_t m_stride = 1;
+  unsigned m_count = 0;
+
+  static EffectChannels Interleaved(T* audio, const ChannelMap& chanMap) {
+    EffectChannels ret;
+    ret.m_count = std::min(chanMap.m_channelCount, unsigned(NumChannels));
+    ret.m_stride = chanMap.m_channelCount;
+    for (unsigned c = 0; c < ret.m_count; ++c)
+      ret.m_chans[c] = audio + c;
+    return ret;
+  }
+
+  static EffectChannels Planar(T* const* chans, const ChannelMap& chanMap) {
+    EffectChannels ret;
+    ret.m_count = std::min(chanMap.m_channelCount, unsigned(NumChannels));
+    for (unsigned c = 0; c < ret.m_count; ++c)
+      ret.m_chans[c] = chans[c];
+    return ret;
+  }
+
+  T& at(unsigned chan, size_t frame) const { return m_chans[chan][frame * m_stride]; }
+
+  void advance(size_t frames) {
+    for (unsigned c = 0; c < m_count; ++c)
+      m_chans[c] += frames * m_stride;
+  }
 };
 } // namespace amuse
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 
 #include "amuse/Common.hpp"
@@ -29,7 +30,7 @@ class EffectChorus {
   uint32_t x90_baseDelay; /**< [5, 15] minimum value (in ms) for computed delay */
   uint32_t x94_variation; /**< [0, 5] time error (in ms) to set delay within */
   uint32_t x98_period;    /**< [500, 10000] time (in ms) of one delay-shift cycle */
-  bool m_dirty = true;    /**< needs update of internal parameter data */
+  std::atomic<bool> m_dirty = {true}; /**< needs update of internal parameter data */
 
   template <typename T>
   friend class EffectChorusImp;
@@ -94,16 +95,18 @@ class EffectChorusImp : public EffectBase<T>, public EffectChorus {
     uint32_t x88_trigger;    /**< total count of samples per channel across all blocks */
     uint32_t x8c_target = 0; /**< value to reset to when trigger hit */
 
-    void doSrc1(size_t blockSamples, size_t chanCount);
-    void doSrc2(size_t blockSamples, size_t chanCount);
+    void doSrc1(size_t blockSamples, size_t stride);
+    void doSrc2(size_t blockSamples, size_t stride);
   };
   SrcInfo x6c_src;
 
   uint32_t m_sampsPerMs;   /**< canonical count of samples per ms for the current backend */
   uint32_t m_blockSamples; /**< count of samples in a 5ms block */
+  uint32_t m_seatedBaseDelay = 0; /**< base delay the read position was last placed for, 0 after setup */
 
   void _setup(double sampleRate);
   void _update();
+  void _process(EffectChannels<T> chans, size_t frameCount);
 
 public:
   ~EffectChorusImp() override;
@@ -112,8 +115,10 @@ public:
   : EffectChorusImp(info.baseDelay, info.variation, info.period, sampleRate) {}
 
   void applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) override;
+  void applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) override;
   void resetOutputSampleRate(double sampleRate) override { _setup(sampleRate); }
 
   EffectType Isa() const override { return EffectType::Chorus; }
+  size_t tailFrames() const override;
 };
 } // namespace amuse
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 
@@ -47,7 +48,10 @@ protected:
   std::array<uint32_t, NumChannels> x3c_delay;    /**< [10, 5000] time in ms of each channel's delay */
   std::array<uint32_t, NumChannels> x48_feedback; /**< [0, 100] percent to mix delayed signal with input signal */
   std::array<uint32_t, NumChannels> x54_output;   /**< [0, 100] total output percent */
-  bool m_dirty = true;      /**< needs update of internal parameter data */
+  std::atomic<bool> m_dirty = {true}; /**< needs update of internal parameter data */
+
+  /** Make room for a delay of `delay` ms before it is published; runs on the thread calling the setters */
+  virtual void _reserveDelay(uint32_t delay) = 0;
 
 public:
   template <typename T>
@@ -55,11 +59,13 @@ public:
 
   void setDelay(uint32_t delay) {
     delay = std::clamp(delay, 10u, 5000u);
+    _reserveDelay(delay);
     x3c_delay.fill(delay);
     m_dirty = true;
   }
   void setChanDelay(int chanIdx, uint32_t delay) {
     delay = std::clamp(delay, 10u, 5000u);
+    _reserveDelay(delay);
     x3c_delay[chanIdx] = delay;
     m_dirty = true;
   }
@@ -92,6 +98,10 @@ public:
   uint32_t getChanOutput(int chanIdx) const { return x54_output[chanIdx]; }
 
   void setParams(const EffectDelayInfo& info) {
+    uint32_t maxDelay = 10;
+    for (uint32_t delay : info.delay)
+      maxDelay = std::max(maxDelay, std::clamp(delay, 10u, 5000u));
+    _reserveDelay(maxDelay);
     for (size_t i = 0; i < NumChannels; ++i) {
       x3c_delay[i] = std::clamp(info.delay[i], 10u, 5000u);
       x48_feedback[i] = std::clamp(info.feedback[i], 0u, 100u);
@@ -104,25 +114,58 @@ public:
 /** Type-specific implementation of delay effect */
 template <typename T>
 class EffectDelayImp : public EffectBase<T>, public EffectDelay {
-  std::array<uint32_t, NumChannels> x0_currentSize;      /**< per-channel delay-line buffer sizes */
-  std::array<uint32_t, NumChannels> xc_currentPos;       /**< per-channel block-index */
-  std::array<uint32_t, NumChannels> x18_currentFeedback; /**< [0, 128] feedback attenuator */
-  std::array<uint32_t, NumChannels> x24_currentOutput;   /**< [0, 128] total attenuator */
-
-  std::array<std::unique_ptr<T[]>, NumChannels> x30_chanLines; /**< delay-line buffers for each channel */
+  std::array<uint32_t, NumChannels> x0_currentSize{};      /**< per-channel delay in blocks */
+  std::array<uint32_t, NumChannels> xc_currentPos{};       /**< per-channel sample-index written next */
+  std::array<uint32_t, NumChannels> x18_currentFeedback{}; /**< [0, 128] feedback attenuator */
+  std::array<uint32_t, NumChannels> x24_currentOutput{};   /**< [0, 128] total attenuator */
+
+  /** delay-line buffers for each channel, m_lineBlocks blocks long. Sized for the longest delay configured so far
+   *  (a 5000ms delay at 48kHz costs ~1MB per channel for float); they grow but never shrink. */
+  std::array<std::unique_ptr<T[]>, NumChannels> x30_chanLines;
+
+  /** Larger delay lines built by a setter, handed to the audio thread and later back again for freeing.
+   *  The audio thread copies the old rings' history across a few blocks per callback before switching. */
+  struct Lines {
+    std::array<std::unique_ptr<T[]>, NumChannels> m_chans;
+    uint32_t m_blocks = 0;
+    Lines* m_nextRetired = nullptr;
+  };
+  std::atomic<Lines*> m_pendingLines = {nullptr}; /**< replacement lines waiting to be adopted by the audio thread */
+  std::atomic<Lines*> m_retiredLines = {nullptr}; /**< outgrown lines the audio thread leaves for the setters to free */
+
+  uint32_t m_reservedBlocks = 0; /**< block count of the newest lines, pending or adopted; setter thread only */
+
+  Lines* m_migrating = nullptr; /**< pending lines taken by the audio thread and still receiving history */
+  std::array<uint32_t, NumChannels> m_migrateStart{}; /**< ring position when the migration began */
+  std::array<size_t, NumChannels> m_migrateCopied{}; /**< samples of history copied so far, oldest first */
+
+  std::array<uint32_t, NumChannels> m_prevSize{};     /**< delay in blocks before the last parameter change */
+  std::array<uint32_t, NumChannels> m_prevFeedback{}; /**< feedback attenuator before the last parameter change */
+  std::array<uint32_t, NumChannels> m_prevOutput{};   /**< total attenuator before the last parameter change */
+  bool m_ramp = false; /**< next block glides from the previous delay and attenuators to the current ones */
 
   uint32_t m_sampsPerMs;   /**< canonical count of samples per ms for the current backend */
   uint32_t m_blockSamples; /**< count of samples in a 5ms block */
+  uint32_t m_lineBlocks;   /**< count of blocks in each delay-line buffer */
+  uint32_t _delayBlocks(uint32_t delay) const;
   void _setup(double sampleRate);
+  void _freeRetired();
+  void _beginMigration();
+  void _migrateLines(size_t blockSamples);
+  void _reserveDelay(uint32_t delay) override;
   void _update();
+  void _process(EffectChannels<T> chans, size_t frameCount);
 
 public:
   EffectDelayImp(uint32_t initDelay, uint32_t initFeedback, uint32_t initOutput, double sampleRate);
   EffectDelayImp(const EffectDelayInfo& info, double sampleRate);
+  ~EffectDelayImp() override;
 
   void applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) override;
+  void applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) override;
   void resetOutputSampleRate(double sampleRate) override { _setup(sampleRate); }
 
   EffectType Isa() const override { return EffectType::Delay; }
+  size_t tailFrames() const override;
 };
 } // namespace amuse
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 
@@ -37,16 +38,20 @@ struct EffectReverbHiInfo {
   : coloration(coloration), mix(mix), time(time), damping(damping), preDelay(preDelay), crosstalk(crosstalk) {}
 };
 
-/** Delay state for one 'tap' of the reverb effect */
+/** Delay state for one 'tap' of the reverb effect, shared by every channel.
+ *  Frames are stored channel-interleaved so adjacent channels run in SIMD lanes,
+ *  and the ring length is a power of two so wraparound is a mask rather than a branch. */
 struct ReverbDelayLine {
-  int32_t x0_inPoint = 0;
-  int32_t x4_outPoint = 0;
-  int32_t x8_length = 0;
-  std::unique_ptr<float[]> xc_inputs;
-  float x10_lastInput = 0.f;
-
-  void allocate(int32_t delay);
+  std::unique_ptr<float[]> m_inputs;            /**< (m_mask + 1) frames of NumChannels samples */
+  uint32_t m_mask = 0;                          /**< Ring length in frames, minus one */
+  uint32_t m_inPoint = 0;                       /**< Frame written by the next sample */
+  std::array<uint32_t, NumChannels> m_delay{};  /**< Per-channel delay in frames */
+  std::array<float, NumChannels> m_lastInput{}; /**< Last sample read for each channel */
+
+  void allocate(int32_t maxDelay);
+  void setdelay(unsigned chan, int32_t delay);
   void setdelay(int32_t delay);
+  void advance(int32_t frames) { m_inPoint = (m_inPoint + frames) & m_mask; }
 };
 
 template <typename T>
@@ -64,7 +69,7 @@ protected:
   float x148_x1d0_time;       /**< [0.01, 10.0] time in seconds for reflection decay */
   float x14c_x1d4_damping;    /**< [0.0, 1.0] damping factor influencing low-pass filter of reflections */
   float x150_x1d8_preDelay;   /**< [0.0, 0.1] time in seconds before initial reflection heard */
-  bool m_dirty = true;        /**< needs update of internal parameter data */
+  std::atomic<bool> m_dirty = {true}; /**< needs update of internal parameter data */
 
   template <typename T>
   friend class EffectReverbStdImp;
@@ -146,24 +151,32 @@ public:
 /** Standard-quality 2-stage reverb */
 template <typename T>
 class EffectReverbStdImp : public EffectBase<T>, public EffectReverbStd {
-  using CombCoeffArray = std::array<std::array<float, 2>, NumChannels>;
-  using ReverbDelayArray = std::array<std::array<ReverbDelayLine, 2>, NumChannels>;
-  using PreDelayArray = std::array<std::unique_ptr<float[]>, NumChannels>;
-
-  ReverbDelayArray x0_AP{};                           /**< All-pass delay lines */
-  ReverbDelayArray x78_C{};                           /**< Comb delay lines */
-  float xf0_allPassCoef = 0.f;                        /**< All-pass mix coefficient */
-  CombCoeffArray xf4_combCoef{};                      /**< Comb mix coefficients */
-  std::array<float, NumChannels> x10c_lpLastout{};    /**< Last low-pass results */
-  float x118_level = 0.f;                             /**< Internal wet/dry mix factor */
-  float x11c_damping = 0.f;                           /**< Low-pass damping */
-  int32_t x120_preDelayTime = 0;                      /**< Sample count of pre-delay */
-  PreDelayArray x124_preDelayLine;                    /**< Dedicated pre-delay buffers */
-  std::array<float*, NumChannels> x130_preDelayPtr{}; /**< Current pre-delay pointers */
+  using CombCoeffArray = std::array<std::array<float, NumChannels>, 2>;
+  using ReverbDelayArray = std::array<ReverbDelayLine, 2>;
+
+  ReverbDelayArray x0_AP{};                        /**< All-pass delay lines */
+  ReverbDelayArray x78_C{};                        /**< Comb delay lines */
+  float xf0_allPassCoef = 0.f;                     /**< All-pass mix coefficient */
+  CombCoeffArray xf4_combCoef{};                   /**< Comb mix coefficients, per tap then channel */
+  std::array<float, NumChannels> x10c_lpLastout{}; /**< Last low-pass results */
+  float x118_level = 0.f;                          /**< Internal wet/dry mix factor */
+  float x11c_damping = 0.f;                        /**< Low-pass damping */
+  int32_t x120_preDelayTime = 0;                   /**< Sample count of pre-delay */
+  ReverbDelayLine x124_preDelayLine;               /**< Dedicated pre-delay line, sized for the longest pre-delay */
+
+  float m_prevAllPassCoef = 0.f;   /**< All-pass coefficient before the last parameter change */
+  CombCoeffArray m_prevCombCoef{}; /**< Comb coefficients before the last parameter change */
+  float m_prevLevel = 0.f;         /**< Wet/dry mix before the last parameter change */
+  float m_prevDamping = 0.f;       /**< Low-pass damping before the last parameter change */
+  int32_t m_prevPreDelayTime = 0;  /**< Pre-delay before the last parameter change */
+  bool m_ramp = false;             /**< Next block glides from the previous coefficients to the current ones */
 
   double m_sampleRate; /**< copy of sample rate */
   void _setup(double sampleRate);
   void _update();
+  template <bool Ramp>
+  void _handleReverb(float* frames, unsigned lane, int sampleCount);
+  void _process(EffectChannels<T> chans, size_t frameCount);
 
 public:
   EffectReverbStdImp(float coloration, float mix, float time, float damping, float preDelay, double sampleRate);
@@ -171,38 +184,47 @@ public:
   : EffectReverbStdImp(info.coloration, info.mix, info.time, info.damping, info.preDelay, sampleRate) {}
 
   void applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) override;
+  void applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) override;
   void resetOutputSampleRate(double sampleRate) override { _setup(sampleRate); }
 
   EffectType Isa() const override { return EffectType::ReverbStd; }
+  size_t tailFrames() const override;
 };
 
 /** High-quality 3-stage reverb with per-channel low-pass and crosstalk */
 template <typename T>
 class EffectReverbHiImp : public EffectBase<T>, public EffectReverbHi {
-  using AllPassDelayLines = std::array<std::array<ReverbDelayLine, 2>, NumChannels>;
-  using CombCoefficients = std::array<std::array<float, 3>, NumChannels>;
-  using CombDelayLines = std::array<std::array<ReverbDelayLine, 3>, NumChannels>;
-  using LowPassDelayLines = std::array<ReverbDelayLine, 8>;
-  using PreDelayLines = std::array<std::unique_ptr<float[]>, 8>;
-
-  AllPassDelayLines x0_AP{};                          /**< All-pass delay lines */
-  LowPassDelayLines x78_LP{};                         /**< Per-channel low-pass delay-lines */
-  CombDelayLines xb4_C{};                             /**< Comb delay lines */
-  float x168_allPassCoef = 0.f;                       /**< All-pass mix coefficient */
-  CombCoefficients x16c_combCoef{};                   /**< Comb mix coefficients */
-  std::array<float, 8> x190_lpLastout{};              /**< Last low-pass results */
-  float x19c_level = 0.f;                             /**< Internal wet/dry mix factor */
-  float x1a0_damping = 0.f;                           /**< Low-pass damping */
-  int32_t x1a4_preDelayTime = 0;                      /**< Sample count of pre-delay */
-  PreDelayLines x1ac_preDelayLine;                    /**< Dedicated pre-delay buffers */
-  std::array<float*, NumChannels> x1b8_preDelayPtr{}; /**< Current pre-delay pointers */
+  using AllPassDelayLines = std::array<ReverbDelayLine, 2>;
+  using CombCoefficients = std::array<std::array<float, NumChannels>, 3>;
+  using CombDelayLines = std::array<ReverbDelayLine, 3>;
+
+  AllPassDelayLines x0_AP{};             /**< All-pass delay lines */
+  ReverbDelayLine x78_LP{};              /**< Low-pass delay line with a distinct delay per channel */
+  CombDelayLines xb4_C{};                /**< Comb delay lines */
+  float x168_allPassCoef = 0.f;          /**< All-pass mix coefficient */
+  CombCoefficients x16c_combCoef{};      /**< Comb mix coefficients, per tap then channel */
+  std::array<float, 8> x190_lpLastout{}; /**< Last low-pass results */
+  float x19c_level = 0.f;                /**< Internal wet/dry mix factor */
+  float x1a0_damping = 0.f;              /**< Low-pass damping */
+  int32_t x1a4_preDelayTime = 0;         /**< Sample count of pre-delay */
+  ReverbDelayLine x1ac_preDelayLine;     /**< Dedicated pre-delay line, sized for the longest pre-delay */
   float x1a8_internalCrosstalk = 0.f;
 
+  float m_prevAllPassCoef = 0.f;     /**< All-pass coefficient before the last parameter change */
+  CombCoefficients m_prevCombCoef{}; /**< Comb coefficients before the last parameter change */
+  float m_prevLevel = 0.f;           /**< Wet/dry mix before the last parameter change */
+  float m_prevDamping = 0.f;         /**< Low-pass damping before the last parameter change */
+  int32_t m_prevPreDelayTime = 0;    /**< Pre-delay before the last parameter change */
+  float m_prevCrosstalk = 0.f;       /**< Crosstalk before the last parameter change */
+  bool m_ramp = false;               /**< Next block glides from the previous coefficients to the current ones */
+
   double m_sampleRate; /**< copy of sample rate */
   void _setup(double sampleRate);
   void _update();
-  void _handleReverb(T* audio, int chanIdx, int chanCount, int sampleCount);
-  void _doCrosstalk(T* audio, float wet, float dry, int chanCount, int sampleCount);
+  template <bool Ramp>
+  void _handleReverb(float* frames, unsigned lane, int sampleCount);
+  void _doCrosstalk(float* frames, float fromWet, float toWet, unsigned chanCount, int sampleCount);
+  void _process(EffectChannels<T> chans, size_t frameCount);
 
 public:
   EffectReverbHiImp(float coloration, float mix, float time, float damping, float preDelay, float crosstalk,
@@ -211,8 +233,10 @@ public:
   : EffectReverbHiImp(info.coloration, info.mix, info.time, info.damping, info.preDelay, info.crosstalk, sampleRate) {}
 
   void applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) override;
+  void applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) override;
   void resetOutputSampleRate(double sampleRate) override { _setup(sampleRate); }
 
   EffectType Isa() const override { return EffectType::ReverbHi; }
+  size_t tailFrames() const override;
 };
 } // namespace amuse
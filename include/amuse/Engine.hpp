@@ -6,11 +6,13 @@
 #include <memory>
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 #include "amuse/AudioGroupSampleDirectory.hpp"
 #include "amuse/Emitter.hpp"
 #include "amuse/IBackendVoiceAllocator.hpp"
 #include "amuse/Listener.hpp"
+#include "amuse/SampleCache.hpp"
 #include "amuse/Sequencer.hpp"
 #include "amuse/Studio.hpp"
 
@@ -28,6 +30,11 @@ enum class AmplitudeMode {
   BlockLinearized /**< Per-block lerp amplitude evaluation (dt = 160.0 / sampleRate) */
 };
 
+enum class EffectMode {
+  Native, /**< Effects run interleaved in each submix's backend sample format */
+  Planar  /**< Effects run in float on de-interleaved channel blocks (see Submix::setPlanarEffects) */
+};
+
 /** Main audio playback system for a single audio output */
 class Engine {
   friend class Emitter;
@@ -38,9 +45,11 @@ class Engine {
 
   IBackendVoiceAllocator& m_backend;
   AmplitudeMode m_ampMode;
+  EffectMode m_effectMode;
   std::unique_ptr<IMIDIReader> m_midiReader;
   std::unordered_map<const AudioGroupData*, std::unique_ptr<AudioGroup>> m_audioGroups;
-  std::list<ObjToken<Voice>> m_activeVoices;
+  VoicePool::Handle m_voicePool = VoicePool::Create(); /**< Voice storage; private to this Engine's pump thread */
+  std::vector<ObjToken<Voice>> m_activeVoices;
   std::list<ObjToken<Emitter>> m_activeEmitters;
   std::list<ObjToken<Listener>> m_activeListeners;
   std::list<ObjToken<Sequencer>> m_activeSequencers;
@@ -49,6 +58,11 @@ class Engine {
   std::unordered_map<SFXId, std::tuple<AudioGroup*, GroupId, const SFXGroupIndex::SFXEntry*>> m_sfxLookup;
   std::linear_congruential_engine<uint32_t, 0x41c64e6d, 0x3039, UINT32_MAX> m_random;
   int m_nextVid = 0;
+  uint64_t m_pumpTick = 0;
+  double m_eventOffset = 0.0;
+  size_t m_maxVoices = 64;
+  size_t m_controlPeriod = 0;
+  SampleCache m_sampleCache;
   float m_masterVolume = 1.f;
   AudioChannelSet m_channelSet = AudioChannelSet::Unknown;
 
@@ -56,18 +70,26 @@ class Engine {
   std::pair<AudioGroup*, const SongGroupIndex*> _findSongGroup(GroupId groupId) const;
   std::pair<AudioGroup*, const SFXGroupIndex*> _findSFXGroup(GroupId groupId) const;
 
-  std::list<ObjToken<Voice>>::iterator _allocateVoice(const AudioGroup& group, GroupId groupId, double sampleRate,
-                                                      bool dynamicPitch, bool emitter, ObjToken<Studio> studio);
+  ObjToken<Voice> _allocateVoice(const AudioGroup& group, GroupId groupId, double sampleRate, bool dynamicPitch,
+                                 bool emitter, ObjToken<Studio> studio, const VoiceBudget& budget = {});
   std::list<ObjToken<Sequencer>>::iterator _allocateSequencer(const AudioGroup& group, GroupId groupId, SongId setupId,
                                                               ObjToken<Studio> studio);
   ObjToken<Studio> _allocateStudio(bool mainOut);
-  std::list<ObjToken<Voice>>::iterator _destroyVoice(std::list<ObjToken<Voice>>::iterator it);
+  std::vector<ObjToken<Voice>>::iterator _destroyVoice(std::vector<ObjToken<Voice>>::iterator it);
+  void _destroyVoice(Voice* vox);
   std::list<ObjToken<Sequencer>>::iterator _destroySequencer(std::list<ObjToken<Sequencer>>::iterator it);
   void _bringOutYourDead();
 
+  template <typename Func>
+  static void _visitVoices(std::vector<ObjToken<Voice>>& voices, Func&& func);
+  size_t _countBudgetedVoices(const void* source);
+  Voice* _findStealVictim(uint8_t maxPriority, const void* source);
+  bool _reserveVoice(const VoiceBudget& budget);
+
 public:
   ~Engine();
-  Engine(IBackendVoiceAllocator& backend, AmplitudeMode ampMode = AmplitudeMode::PerSample);
+  Engine(IBackendVoiceAllocator& backend, AmplitudeMode ampMode = AmplitudeMode::PerSample,
+         EffectMode effectMode = EffectMode::Native);
 
   /** Access voice backend of engine */
   IBackendVoiceAllocator& getBackend() { return m_backend; }
@@ -75,7 +97,8 @@ public:
   /** Access MIDI reader */
   IMIDIReader* getMIDIReader() const { return m_midiReader.get(); }
 
-  /** Add audio group data pointers to engine; must remain resident! */
+  /** Add audio group data pointers to engine; must remain resident! (SAMP may instead be
+   *  supplied through a sample provider, see AudioGroupData::setSampleProvider) */
   const AudioGroup* addAudioGroup(const AudioGroupData& data);
 
   /** Remove audio group from engine */
@@ -149,6 +172,29 @@ public:
     return seqPlay(group, groupId, songId, arrData, loop, m_defaultStudio);
   }
 
+  /** Set maximum count of concurrently playing voices; lower-priority voices are stolen beyond this */
+  void setMaxVoices(size_t maxVoices);
+
+  /** Get maximum count of concurrently playing voices */
+  size_t getMaxVoices() const { return m_maxVoices; }
+
+  /** Set frame interval at which SoundMacro bus-level controllers are re-evaluated
+   *  while routing voice audio (0 = once per mixed block, 1 = every sample) */
+  void setControlPeriod(size_t frames) { m_controlPeriod = frames; }
+
+  /** Get frame interval of SoundMacro bus-level controller evaluation */
+  size_t getControlPeriod() const { return m_controlPeriod; }
+
+  /** Place subsequently dispatched events `offset` seconds into the upcoming 5ms interval;
+   *  voices started or keyed-off by them begin or release at that frame (reset after each dispatcher) */
+  void setEventOffset(double offset) { m_eventOffset = offset; }
+
+  /** Get sub-interval position of events currently being dispatched */
+  double getEventOffset() const { return m_eventOffset; }
+
+  /** Obtain cache of decoded compressed samples (disabled until given a budget) */
+  SampleCache& getSampleCache() { return m_sampleCache; }
+
   /** Set total volume of engine */
   void setVolume(float vol);
 
@@ -165,7 +211,7 @@ public:
   uint32_t nextRandom() { return m_random(); }
 
   /** Obtain list of active voices */
-  std::list<ObjToken<Voice>>& getActiveVoices() { return m_activeVoices; }
+  std::vector<ObjToken<Voice>>& getActiveVoices() { return m_activeVoices; }
 
   /** Obtain total active voice count (including child voices) */
   size_t getNumTotalActiveVoices() const;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace amuse {
@@ -8,7 +9,9 @@ class Voice;
 struct ADSR;
 struct ADSRDLS;
 
-/** Per-sample state tracker for ADSR envelope data */
+/** Per-sample state tracker for ADSR envelope data.
+ *  Each stage is a precomputed linear ramp in stage time; ADSR controllers are evaluated
+ *  at control rate by update() rather than per sample. */
 class Envelope {
 public:
   enum class State { Attack, Decay, Sustain, Release, Complete };
@@ -23,13 +26,39 @@ private:
   double m_curTime = 0.0;            /**< Current time of envelope stage in seconds */
   bool m_adsrSet = false;
 
+  /* Parameters in effect: the ADSR table's, or the last controller evaluation */
+  double m_curAttackTime = 0.01;
+  double m_curDecayTime = 0.0;
+  double m_curSustainFactor = 1.0;
+  double m_curReleaseTime = 0.01;
+  bool m_usingControllers = false;
+
+  /* Current stage as level = m_stageBase + m_stageSlope * m_curTime until m_curTime >= m_stageEnd */
+  double m_stageBase = 0.0;
+  double m_stageSlope = 0.0;
+  double m_stageEnd = 0.0;
+
+  void _evaluate(const Voice* vox);
+  void _prepareStage();
+  void _enterStage(State phase);
+  float _advance(double dt);
+
 public:
   void reset(const ADSR* adsr);
   void reset(const ADSRDLS* adsr, int8_t note, int8_t vel);
   void keyOff(const Voice& vox);
   void keyOff();
+
+  /** Re-evaluate ADSR controllers; called once per control block */
+  void update(const Voice& vox);
+
   float advance(double dt, const Voice& vox);
   float advance(double dt);
+
+  /** Write the levels of the next `count` steps of `dt` seconds to `out`.
+   *  Runs inside a stage are emitted with one multiply-add per step. */
+  void advanceBlock(double dt, size_t count, float* out, const Voice& vox);
+
   bool isComplete(const Voice& vox) const;
   bool isAdsrSet() const { return m_adsrSet; }
 };
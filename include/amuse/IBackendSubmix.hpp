@@ -12,6 +12,10 @@ public:
   /** Set send level for submix (AudioChannel enum for array index) */
   virtual void setSendLevel(IBackendSubmix* submix, float level, bool slew) = 0;
 
+  /** Studio of this submix was routed into the studio owning submix; backends that leave
+   *  non-main-out studio routing to the client (boo) ignore this */
+  virtual void addStudioSend(IBackendSubmix* submix, float level) {}
+
   /** Amuse gets fixed sample rate of submix this way */
   virtual double getSampleRate() const = 0;
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "amuse/Common.hpp"
+
+namespace amuse {
+
+/** Read-only, copy-on-write view of an entire file.
+ *  Writes through data() stay private to the process and never reach the file. */
+class MemoryMappedFile {
+  unsigned char* m_data = nullptr;
+  size_t m_size = 0;
+#if _WIN32
+  void* m_mapping = nullptr;
+#endif
+
+  MemoryMappedFile() = default;
+
+public:
+  ~MemoryMappedFile();
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+  /** Map the file at `path`; returns null when the file is empty or the platform cannot map it */
+  static std::shared_ptr<MemoryMappedFile> Open(const SystemChar* path);
+
+  unsigned char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+};
+
+} // namespace amuse
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "amuse/IBackendSubmix.hpp"
+#include "amuse/IBackendVoice.hpp"
+#include "amuse/IBackendVoiceAllocator.hpp"
+#include "amuse/SlabAllocator.hpp"
+
+namespace amuse {
+class OfflineBackendSubmix;
+class OfflineBackendVoiceAllocator;
+class OfflineEffectWorkers;
+
+/** Backend voice implementation for the in-tree software mixer */
+class OfflineBackendVoice : public IBackendVoice {
+  friend class OfflineBackendSubmix;
+  friend class OfflineBackendVoiceAllocator;
+
+  /** Channel matrix binding the voice to one submix */
+  struct SubmixLevels {
+    OfflineBackendSubmix* m_submix;
+    std::array<float, 8> m_curCoefs;    /**< Coefficients applied at the start of the next block */
+    std::array<float, 8> m_targetCoefs; /**< Coefficients applied at the end of the next block */
+  };
+
+  /** Resampler history samples carried between blocks (4-point interpolation) */
+  static constexpr size_t HistoryCount = 4;
+
+  /** A voice feeds the master, AuxA and AuxB busses of its studio */
+  static constexpr size_t MaxSends = 3;
+
+  OfflineBackendVoiceAllocator& m_root;
+  Voice& m_clientVox;
+  double m_sampleRate;
+  bool m_dynamicPitch;
+  bool m_running = false;
+  double m_pitchRatio = 1.0;       /**< Pitch ratio reached at the end of the last block */
+  double m_targetPitchRatio = 1.0; /**< Pitch ratio to slew towards during the next block */
+  double m_srcPhase = 0.0;         /**< Fractional read position within m_srcHistory */
+  std::array<float, HistoryCount> m_srcHistory{};
+  std::array<SubmixLevels, MaxSends> m_sends{};
+  size_t m_sendCount = 0;
+
+  void _removeSubmix(OfflineBackendSubmix* submix);
+  void _pumpAndMix(size_t frames, double dt);
+
+public:
+  /** Backend voices are carved from their allocator's slab pool */
+  static void* operator new(size_t size, OfflineBackendVoiceAllocator& root);
+  static void operator delete(void* ptr, OfflineBackendVoiceAllocator& root) noexcept;
+  static void operator delete(void* ptr) noexcept;
+
+  OfflineBackendVoice(OfflineBackendVoiceAllocator& root, Voice& clientVox, double sampleRate, bool dynamicPitch);
+  ~OfflineBackendVoice() override;
+
+  void resetSampleRate(double sampleRate) override;
+  void resetChannelLevels() override;
+  void setChannelLevels(IBackendSubmix* submix, const std::array<float, 8>& coefs, bool slew) override;
+  void setPitchRatio(double ratio, bool slew) override;
+  void start() override;
+  void stop() override;
+};
+
+using OfflineVoicePool = SlabAllocator<sizeof(OfflineBackendVoice), alignof(OfflineBackendVoice)>;
+
+/** Backend submix implementation for the in-tree software mixer */
+class OfflineBackendSubmix : public IBackendSubmix {
+  friend class OfflineBackendVoice;
+  friend class OfflineBackendVoiceAllocator;
+  friend class OfflineEffectWorkers;
+
+  struct SendLevel {
+    OfflineBackendSubmix* m_submix;
+    float m_curLevel;
+    float m_targetLevel;
+  };
+
+  OfflineBackendVoiceAllocator& m_root;
+  Submix& m_clientSmx;
+  bool m_mainOut;
+  int m_busId;
+  size_t m_level = 0;          /**< Longest send chain reaching this submix; one level never feeds itself */
+  std::vector<float> m_mixBuf; /**< Interleaved mix of all sources feeding this submix */
+  std::vector<SendLevel> m_sends;
+
+  void _removeSubmix(OfflineBackendSubmix* submix);
+  bool _feeds(const OfflineBackendSubmix* target) const;
+  void _applyEffects(size_t frames);
+  void _pumpAndMix(size_t frames);
+
+public:
+  OfflineBackendSubmix(OfflineBackendVoiceAllocator& root, Submix& clientSmx, bool mainOut, int busId);
+  ~OfflineBackendSubmix() override;
+
+  void setSendLevel(IBackendSubmix* submix, float level, bool slew) override;
+  void addStudioSend(IBackendSubmix* submix, float level) override { setSendLevel(submix, level, false); }
+  double getSampleRate() const override;
+  SubmixFormat getSampleFormat() const override { return SubmixFormat::Float; }
+};
+
+/** Small persistent pool running the effect chains of independent submixes within one mix interval.
+ *  The mixing thread takes work as well and never waits on a worker that has not woken up,
+ *  so a late wakeup costs no more than mixing serially. */
+class OfflineEffectWorkers {
+  std::mutex m_lock;
+  std::condition_variable m_workCv;
+  std::condition_variable m_doneCv;
+  OfflineBackendSubmix* const* m_batch = nullptr;
+  size_t m_batchCount = 0;
+  size_t m_next = 0;      /**< Next unclaimed submix in m_batch */
+  size_t m_remaining = 0; /**< Submixes in m_batch not yet finished */
+  size_t m_frames = 0;
+  bool m_running = true;
+  std::vector<std::thread> m_threads;
+
+  void _run();
+  void _drain(std::unique_lock<std::mutex>& lk);
+
+public:
+  explicit OfflineEffectWorkers(size_t threadCount);
+  ~OfflineEffectWorkers();
+
+  /** Start up to `threadCount` workers, leaving a core for the mixing thread; null when none would run */
+  static std::unique_ptr<OfflineEffectWorkers> Create(size_t threadCount);
+  OfflineEffectWorkers(const OfflineEffectWorkers&) = delete;
+  OfflineEffectWorkers& operator=(const OfflineEffectWorkers&) = delete;
+
+  /** Apply the effect stacks of `count` submixes, returning once all are done */
+  void applyEffects(OfflineBackendSubmix* const* submixes, size_t count, size_t frames);
+};
+
+/** Backend voice allocator implementing mixing, resampling and submix routing without
+ *  an audio device. The client drives the mix by calling pumpAndMixVoices at any pace. */
+class OfflineBackendVoiceAllocator : public IBackendVoiceAllocator {
+  friend class OfflineBackendVoice;
+  friend class OfflineBackendSubmix;
+
+  double m_sampleRate;
+  AudioChannelSet m_channelSet;
+  ChannelMap m_chanMap;
+  size_t m_5msFrames;
+  float m_volume = 1.f;
+  Engine* m_cbInterface = nullptr;
+
+  OfflineVoicePool::Handle m_voicePool = OfflineVoicePool::Create();
+  std::vector<OfflineBackendVoice*> m_voices;
+  std::vector<OfflineBackendSubmix*> m_submixes;
+  std::vector<OfflineBackendSubmix*> m_linearizedSubmixes; /**< Sources ordered before their send targets */
+  std::vector<size_t> m_levelEnds; /**< End of each dependency level within m_linearizedSubmixes */
+  std::vector<OfflineBackendSubmix*> m_effectBatch;
+  std::unique_ptr<OfflineEffectWorkers> m_ownedEffectWorkers;
+  OfflineEffectWorkers* m_effectWorkers = nullptr; /**< Owned or shared pool; null mixes serially */
+  bool m_voicesDirty = false;
+  bool m_submixesDirty = true;
+
+  std::vector<float> m_resampleBuf;
+  std::vector<float> m_routeBuf;
+  std::vector<int16_t> m_supplyBuf;
+  std::vector<float> m_outBuf;
+
+  void _linearizeSubmixes();
+  void _pumpAndMix5Ms(size_t frames, float* dataOut);
+
+public:
+  /** Upper bound on effect worker threads; fewer are started on machines with fewer cores */
+  static constexpr size_t DefaultEffectWorkers = 3;
+
+  /** `effectWorkers` threads share submix effect processing with the mixing thread; 0 mixes serially */
+  OfflineBackendVoiceAllocator(double sampleRate, AudioChannelSet channelSet = AudioChannelSet::Stereo,
+                               size_t effectWorkers = DefaultEffectWorkers);
+  /** Run submix effects on `sharedWorkers`, which outlives this backend and may serve others that
+   *  mix one at a time (e.g. consecutive renders); null mixes serially */
+  OfflineBackendVoiceAllocator(double sampleRate, AudioChannelSet channelSet, OfflineEffectWorkers* sharedWorkers);
+  ~OfflineBackendVoiceAllocator() override;
+
+  std::unique_ptr<IBackendVoice> allocateVoice(Voice& clientVox, double sampleRate, bool dynamicPitch) override;
+  std::unique_ptr<IBackendSubmix> allocateSubmix(Submix& clientSmx, bool mainOut, int busId) override;
+  std::vector<std::pair<std::string, std::string>> enumerateMIDIDevices() override { return {}; }
+  std::unique_ptr<IMIDIReader> allocateMIDIReader(Engine& engine) override { return {}; }
+  AudioChannelSet getAvailableSet() override { return m_channelSet; }
+  void setVolume(float vol) override { m_volume = vol; }
+  void setCallbackInterface(Engine* engine) override { m_cbInterface = engine; }
+
+  /** Mix `frames` interleaved frames of the main output into `dataOut`,
+   *  invoking the engine's 5ms interval callbacks along the way */
+  void pumpAndMixVoices(size_t frames, float* dataOut);
+  void pumpAndMixVoices(size_t frames, int16_t* dataOut);
+
+  /** Get number of frames in one 5ms mixing interval */
+  size_t get5MsFrames() const { return m_5msFrames; }
+
+  /** Get output sample rate of the mixer */
+  double getSampleRate() const { return m_sampleRate; }
+
+  /** Get interleaved speaker layout of the main output */
+  const ChannelMap& getChannelMap() const { return m_chanMap; }
+};
+} // namespace amuse
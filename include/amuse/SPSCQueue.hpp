@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace amuse {
+
+/** Fixed-capacity queue between exactly one producer thread and one consumer thread.
+ *  The producer publishes through m_head and the consumer retires through m_tail, like the
+ *  MIDI input ring; neither side locks or allocates. Elements are moved in and out of inline
+ *  slots, so they may own references (e.g. ObjTokens) that the consumer then releases. */
+template <typename T, size_t Capacity>
+class SPSCQueue {
+  static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  std::array<T, Capacity> m_slots{};
+  alignas(64) std::atomic<size_t> m_head = 0;
+  alignas(64) std::atomic<size_t> m_tail = 0;
+
+public:
+  /** Producer side; returns false (leaving `value` untouched) when the queue is full */
+  bool push(T&& value) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+      return false;
+    m_slots[head & (Capacity - 1)] = std::move(value);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Consumer side; returns false when the queue is empty */
+  bool pop(T& out) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire))
+      return false;
+    out = std::move(m_slots[tail & (Capacity - 1)]);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Producer side; true when push() would fail */
+  bool full() const {
+    return m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire) == Capacity;
+  }
+
+  bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed); }
+};
+
+} // namespace amuse
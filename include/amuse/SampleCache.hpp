@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "amuse/AudioGroupSampleDirectory.hpp"
+#include "amuse/Common.hpp"
+#include "amuse/SPSCQueue.hpp"
+
+namespace amuse {
+class AudioGroup;
+
+/** Fully decoded 16-bit PCM of a compressed sample, shared by every voice playing it */
+class DecodedSample : public IObj {
+  friend class SampleCache;
+
+  std::vector<int16_t> m_pcm;
+  uint32_t m_endPos = 0;    /**< Samples decoded from the start (the voice's last sample position) */
+  uint32_t m_loopStart = 0; /**< First sample of the separately decoded loop pass */
+  bool m_hasLoopPass = false;
+
+  /* Fill state; the worker decodes in slices and hands the sample over once m_ready is set */
+  SampleFormat m_format = SampleFormat::DSP;
+  uint32_t m_fillPos = 0;      /**< Next sample to decode in the current pass */
+  bool m_fillLoopPass = false; /**< Linear pass done, now decoding from the stored loop history */
+  bool m_loopMatches = true;   /**< Loop pass so far equals the linear decode */
+  int16_t m_prev1 = 0;
+  int16_t m_prev2 = 0;
+  bool m_ready = false;
+
+public:
+  /** PCM indexed by sample position from sample start */
+  const int16_t* getData() const { return m_pcm.data(); }
+
+  /** PCM indexed by sample position after a loop turnover.
+   *  DSPADPCM loops restart from the stored loop history, which may differ from a linear decode. */
+  const int16_t* getLoopData() const {
+    return m_hasLoopPass ? m_pcm.data() + m_endPos - m_loopStart : m_pcm.data();
+  }
+
+  size_t getSizeBytes() const { return m_pcm.capacity() * sizeof(int16_t); }
+};
+
+/** Memory-bounded LRU cache of decoded compressed samples.
+ *  Voices starting a cached sample stream PCM instead of decoding ADPCM blocks.
+ *  The engine thread (lookup() and pump()) never decodes, allocates or frees: a miss is queued to
+ *  a worker thread and the voice plays through the regular ADPCM path meanwhile. The worker
+ *  allocates and decodes the sample and hands it back through a queue; pump() then publishes it
+ *  to later lookups. References the cache lets go of are returned to the worker to be released. */
+class SampleCache {
+  struct Slot {
+    const AudioGroup* m_group = nullptr;
+    SampleId m_id;
+    ObjToken<SampleEntryData> m_entry; /**< Held so a reloaded entry can never alias this one's address */
+    const unsigned char* m_data = nullptr;
+    ObjToken<DecodedSample> m_decoded; /**< Null until the worker's decode has been published */
+    size_t m_bytes = 0;
+    uint64_t m_lastUse = 0;
+  };
+
+  /** A miss on its way to the worker, a finished decode on its way back, or references to release */
+  struct Job {
+    const AudioGroup* m_group = nullptr;
+    ObjToken<SampleEntryData> m_entry;
+    const unsigned char* m_data = nullptr;
+    ObjToken<DecodedSample> m_decoded;
+  };
+
+  /** Samples tracked at once; the slot table is reserved up front */
+  static constexpr size_t SlotCount = 256;
+
+  /* Engine thread state */
+  std::vector<Slot> m_slots;
+  uint64_t m_useTick = 0;
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+
+  SPSCQueue<Job, 64> m_requests;  /**< Engine thread to worker */
+  SPSCQueue<Job, 64> m_finished;  /**< Worker to engine thread */
+  SPSCQueue<Job, 512> m_retired;  /**< Engine thread to worker, released there */
+  std::atomic<size_t> m_outstanding = 0; /**< Requests the worker has not finished with */
+  std::atomic<size_t> m_budget = 0;
+  std::atomic<size_t> m_usage = 0;
+
+  /* Worker thread, started by the first non-zero budget */
+  std::mutex m_workerLock;
+  std::thread m_worker;
+  std::atomic<bool> m_running = false;
+  std::atomic<uint32_t> m_wake = 0;
+  std::atomic<bool> m_cancelling = false;
+  std::atomic<const AudioGroup*> m_cancelGroup = nullptr; /**< Group whose requests are dropped; null for all */
+
+  void _run();
+  void _wakeWorker();
+  bool _cancelled(const Job& job) const;
+  void _cancel(const AudioGroup* group);
+  bool _retire(size_t idx);
+  bool _trim(size_t budget);
+  void _publishFinished();
+  static size_t _fill(DecodedSample& decoded, const SampleEntryData& entry, const unsigned char* data,
+                      size_t maxSamples);
+
+public:
+  /** Samples the worker decodes between checks for cancellation */
+  static constexpr size_t FillSamplesPerSlice = 14 * 4096;
+
+  SampleCache();
+  ~SampleCache();
+  SampleCache(const SampleCache&) = delete;
+  SampleCache& operator=(const SampleCache&) = delete;
+
+  /** Fetch decoded PCM for a DSP or N64 sample; returns null when the cache is disabled, the group
+   *  opts out, the sample is too large for the budget, or its decode has not been published yet */
+  ObjToken<DecodedSample> lookup(const AudioGroup& group, SampleId id, const ObjToken<SampleEntryData>& entry,
+                                 const unsigned char* data);
+
+  /** Hand back a voice's reference so a sample evicted while playing is freed by the worker */
+  void release(ObjToken<DecodedSample>& decoded);
+
+  /** Publish samples the worker has finished and apply budget changes (called by Engine each 5ms) */
+  void pump();
+
+  /** Set memory budget in bytes (0 disables caching); samples larger than a quarter of the budget are never cached.
+   *  May be called from any thread; the engine thread trims to a lowered budget on its next pump(). */
+  void setBudget(size_t bytes);
+  size_t getBudget() const { return m_budget.load(std::memory_order_relaxed); }
+
+  /** Get bytes of PCM currently held or being decoded */
+  size_t getUsage() const { return m_usage.load(std::memory_order_relaxed); }
+
+  uint64_t getHitCount() const { return m_hits; }
+  uint64_t getMissCount() const { return m_misses; }
+  void resetCounters() {
+    m_hits = 0;
+    m_misses = 0;
+  }
+
+  /** Drop all entries decoded from `group`, waiting for the worker to let go of its sample data */
+  void purgeGroup(const AudioGroup& group);
+
+  /** Drop all entries */
+  void clear();
+};
+} // namespace amuse
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "amuse/AudioGroupSampleDirectory.hpp"
+#include "amuse/Common.hpp"
+#include "amuse/SPSCQueue.hpp"
+
+namespace amuse {
+class SampleStreamer;
+
+/** Source of SAMP chunk bytes for audio groups whose sample data is not kept resident */
+class ISampleProvider {
+public:
+  virtual ~ISampleProvider() = default;
+
+  /** Read up to `len` bytes at `offset` within the SAMP chunk, returning the count read.
+   *  Called from the streamer's I/O thread, and from the loading thread for heads and tooling
+   *  page-ins; never from the audio thread. */
+  virtual size_t read(size_t offset, size_t len, unsigned char* out) = 0;
+
+  /** Total size of the SAMP chunk */
+  virtual size_t size() const = 0;
+};
+
+/** Provider reading a SAMP chunk stored at `baseOffset` within a file */
+class FileSampleProvider : public ISampleProvider {
+  std::mutex m_lock;
+  FILE* m_fp;
+  size_t m_baseOffset;
+  size_t m_size;
+
+public:
+  FileSampleProvider(const SystemChar* path, size_t baseOffset, size_t size);
+  ~FileSampleProvider() override;
+  FileSampleProvider(const FileSampleProvider&) = delete;
+  FileSampleProvider& operator=(const FileSampleProvider&) = delete;
+
+  explicit operator bool() const { return m_fp != nullptr; }
+  size_t read(size_t offset, size_t len, unsigned char* out) override;
+  size_t size() const override { return m_size; }
+};
+
+/** Playback view of one sample's bytes within a streamed audio group.
+ *  The head is always resident. The remainder cycles through a two-segment ring refilled ahead of
+ *  the read position by the streamer's I/O thread; for looped samples the segment holding the loop
+ *  start is kept resident alongside, so the jump back never waits on I/O. The audio thread never
+ *  reads the provider: a segment that has not arrived yet (a seek or an I/O stall) plays as
+ *  zeroed frames while it is fetched. */
+class SampleStream : public IObj {
+  friend class SampleStreamer;
+
+  enum class SegmentState { Empty, Pending, Ready };
+  struct Segment {
+    unsigned char* m_data = nullptr; /**< Points into the streamer's preallocated slot */
+    size_t m_start = 0; /**< Sample-relative byte offset of m_data */
+    size_t m_len = 0;
+    std::atomic<SegmentState> m_state = {SegmentState::Empty};
+  };
+
+  static constexpr size_t NoLoopSegment = SIZE_MAX;
+
+  SampleStreamer& m_streamer;
+  size_t m_sampleOff; /**< Offset of the sample within the SAMP chunk */
+  size_t m_sampleBytes;
+  const unsigned char* m_head;
+  size_t m_headLen;
+  size_t m_segmentLen;
+  size_t m_streamEnd;                 /**< End of the last frame played before a loop turnover */
+  bool m_looped = false;              /**< Playback wraps from m_streamEnd back to the loop start */
+  size_t m_loopIndex = NoLoopSegment; /**< Segment index served by m_loopSegment instead of the ring */
+  std::array<Segment, 2> m_segments;
+  Segment m_loopSegment;
+
+  void _fill(Segment& seg);
+  Segment* _findSegment(size_t start);
+  void _requestSegment(size_t index, const Segment* inUse);
+  void _requestLoopSegment();
+  void _prefetch(size_t index, const Segment* inUse);
+
+public:
+  SampleStream(SampleStreamer& streamer, size_t sampleOff, size_t sampleBytes, const unsigned char* head,
+               size_t headLen, size_t segmentLen, unsigned char* buffers);
+
+  /** Streams live in the streamer's preallocated slots; releasing the last reference frees the slot */
+  static void operator delete(void* ptr) noexcept;
+
+  /** Obtain contiguous bytes starting at sample-relative `offset`; `avail` receives the count available.
+   *  Block-format frames never straddle the returned range. */
+  const unsigned char* acquire(size_t offset, size_t& avail);
+
+  /** Bytes at sample-relative `offset` if they are already resident, else null.
+   *  Unlike acquire, never queues a read or substitutes zeroed frames. */
+  const unsigned char* resident(size_t offset);
+
+  size_t getSampleBytes() const { return m_sampleBytes; }
+};
+
+/** Per-group residency manager: resident sample heads, whole-sample page-in for tooling and a
+ *  background I/O thread that keeps one segment ahead of each streaming voice and, when idle,
+ *  builds DSP seek tables from the provider.
+ *  Stream objects and their segment buffers are preallocated; the thread pumping the engine opens
+ *  streams and queues segment reads without locking or allocating. */
+class SampleStreamer {
+  friend class SampleStream;
+
+  /** Storage for one open stream: the object itself, then its ring and loop segment buffers */
+  struct StreamSlot {
+    alignas(SampleStream) unsigned char m_storage[sizeof(SampleStream)];
+    std::unique_ptr<unsigned char[]> m_buffers;
+    std::atomic<bool> m_inUse = false;
+  };
+
+  struct Request {
+    ObjToken<SampleStream> m_stream; /**< Keeps the stream's slot claimed while its segment is read */
+    SampleStream::Segment* m_segment = nullptr;
+  };
+
+  std::shared_ptr<ISampleProvider> m_provider;
+  size_t m_headBytes;
+  size_t m_segmentBytes;
+  std::unordered_map<SampleId, std::vector<unsigned char>> m_heads;
+
+  std::mutex m_toolingLock;
+  std::unordered_map<SampleId, std::vector<unsigned char>> m_toolingData; /**< Whole samples handed out raw */
+
+  std::unique_ptr<StreamSlot[]> m_slots;
+  size_t m_slotCount;
+  SPSCQueue<Request, 256> m_requests; /**< Engine thread to I/O thread */
+  std::atomic<uint32_t> m_wake = 0;
+  std::atomic<bool> m_running = true;
+
+  /* DSP samples whose seek tables the I/O thread builds while no segment reads are queued */
+  std::vector<ObjToken<SampleEntryData>> m_seekBuilds;
+  size_t m_nextSeekBuild = 0;
+  std::vector<unsigned char> m_seekChunk;
+
+  std::thread m_thread;
+
+  void _run();
+  bool _serviceRequests();
+  void _buildSeekTable(const SampleEntryData& entry);
+  bool _request(SampleStream& stream, SampleStream::Segment& seg);
+
+public:
+  static constexpr size_t DefaultHeadBytes = 8192;
+  static constexpr size_t DefaultSegmentBytes = 32768;
+  static constexpr size_t DefaultStreamCount = 64;
+
+  /** Reads heads of every sample in `sdir` up front so voices start without touching the provider.
+   *  At most `streamCount` streams are open at once. */
+  SampleStreamer(std::shared_ptr<ISampleProvider> provider, const AudioGroupSampleDirectory& sdir,
+                 size_t headBytes = DefaultHeadBytes, size_t segmentBytes = DefaultSegmentBytes,
+                 size_t streamCount = DefaultStreamCount);
+  ~SampleStreamer();
+  SampleStreamer(const SampleStreamer&) = delete;
+  SampleStreamer& operator=(const SampleStreamer&) = delete;
+
+  /** Open a playback view of a sample; null when the sample has no head or every stream is in use */
+  ObjToken<SampleStream> openStream(SampleId id, const SampleEntryData& entry);
+
+  /** Page in a whole sample and keep it resident for the streamer's lifetime (editor and tooling use).
+   *  Reads the provider; never call from the audio thread. */
+  const unsigned char* residentData(SampleId id, const SampleEntryData& entry);
+
+  ISampleProvider& getProvider() const { return *m_provider; }
+
+  /** Bytes occupied by a sample's encoded data */
+  static size_t SampleBytes(const SampleEntryData& entry);
+};
+
+} // namespace amuse
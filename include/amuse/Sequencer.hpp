@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "amuse/AudioGroupProject.hpp"
 #include "amuse/Common.hpp"
@@ -34,6 +36,7 @@ class Sequencer : public Entity {
   SongState m_songState;                                /**< State of current arrangement playback */
   SequencerState m_state = SequencerState::Interactive; /**< Current high-level state of sequencer */
   bool m_dieOnEnd = false; /**< Sequencer will be killed when current arrangement completes */
+  bool m_seeking = false;  /**< Key events only update held-note state while fast-forwarding */
 
   float m_curVol = 1.f; /**< Current volume of sequencer */
   float m_volFadeTime = 0.f;
@@ -53,19 +56,23 @@ class Sequencer : public Entity {
     ChannelState(Sequencer& parent, uint8_t chanId);
     explicit operator bool() const { return m_parent != nullptr; }
 
-    /** Voices corresponding to currently-pressed keys in channel */
-    std::unordered_map<uint8_t, ObjToken<Voice>> m_chanVoxs;
-    std::unordered_set<ObjToken<Voice>> m_keyoffVoxs;
+    /** Voices corresponding to currently-pressed keys in channel (flat and reserved up front
+     *  so note-on/off never allocate) */
+    std::vector<std::pair<uint8_t, ObjToken<Voice>>> m_chanVoxs;
+    std::vector<ObjToken<Voice>> m_keyoffVoxs;
     ObjToken<Voice> m_lastVoice;
-    std::array<int8_t, 128> m_ctrlVals{}; /**< MIDI controller values */
-    float m_curPitchWheel = 0.f;          /**< MIDI pitch-wheel */
-    int8_t m_pitchWheelRange = -1;        /**< Pitch wheel range settable by RPN 0 */
-    int8_t m_curProgram = 0;              /**< MIDI program number */
-    float m_curVol = 1.f;                 /**< Current volume of channel */
-    float m_curPan = 0.f;                 /**< Current panning of channel */
-    uint16_t m_rpn = 0;                   /**< Current RPN (only pitch-range 0x0000 supported) */
-    double m_ticksPerSec = 1000.0;        /**< Current ticks per second (tempo) for channel */
-
+    std::array<int8_t, 128> m_ctrlVals{};  /**< MIDI controller values */
+    float m_curPitchWheel = 0.f;           /**< MIDI pitch-wheel */
+    int8_t m_pitchWheelRange = -1;         /**< Pitch wheel range settable by RPN 0 */
+    int8_t m_curProgram = 0;               /**< MIDI program number */
+    float m_curVol = 1.f;                  /**< Current volume of channel */
+    float m_curPan = 0.f;                  /**< Current panning of channel */
+    uint16_t m_rpn = 0;                    /**< Current RPN (only pitch-range 0x0000 supported) */
+    double m_ticksPerSec = 1000.0;         /**< Current ticks per second (tempo) for channel */
+    std::array<uint8_t, 128> m_seekKeys{}; /**< Keys held while seeking (0x80 | velocity), 0 when released */
+
+    std::vector<std::pair<uint8_t, ObjToken<Voice>>>::iterator _findKey(uint8_t note);
+    void _setKey(uint8_t note, ObjToken<Voice> vox);
     void _bringOutYourDead();
     size_t getVoiceCount() const;
     ObjToken<Voice> keyOn(uint8_t note, uint8_t velocity);
@@ -140,6 +147,14 @@ public:
   /** Play MIDI arrangement */
   void playSong(const unsigned char* arrData, bool loop = true, bool dieOnEnd = true);
 
+  /** Fast-forward current MIDI arrangement to `seconds` from its start without spawning voices.
+   *  Controller, program, pitch-wheel and tempo state is accumulated per channel;
+   *  keys still held at the destination are re-triggered when `retrigger` is set */
+  void seek(double seconds, bool retrigger = true);
+
+  /** Fast-forward current MIDI arrangement to `ticks` from its start (first pass, before any loop) */
+  void seekTicks(uint32_t ticks, bool retrigger = true);
+
   /** Stop current MIDI arrangement */
   void stopSong(float fadeTime = 0.f, bool now = false);
 
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace amuse {
+
+/** Fixed-size block allocator backing class-specific operator new/delete of
+ *  frequently recycled engine objects. Freed blocks go onto a free list and are
+ *  never returned to the system; the pool grows one slab at a time.
+ *
+ *  Each Engine or backend allocator owns its own pool and only touches it from the
+ *  thread pumping that engine, so there is no locking. Every block remembers its pool,
+ *  letting operator delete return it without context. A pool released by its owner while
+ *  blocks are still out (e.g. a client token outliving the Engine) frees itself once the
+ *  last block comes back. */
+template <size_t BlockSize, size_t BlockAlign, size_t SlabBlocks = 32>
+class SlabAllocator {
+  struct Block {
+    union {
+      Block* m_next;         /**< Next free block while on the free list */
+      SlabAllocator* m_pool; /**< Owning pool while handed out */
+    };
+    alignas(BlockAlign) std::byte m_storage[BlockSize];
+  };
+
+  std::vector<std::unique_ptr<Block[]>> m_slabs;
+  Block* m_freeList = nullptr;
+  size_t m_capacity = 0;
+  size_t m_live = 0;
+  bool m_released = false;
+
+  SlabAllocator() = default;
+
+  void _grow(size_t count) {
+    std::unique_ptr<Block[]> slab = std::make_unique<Block[]>(count);
+    for (size_t i = 0; i < count; ++i) {
+      slab[i].m_next = m_freeList;
+      m_freeList = &slab[i];
+    }
+    m_slabs.push_back(std::move(slab));
+    m_capacity += count;
+  }
+
+  void _release() noexcept {
+    m_released = true;
+    if (!m_live)
+      delete this;
+  }
+
+public:
+  struct Releaser {
+    void operator()(SlabAllocator* pool) const noexcept { pool->_release(); }
+  };
+  using Handle = std::unique_ptr<SlabAllocator, Releaser>;
+
+  static Handle Create() { return Handle(new SlabAllocator); }
+
+  /** Ensure at least `count` blocks exist so later allocations avoid the system heap */
+  void reserve(size_t count) {
+    if (count > m_capacity)
+      _grow(count - m_capacity);
+  }
+
+  void* allocate() {
+    if (!m_freeList)
+      _grow(SlabBlocks);
+    Block* blk = m_freeList;
+    m_freeList = blk->m_next;
+    blk->m_pool = this;
+    ++m_live;
+    return blk->m_storage;
+  }
+
+  /** Return a block to whichever pool handed it out */
+  static void Deallocate(void* ptr) noexcept {
+    if (!ptr)
+      return;
+    Block* blk = reinterpret_cast<Block*>(static_cast<std::byte*>(ptr) - offsetof(Block, m_storage));
+    SlabAllocator* pool = blk->m_pool;
+    blk->m_next = pool->m_freeList;
+    pool->m_freeList = blk;
+    if (--pool->m_live == 0 && pool->m_released)
+      delete pool;
+  }
+};
+
+} // namespace amuse
@@ -2,6 +2,8 @@
 
 #include <array>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 #include "amuse/Entity.hpp"
 
@@ -39,6 +41,7 @@ class SongState {
     uint16_t m_unk2;
     int16_t m_regionIndex; /* -1 to terminate song, -2 to loop to previous region */
     int16_t m_loopToRegion;
+    void swapBig();
     bool indexDone(bool bigEndian, bool loop) const;
     bool indexValid(bool bigEndian) const;
     int indexLoop(bool bigEndian) const;
@@ -51,6 +54,21 @@ class SongState {
     void swapBig();
   };
 
+  /** Native-endian, absolute-tick form of one region's command data, built once by initialize */
+  struct CompiledRegion {
+    enum class EventType : uint8_t { Note, Control, Program, End };
+    struct Event {
+      int32_t m_tick;    /**< Ticks from region start (as counted by the region's wait countdown) */
+      EventType m_type;
+      uint8_t m_a;       /**< Note, controller or program number */
+      uint8_t m_b;       /**< Velocity or controller value */
+      uint16_t m_length; /**< Note length in ticks */
+    };
+    std::vector<Event> m_events;                       /**< Commands in time order, ending with End */
+    std::vector<std::pair<uint32_t, int32_t>> m_pitch; /**< Pitch wheel (tick from region start, delta) */
+    std::vector<std::pair<uint32_t, int32_t>> m_mod;   /**< Mod wheel (tick from region start, delta) */
+  };
+
   const unsigned char* m_songData = nullptr; /**< Base pointer to active song */
   int m_sngVersion;                          /**< Detected song revision, 1 has RLE-compressed delta-times */
   bool m_bigEndian;                          /**< True if loaded song is big-endian data */
@@ -86,7 +104,18 @@ class SongState {
     int32_t m_modVal = 0;                            /**< Accumulated value of mod */
     uint32_t m_nextModTick = 0;                      /**< Upcoming position of mod wheel change */
     int32_t m_nextModDelta = 0;                      /**< Upcoming delta value of mod */
-    std::array<int, 128> m_remNoteLengths = {};      /**< Remaining ticks per note */
+
+    std::vector<TrackRegion> m_regions;            /**< Native-endian copy of the region list at m_initRegion */
+    const CompiledRegion* m_compiled = nullptr;    /**< Compiled commands of current region */
+    size_t m_eventIdx = 0;                         /**< Next compiled command */
+    size_t m_pitchIdx = 0;                         /**< Next compiled pitch change */
+    size_t m_modIdx = 0;                           /**< Next compiled modulation change */
+    uint32_t m_regionElapsed = 0;                  /**< Ticks elapsed against current region's commands */
+    uint32_t m_regionBaseTick = 0;                 /**< Track tick current region's wheel data is relative to */
+    uint32_t m_noteClock = 0;                      /**< Running tick count used for note-off scheduling */
+    uint32_t m_nextNoteOff = 0;                    /**< Earliest pending note-off on m_noteClock */
+    std::array<uint64_t, 2> m_activeNotes = {};    /**< Bitmask of notes with a pending note-off */
+    std::array<uint32_t, 128> m_noteOffTicks = {}; /**< Note-off time per note on m_noteClock */
 
     int32_t m_eventWaitCountdown = 0; /**< Current wait in ticks */
     int32_t m_lastN64EventTick =
@@ -99,9 +128,16 @@ class SongState {
     void advanceRegion();
     bool advance(Sequencer& seq, double dt);
     void resetTempo();
+    const TrackRegion& _nextRegion() const;
+    void _stopDueNotes(Sequencer& seq, double dt, double ticksPerSecond);
+    void _placeEvent(Sequencer& seq, double dt, double ticksPerSecond, int32_t ticksBeforeEnd) const;
   };
   std::array<Track, 64> m_tracks;
   const uint32_t* m_regionIdx; /**< Table of offsets to song-region data */
+  std::vector<CompiledRegion> m_compiledRegions; /**< Compiled commands indexed by region index */
+  std::vector<TempoChange> m_tempoChanges;       /**< Native-endian tempo table, terminated like the SNG table */
+
+  void _compileRegion(CompiledRegion& out, uint32_t regionIdx) const;
 
   SongPlayState m_songState = SongPlayState::Playing; /**< High-level state of Song playback */
   bool m_loop = true;                                 /**< Enable looping */
@@ -117,6 +153,12 @@ public:
 
   uint32_t getInitialTempo() const { return m_header.m_initialTempo & 0x7fffffff; }
 
+  /** Looping mode passed to initialize() */
+  bool isLooping() const { return m_loop; }
+
+  /** Seconds from song start to `tick` following the tempo table (loops not considered) */
+  double getTickTime(uint32_t tick) const;
+
   /** advances `dt` seconds worth of commands in the Song
    *  @return `true` if END reached
    */
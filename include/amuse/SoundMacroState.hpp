@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "amuse/AudioGroupPool.hpp"
@@ -17,8 +19,31 @@ class Voice;
 
 /** Real-time state of SoundMacro execution */
 struct SoundMacroState {
+  using PCFrame = std::tuple<ObjectId, const SoundMacro*, int>;
+
+  /** Fixed-capacity call stack so GOSUB never allocates (a GOSUB past the deepest frame replaces it) */
+  class PCStack {
+    std::array<PCFrame, 16> m_frames{};
+    size_t m_size = 0;
+
+  public:
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    PCFrame& back() { return m_frames[m_size - 1]; }
+    const PCFrame& back() const { return m_frames[m_size - 1]; }
+    void pop_back() { --m_size; }
+    void clear() { m_size = 0; }
+    template <class... Args>
+    void emplace_back(Args&&... args) {
+      PCFrame frame(std::forward<Args>(args)...);
+      if (m_size == m_frames.size())
+        --m_size;
+      m_frames[m_size++] = frame;
+    }
+  };
+
   /** 'program counter' stack for the active SoundMacro */
-  std::vector<std::tuple<ObjectId, const SoundMacro*, int>> m_pc;
+  PCStack m_pc;
   void _setPC(int pc) { std::get<2>(m_pc.back()) = std::get<1>(m_pc.back())->assertPC(pc); }
 
   double m_ticksPerSec; /**< ratio for resolving ticks in commands that use them */
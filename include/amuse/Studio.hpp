@@ -15,6 +15,7 @@ class Studio {
   Submix m_master;
   Submix m_auxA;
   Submix m_auxB;
+  bool m_mainOut;
 
   std::list<StudioSend> m_studiosOut;
 #ifndef NDEBUG
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -21,9 +22,20 @@ class Submix {
   friend class Engine;
   friend class Voice;
   friend class Sequencer;
+  friend class Studio;
   Engine& m_root;
   std::unique_ptr<IBackendSubmix> m_backendSubmix;                /**< Handle to client-implemented backend submix */
   std::vector<std::unique_ptr<EffectBaseTypeless>> m_effectStack; /**< Ordered list of effects to apply to submix */
+  bool m_planarEffects = false;           /**< Effects are float and run on de-interleaved channel blocks */
+  mutable std::vector<float> m_planarBuf; /**< De-interleaved scratch for planar effect processing */
+  size_t m_planarFrames = 0;              /**< Frames per channel m_planarBuf holds */
+  mutable size_t m_silentFrames = 0;      /**< Consecutive frames of silent input seen by applyEffect */
+
+  void _sizePlanarBuf(double sampleRate);
+  template <typename T>
+  void _applyEffectPlanar(T* audio, size_t frameCount, const ChannelMap& chanMap) const;
+  template <typename T>
+  bool _effectsIdle(const T* audio, size_t frameCount, const ChannelMap& chanMap) const;
 
 public:
   Submix(Engine& engine);
@@ -31,6 +43,10 @@ public:
   /** Construct new effect */
   template <class T, class... Args>
   std::unique_ptr<EffectBaseTypeless> _makeEffect(Args... args) {
+    if (m_planarEffects) {
+      using ImpType = typename T::template ImpType<float>;
+      return std::make_unique<ImpType>(args..., m_backendSubmix->getSampleRate());
+    }
     switch (m_backendSubmix->getSampleFormat()) {
     case SubmixFormat::Int16: {
       using ImpType = typename T::template ImpType<int16_t>;
@@ -85,6 +101,16 @@ public:
   /** Returns true when an effect callback is bound */
   bool canApplyEffect() const { return m_effectStack.size() != 0; }
 
+  /** Frames the effect stack keeps producing output once its input falls silent.
+   *  applyEffect skips the stack after this much silence and resumes on the first non-silent block. */
+  size_t getEffectTailFrames() const;
+
+  /** Run the whole effect stack in float on de-interleaved channel blocks, converting and clamping
+   *  once per submix rather than once per effect. Must be chosen while the effect stack is empty;
+   *  engines constructed with EffectMode::Planar choose it for every studio before adding effects. */
+  void setPlanarEffects(bool planar);
+  bool isPlanarEffects() const { return m_planarEffects; }
+
   /** in/out transformation entry for audio effect */
   void applyEffect(int16_t* audio, size_t frameCount, const ChannelMap& chanMap) const;
 
@@ -3,14 +3,15 @@
 #include <array>
 #include <cstdint>
 #include <cstdlib>
-#include <list>
 #include <memory>
-#include <queue>
+#include <vector>
 
 #include "amuse/AudioGroup.hpp"
 #include "amuse/AudioGroupSampleDirectory.hpp"
 #include "amuse/Entity.hpp"
 #include "amuse/Envelope.hpp"
+#include "amuse/SampleCache.hpp"
+#include "amuse/SlabAllocator.hpp"
 #include "amuse/SoundMacroState.hpp"
 #include "amuse/Studio.hpp"
 
@@ -33,6 +34,13 @@ enum class VoiceState {
   Dead     /**< Default state, causes Engine to remove voice at end of pump cycle */
 };
 
+/** Stealing parameters applied when allocating a voice */
+struct VoiceBudget {
+  uint8_t priority = 50;        /**< Voices of equal or lower priority may be stolen to make room */
+  uint8_t maxVoices = 255;      /**< Maximum concurrent voices started from `source`; 0 is unlimited */
+  const void* source = nullptr; /**< Page, SFX or PLAYMACRO entry whose voices count against `maxVoices` */
+};
+
 /** Individual source of audio */
 class Voice : public Entity {
   friend class Emitter;
@@ -43,9 +51,12 @@ class Voice : public Entity {
   friend struct SoundMacro::CmdGoSub;
   friend struct SoundMacro::CmdKeyOff;
   friend struct SoundMacro::CmdModeSelect;
+  friend struct SoundMacro::CmdAddPriority;
+  friend struct SoundMacro::CmdPlayMacro;
   friend struct SoundMacro::CmdReturn;
   friend struct SoundMacro::CmdScaleVolume;
   friend struct SoundMacro::CmdScaleVolumeDLS;
+  friend struct SoundMacro::CmdSetPriority;
   friend struct SoundMacro::CmdTrapEvent;
   friend struct SoundMacro::CmdUntrapEvent;
   friend struct SoundMacroState;
@@ -65,6 +76,27 @@ class Voice : public Entity {
     int8_t m_width; /**< delta pan value to target of PANNING command */
   };
 
+  /** Fixed-capacity FIFO of pending PANNING/SPANNING commands (oldest dropped on overflow) */
+  class PanningQueue {
+    std::array<Panning, 4> m_entries{};
+    size_t m_head = 0;
+    size_t m_count = 0;
+
+  public:
+    bool empty() const { return m_count == 0; }
+    Panning& front() { return m_entries[m_head]; }
+    void pop() {
+      m_head = (m_head + 1) % m_entries.size();
+      --m_count;
+    }
+    void push(const Panning& p) {
+      if (m_count == m_entries.size())
+        pop();
+      m_entries[(m_head + m_count) % m_entries.size()] = p;
+      ++m_count;
+    }
+  };
+
   void _setObjectId(ObjectId id) { m_objectId = id; }
 
   int m_vid;                        /**< VoiceID of this voice instance */
@@ -78,11 +110,22 @@ class Voice : public Entity {
   SoundMacroState::EventTrap m_sampleEndTrap; /**< Trap for sampleend (SoundMacro overrides voice removal) */
   SoundMacroState::EventTrap m_messageTrap;   /**< Trap for messages sent from other SoundMacros */
   int32_t m_latestMessage = 0;                /**< Latest message received on voice */
-  std::list<ObjToken<Voice>> m_childVoices;   /**< Child voices for PLAYMACRO usage */
+  std::vector<ObjToken<Voice>> m_childVoices; /**< Child voices for PLAYMACRO usage */
   uint8_t m_keygroup = 0;                     /**< Keygroup voice is a member of */
 
+  uint8_t m_priority = 50;              /**< Stealing priority (higher survives longer) */
+  const void* m_budgetSource = nullptr; /**< Entry whose maxVoices budget this voice counts against */
+  uint64_t m_startTick = 0;             /**< Engine 5ms tick of voice start; orders stealing by age */
+  bool m_stolen = false;                /**< Voice was stolen and is rapidly fading out */
+  float m_stealFadeVol = 1.f;           /**< Remaining gain of stolen voice's fade-out */
+  double m_startDelay = 0.0;            /**< Silence (seconds) rendered ahead of a start placed inside a block */
+  double m_keyOffDelay = -1.0;          /**< Pending keyoff position (seconds into the block), -1 when none */
+  uint64_t m_keyOffTick = 0;            /**< Engine 5ms tick the pending keyoff was dispatched in */
+
   ObjToken<SampleEntryData> m_curSample;          /**< Current sample entry playing */
   const unsigned char* m_curSampleData = nullptr; /**< Current sample data playing */
+  ObjToken<DecodedSample> m_curDecoded;           /**< Cached PCM standing in for compressed sample data */
+  ObjToken<SampleStream> m_curStream;             /**< Paged sample data when the group is streamed */
   SampleFormat m_curFormat;                       /**< Current sample format playing */
   uint32_t m_curSamplePos = 0;                    /**< Current sample position */
   uint32_t m_lastSamplePos = 0;                   /**< Last sample position (or last loop sample) */
@@ -90,6 +133,8 @@ class Voice : public Entity {
   int16_t m_prev2 = 0;                            /**< DSPADPCM prev-prev sample */
   double m_dopplerRatio = 1.0;                    /**< Current ratio to mix with chromatic pitch for doppler effects */
   double m_sampleRate = NativeSampleRate; /**< Current sample rate computed from relative sample key or SETPITCH */
+  double m_backendRate = NativeSampleRate; /**< Source sample rate the backend voice was last reset to */
+  double m_pitchRatio = 1.0;               /**< Resampling ratio last handed to the backend voice */
   double m_voiceTime = 0.0;               /**< Current seconds of voice playback (per-sample resolution) */
   uint64_t m_voiceSamples = 0;            /**< Count of samples processed over voice's lifetime */
   float m_lastLevel = 0.f;                /**< Last computed level ([0,1] mapped to [-10,0] clamped decibels) */
@@ -142,8 +187,8 @@ class Voice : public Entity {
   uint8_t m_pitchSweep1It = 0;    /**< Current iteration of PITCHSWEEP1 controller */
   uint8_t m_pitchSweep2It = 0;    /**< Current iteration of PITCHSWEEP2 controller */
 
-  std::queue<Panning> m_panningQueue;  /**< Queue of PANNING commands */
-  std::queue<Panning> m_spanningQueue; /**< Queue of SPANNING commands */
+  PanningQueue m_panningQueue;  /**< Queue of PANNING commands */
+  PanningQueue m_spanningQueue; /**< Queue of SPANNING commands */
 
   float m_vibratoTime = -1.f;     /**< time since last VIBRATO command, -1 for no active vibrato */
   int32_t m_vibratoLevel = 0;     /**< scale of vibrato effect (in cents) */
@@ -154,36 +199,41 @@ class Voice : public Entity {
   float m_tremoloScale = 0.f;    /**< minimum volume factor produced via LFO */
   float m_tremoloModScale = 0.f; /**< minimum volume factor produced via LFO, scaled via mod wheel */
 
-  std::array<float, 2> m_lfoPeriods{};      /**< time-periods for LFO1 and LFO2 */
-  std::unique_ptr<int8_t[]> m_ctrlValsSelf; /**< Self-owned MIDI Controller values */
-  int8_t* m_extCtrlVals = nullptr;          /**< MIDI Controller values (external storage) */
+  std::array<float, 2> m_lfoPeriods{};       /**< time-periods for LFO1 and LFO2 */
+  std::array<int8_t, 128> m_ctrlValsSelf{}; /**< Self-owned MIDI Controller values */
+  int8_t* m_extCtrlVals = nullptr;           /**< MIDI Controller values (external storage) */
 
   uint16_t m_rpn = 0; /**< Current RPN (only pitch-range 0x0000 supported) */
 
   void _destroy();
   bool _checkSamplePos(bool& looped);
+  const unsigned char* _sampleBytes(size_t offset, size_t& avail);
   void _doKeyOff();
   void _macroKeyOff();
+  void _keyOffNow();
   void _macroSampleEnd();
-  void _procSamplePre(int16_t& samp);
+  float _advanceLevel(double dt, float adsr);
+  void _procSamplesPre(int16_t* data, size_t count);
+  void _renderSamples(size_t samples, int16_t* data);
   VolumeCache m_masterCache;
-  template <typename T>
-  T _procSampleMaster(double time, T samp);
   VolumeCache m_auxACache;
-  template <typename T>
-  T _procSampleAuxA(double time, T samp);
   VolumeCache m_auxBCache;
+  std::array<float, 3> m_busGains{};     /**< Master/AuxA/AuxB gains reached at the end of the last routed block */
+  std::array<bool, 3> m_busGainsValid{}; /**< Bus gain has been evaluated at least once */
+  float _evaluateBusGain(int bus, double time);
   template <typename T>
-  T _procSampleAuxB(double time, T samp);
+  void _routeAudio(size_t frames, double dt, int busId, const T* in, T* out);
   void _setTotalPitch(int32_t cents, bool slew);
   bool _isRecursivelyDead();
   void _bringOutYourDead();
+  bool _isBudgeted() const { return !m_destroyed && m_voxState != VoiceState::Dead && !m_stolen; }
+  void _steal();
   static uint32_t _GetBlockSampleCount(SampleFormat fmt);
   ObjToken<Voice> _findVoice(int vid, ObjToken<Voice> thisPtr);
-  std::unique_ptr<int8_t[]>& _ensureCtrlVals();
 
-  std::list<ObjToken<Voice>>::iterator _allocateVoice(double sampleRate, bool dynamicPitch);
-  std::list<ObjToken<Voice>>::iterator _destroyVoice(std::list<ObjToken<Voice>>::iterator it);
+  ObjToken<Voice> _allocateVoice(double sampleRate, bool dynamicPitch, const VoiceBudget& budget);
+  std::vector<ObjToken<Voice>>::iterator _destroyVoice(std::vector<ObjToken<Voice>>::iterator it);
+  void _destroyVoice(Voice* vox);
 
   bool _loadSoundMacro(SoundMacroId id, const SoundMacro* macroData, int macroStep, double ticksPerSec, uint8_t midiKey,
                        uint8_t midiVel, uint8_t midiMod, bool pushPc = false);
@@ -192,7 +242,7 @@ class Voice : public Entity {
   bool _loadLayer(const std::vector<LayerMapping>& layer, double ticksPerSec, uint8_t midiKey, uint8_t midiVel,
                   uint8_t midiMod, bool pushPc = false);
   ObjToken<Voice> _startChildMacro(ObjectId macroId, int macroStep, double ticksPerSec, uint8_t midiKey,
-                                   uint8_t midiVel, uint8_t midiMod, bool pushPc = false);
+                                   uint8_t midiVel, uint8_t midiMod, bool pushPc, const VoiceBudget& budget);
 
   std::array<float, 8> _panLaw(float frontPan, float backPan, float totalSpan) const;
   void _setPan(float pan);
@@ -202,6 +252,11 @@ class Voice : public Entity {
   void _notifyCtrlChange(uint8_t ctrl, int8_t val);
 
 public:
+  /** Voices are carved from their Engine's slab pool to keep note-on off the system heap */
+  static void* operator new(size_t size, Engine& engine);
+  static void operator delete(void* ptr, Engine& engine) noexcept;
+  static void operator delete(void* ptr) noexcept;
+
   ~Voice() override;
   Voice(Engine& engine, const AudioGroup& group, GroupId groupId, int vid, bool emitter, ObjToken<Studio> studio);
   Voice(Engine& engine, const AudioGroup& group, GroupId groupId, ObjectId oid, int vid, bool emitter,
@@ -212,7 +267,7 @@ public:
   void preSupplyAudio(double dt);
 
   /** Request specified count of audio frames (samples) from voice,
-   *  internally advancing the voice stream */
+   *  internally advancing the voice stream (starts and keyoffs placed inside the block land on their frame) */
   size_t supplyAudio(size_t frames, int16_t* data);
 
   /** Called three times after resampling supplyAudio output, voice should
@@ -230,6 +285,12 @@ public:
   /** Get VoiceId of this voice (unique to all currently-playing voices) */
   int vid() const { return m_vid; }
 
+  /** Get stealing priority of this voice (higher survives longer) */
+  uint8_t getPriority() const { return m_priority; }
+
+  /** Returns true if voice was stolen for a newer voice and is fading out */
+  bool isStolen() const { return m_stolen; }
+
   /** Get max VoiceId of this voice and any contained children */
   int maxVid() const;
 
@@ -348,27 +409,23 @@ public:
 
   /** Get MIDI Controller value on voice */
   int8_t getCtrlValue(uint8_t ctrl) const {
-    if (!m_extCtrlVals) {
-      if (m_ctrlValsSelf)
-        return m_ctrlValsSelf[ctrl];
-      return 0;
-    }
+    if (!m_extCtrlVals)
+      return m_ctrlValsSelf[ctrl];
     return m_extCtrlVals[ctrl];
   }
 
   /** Set MIDI Controller value on voice */
   void setCtrlValue(uint8_t ctrl, int8_t val) {
-    if (!m_extCtrlVals) {
-      std::unique_ptr<int8_t[]>& vals = _ensureCtrlVals();
-      vals[ctrl] = val;
-    } else
+    if (!m_extCtrlVals)
+      m_ctrlValsSelf[ctrl] = val;
+    else
       m_extCtrlVals[ctrl] = val;
     _notifyCtrlChange(ctrl, val);
   }
 
   /** 'install' external MIDI controller storage */
   void installCtrlValues(int8_t* cvs) {
-    m_ctrlValsSelf.reset();
+    m_ctrlValsSelf.fill(0);
     m_extCtrlVals = cvs;
     for (ObjToken<Voice>& vox : m_childVoices)
       vox->installCtrlValues(cvs);
@@ -389,4 +446,6 @@ public:
   /** Recursively mark voice as dead for Engine to deallocate on next cycle */
   void kill();
 };
+
+using VoicePool = SlabAllocator<sizeof(Voice), alignof(Voice)>;
 } // namespace amuse
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace amuse {
 float LookupVolume(float vol);
 float LookupDLSVolume(float vol);
+
+/** Scale samples by per-sample gains, truncating and saturating to 16 bits */
+void ApplyGains(int16_t* data, const float* gains, size_t count);
 } // namespace amuse
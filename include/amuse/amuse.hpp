@@ -13,6 +13,7 @@
 #include "amuse/Engine.hpp"
 #include "amuse/Envelope.hpp"
 #include "amuse/Listener.hpp"
+#include "amuse/OfflineBackend.hpp"
 #include "amuse/Sequencer.hpp"
 #include "amuse/SoundMacroState.hpp"
 #include "amuse/SongConverter.hpp"
@@ -18,6 +18,19 @@ void AudioGroup::assign(const AudioGroupData& data) {
   m_proj = AudioGroupProject::CreateAudioGroupProject(data);
   m_sdir = AudioGroupSampleDirectory::CreateAudioGroupSampleDirectory(data);
   m_samp = data.getSamp();
+  m_streamer.reset();
+  if (!m_samp && data.getSampleProvider())
+    setSampleProvider(data.getSampleProvider());
+
+  /* Index DSP seek points while loading; voices starting mid-sample only ever read finished tables.
+   * Streamed groups are indexed by the streamer's I/O thread instead. */
+  if (m_samp) {
+    for (const auto& p : m_sdir.m_entries) {
+      const SampleEntryData& entry = *p.second->m_data;
+      if (entry.needsDSPSeekTable())
+        entry.buildDSPSeekTable([&](uint32_t b) { return m_samp + entry.m_sampleOff + 8 * b; });
+    }
+  }
 }
 void AudioGroup::assign(SystemStringView groupPath) {
   /* Reverse order when loading intermediates */
@@ -26,6 +39,7 @@ void AudioGroup::assign(SystemStringView groupPath) {
   m_pool = AudioGroupPool::CreateAudioGroupPool(groupPath);
   m_proj = AudioGroupProject::CreateAudioGroupProject(groupPath);
   m_samp = nullptr;
+  m_streamer.reset();
 }
 void AudioGroup::assign(const AudioGroup& data, SystemStringView groupPath) {
   /* Reverse order when loading intermediates */
@@ -34,6 +48,28 @@ void AudioGroup::assign(const AudioGroup& data, SystemStringView groupPath) {
   m_pool = AudioGroupPool::CreateAudioGroupPool(groupPath);
   m_proj = AudioGroupProject::CreateAudioGroupProject(data.getProj());
   m_samp = nullptr;
+  m_streamer.reset();
+}
+
+void AudioGroup::setSampleProvider(std::shared_ptr<ISampleProvider> provider, size_t headBytes, size_t segmentBytes,
+                                   size_t streamCount) {
+  if (!provider) {
+    m_streamer.reset();
+    return;
+  }
+
+  /* N64 codebooks live at the head of each sample and could not be read without SAMP */
+  for (auto& p : m_sdir.m_entries) {
+    SampleEntryData& data = *p.second->m_data;
+    if (data.getSampleFormat() == SampleFormat::N64 && !data.m_looseData) {
+      if (provider->read(data.m_sampleOff, sizeof(AudioGroupSampleDirectory::ADPCMParms::VADPCMParms),
+                         reinterpret_cast<unsigned char*>(&data.m_ADPCMParms)) ==
+          sizeof(AudioGroupSampleDirectory::ADPCMParms::VADPCMParms))
+        data.m_ADPCMParms.swapBigVADPCM();
+    }
+  }
+
+  m_streamer = std::make_shared<SampleStreamer>(std::move(provider), m_sdir, headBytes, segmentBytes, streamCount);
 }
 
 const SampleEntry* AudioGroup::getSample(SampleId sfxId) const {
@@ -58,9 +94,17 @@ std::pair<ObjToken<SampleEntryData>, const unsigned char*> AudioGroup::getSample
     const_cast<SampleEntry*>(sample)->loadLooseData(basePath);
     return {sample->m_data, sample->m_data->m_looseData.get()};
   }
+  if (m_streamer)
+    return {sample->m_data, m_streamer->residentData(sfxId, *sample->m_data)};
   return {sample->m_data, m_samp + sample->m_data->m_sampleOff};
 }
 
+ObjToken<SampleStream> AudioGroup::openSampleStream(SampleId sfxId, const SampleEntry* sample) const {
+  if (!m_streamer || sample->m_data->m_looseData)
+    return {};
+  return m_streamer->openStream(sfxId, *sample->m_data);
+}
+
 SampleFileState AudioGroup::getSampleFileState(SampleId sfxId, const SampleEntry* sample, SystemString* pathOut) const {
   if (sample->m_data->m_looseData) {
     SystemString basePath = getSampleBasePath(sfxId);
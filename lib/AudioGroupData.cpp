@@ -1,5 +1,8 @@
 #include "amuse/AudioGroupData.hpp"
 
+#include "amuse/MemoryMappedFile.hpp"
+#include "amuse/SampleStream.hpp"
+
 namespace amuse {
 
 IntrusiveAudioGroupData::~IntrusiveAudioGroupData() {
@@ -16,6 +19,8 @@ IntrusiveAudioGroupData::IntrusiveAudioGroupData(IntrusiveAudioGroupData&& other
                  other.m_sampSz, other.m_fmt, other.m_absOffs) {
   m_owns = other.m_owns;
   other.m_owns = false;
+  m_mappings = std::move(other.m_mappings);
+  m_sampProvider = std::move(other.m_sampProvider);
 }
 
 IntrusiveAudioGroupData& IntrusiveAudioGroupData::operator=(IntrusiveAudioGroupData&& other) noexcept {
@@ -28,11 +33,17 @@ IntrusiveAudioGroupData& IntrusiveAudioGroupData::operator=(IntrusiveAudioGroupD
 
   m_owns = other.m_owns;
   other.m_owns = false;
+  m_mappings = std::move(other.m_mappings);
+  m_sampProvider = std::move(other.m_sampProvider);
 
   m_proj = other.m_proj;
+  m_projSz = other.m_projSz;
   m_pool = other.m_pool;
+  m_poolSz = other.m_poolSz;
   m_sdir = other.m_sdir;
+  m_sdirSz = other.m_sdirSz;
   m_samp = other.m_samp;
+  m_sampSz = other.m_sampSz;
   m_fmt = other.m_fmt;
   m_absOffs = other.m_absOffs;
 
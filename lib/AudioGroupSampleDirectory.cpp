@@ -80,6 +80,10 @@ AudioGroupSampleDirectory::AudioGroupSampleDirectory(athena::io::IStreamReader&
     }
   }
 
+  /* Streamed groups read codebooks through their sample provider instead */
+  if (!sampData)
+    return;
+
   for (auto& p : m_entries) {
     memcpy(&p.second->m_data->m_ADPCMParms, sampData + p.second->m_data->m_sampleOff, sizeof(ADPCMParms::VADPCMParms));
     p.second->m_data->m_ADPCMParms.swapBigVADPCM();
@@ -143,10 +147,9 @@ void AudioGroupSampleDirectory::EntryData::setLoopStartSample(atUint32 sample) {
   if (m_looseData && isFormatDSP()) {
     uint32_t block = m_loopStartSample / 14;
     uint32_t rem = m_loopStartSample % 14;
-    int16_t prev1 = 0;
-    int16_t prev2 = 0;
-    for (uint32_t b = 0; b < block; ++b)
-      DSPDecompressFrameStateOnly(m_looseData.get() + 8 * b, m_ADPCMParms.dsp.m_coefs, &prev1, &prev2, 14);
+    int16_t prev1;
+    int16_t prev2;
+    seekDSP(block, prev1, prev2, [this](uint32_t b) { return m_looseData.get() + 8 * b; });
     if (rem)
       DSPDecompressFrameStateOnly(m_looseData.get() + 8 * block, m_ADPCMParms.dsp.m_coefs, &prev1, &prev2, rem);
     m_ADPCMParms.dsp.m_hist1 = prev1;
@@ -178,6 +181,10 @@ void AudioGroupSampleDirectory::EntryData::loadLooseDSP(SystemStringView dspPath
     uint32_t dataLen = (header.x4_num_nibbles + 1) / 2;
     m_looseData.reset(new uint8_t[dataLen]);
     r.readUBytesToBuf(m_looseData.get(), dataLen);
+
+    /* Index seek points while the data is fresh, so playback never decodes the whole sample */
+    if (needsDSPSeekTable() && dataLen >= (getNumSamples() + 13) / 14 * 8)
+      buildDSPSeekTable([this](uint32_t b) { return m_looseData.get() + 8 * b; });
   }
 }
 
@@ -875,66 +882,196 @@ void AudioGroupSampleDirectory::reloadSampleData(SystemStringView groupPath) {
   }
 }
 
+/** Ties a .dsp file to the content of the WAV it was encoded from */
+struct PackManifestEntry {
+  uint64_t m_wavHash = 0;
+  int64_t m_dspModTime = 0;
+  int64_t m_dspSize = 0;
+};
+using PackManifest = std::unordered_map<SampleId, PackManifestEntry>;
+constexpr uint32_t PackManifestMagic = 0x414d504d; /* 'AMPM' */
+
+static PackManifest ReadPackManifest(SystemStringView path) {
+  PackManifest ret;
+  athena::io::FileReader r(path, 32 * 1024, false);
+  if (r.hasError() || r.readUint32Big() != PackManifestMagic)
+    return ret;
+  const uint32_t count = r.readUint32Big();
+  ret.reserve(count);
+  for (uint32_t i = 0; i < count && !r.hasError(); ++i) {
+    const SampleId id = r.readUint16Big();
+    PackManifestEntry& ent = ret[id];
+    ent.m_wavHash = r.readUint64Big();
+    ent.m_dspModTime = int64_t(r.readUint64Big());
+    ent.m_dspSize = int64_t(r.readUint64Big());
+  }
+  return ret;
+}
+
+static void WritePackManifest(SystemStringView path, const PackManifest& manifest) {
+  athena::io::FileWriter w(path);
+  if (w.hasError())
+    return;
+  w.writeUint32Big(PackManifestMagic);
+  w.writeUint32Big(uint32_t(manifest.size()));
+  for (const auto& [id, ent] : SortUnorderedMap(manifest)) {
+    w.writeUint16Big(id.id);
+    w.writeUint64Big(ent.get().m_wavHash);
+    w.writeUint64Big(uint64_t(ent.get().m_dspModTime));
+    w.writeUint64Big(uint64_t(ent.get().m_dspSize));
+  }
+}
+
+/* FNV-1a over a file's contents; timestamps alone re-encode after every checkout or copy */
+static bool HashFile(const SystemChar* path, uint64_t& hashOut) {
+  FILE* fp = FOpen(path, _SYS_STR("rb"));
+  if (!fp)
+    return false;
+  std::vector<uint8_t> buf(65536);
+  uint64_t hash = 0xcbf29ce484222325;
+  size_t read;
+  while ((read = fread(buf.data(), 1, buf.size(), fp)) != 0)
+    for (size_t i = 0; i < read; ++i)
+      hash = (hash ^ buf[i]) * 0x100000001b3;
+  fclose(fp);
+  hashOut = hash;
+  return true;
+}
+
 std::pair<std::vector<uint8_t>, std::vector<uint8_t>>
 AudioGroupSampleDirectory::toGCNData(const AudioGroupDatabase& group) const {
   constexpr athena::Endian DNAE = athena::Endian::Big;
 
-  athena::io::VectorWriter fo;
-  athena::io::VectorWriter sfo;
+  const bool useManifest = !group.m_groupPath.empty();
+  const SystemString manifestPath = group.m_groupPath + _SYS_STR("/!samples.manifest");
+  const PackManifest manifest = useManifest ? ReadPackManifest(manifestPath) : PackManifest();
 
-  std::vector<std::pair<EntryDNA<DNAE>, ADPCMParms>> entries;
-  entries.reserve(m_entries.size());
-  size_t sampleOffset = 0;
-  size_t adpcmOffset = 0;
+  /* Plan serially in ID order; cache slots are created here so workers never insert */
+  struct Job {
+    SampleId id;
+    const Entry* entry;
+    SystemString basePath;
+    SampleFileState state;
+    PackedSample* packed;
+    bool encoded = false;
+    bool valid = false;
+    bool hasRecord = false;
+    PackManifestEntry record;
+  };
+  std::vector<Job> jobs;
+  jobs.reserve(m_entries.size());
   for (const auto& ent : SortUnorderedMap(m_entries)) {
-    amuse::SystemString path = group.getSampleBasePath(ent.first);
-    path += _SYS_STR(".dsp");
-    SampleFileState state = group.getSampleFileState(ent.first, ent.second.get().get(), &path);
-    switch (state) {
+    Job& job = jobs.emplace_back();
+    job.id = ent.first;
+    job.entry = ent.second.get().get();
+    job.basePath = group.getSampleBasePath(ent.first);
+    job.state = group.getSampleFileState(ent.first, job.entry);
+    job.packed = &m_packCache[ent.first];
+  }
+  for (auto it = m_packCache.begin(); it != m_packCache.end();) {
+    if (m_entries.find(it->first) == m_entries.cend()) {
+      it = m_packCache.erase(it);
+      continue;
+    }
+    ++it;
+  }
+
+  /* Encode stale samples and load changed .dsp files across cores */
+  ParallelFor(jobs.size(), [&](size_t i) {
+    Job& job = jobs[i];
+    const SystemString dspPath = job.basePath + _SYS_STR(".dsp");
+    Sstat dspStat;
+    switch (job.state) {
+    case SampleFileState::WAVRecent:
+    case SampleFileState::WAVNoCompressed: {
+      uint64_t wavHash = 0;
+      const bool hashed = HashFile((job.basePath + _SYS_STR(".wav")).c_str(), wavHash);
+      auto search = manifest.find(job.id);
+      if (hashed && search != manifest.cend() && search->second.m_wavHash == wavHash &&
+          !Stat(dspPath.c_str(), &dspStat) && dspStat.st_mtime == search->second.m_dspModTime &&
+          dspStat.st_size == search->second.m_dspSize) {
+        job.record = search->second;
+        job.hasRecord = true;
+        break;
+      }
+      group.makeCompressedVersion(job.id, job.entry);
+      job.encoded = true;
+      if (hashed && !Stat(dspPath.c_str(), &dspStat)) {
+        job.record = {wavHash, int64_t(dspStat.st_mtime), int64_t(dspStat.st_size)};
+        job.hasRecord = true;
+      }
+      break;
+    }
     case SampleFileState::MemoryOnlyWAV:
     case SampleFileState::MemoryOnlyCompressed:
-    case SampleFileState::WAVRecent:
-    case SampleFileState::WAVNoCompressed:
-      group.makeCompressedVersion(ent.first, ent.second.get().get());
+      group.makeCompressedVersion(job.id, job.entry);
+      job.encoded = true;
       break;
     default:
       break;
     }
 
-    athena::io::FileReader r(path);
-    if (!r.hasError()) {
-      EntryDNA<DNAE> entryDNA = ent.second.get()->toDNA<DNAE>(ent.first);
+    if (Stat(dspPath.c_str(), &dspStat) || !S_ISREG(dspStat.st_mode))
+      return;
 
-      DSPADPCMHeader header;
-      header.read(r);
-      entryDNA.m_pitch = header.m_pitch;
-      entryDNA.m_sampleRate = atUint16(header.x8_sample_rate);
-      entryDNA.m_numSamples = header.x0_num_samples;
-      if (header.xc_loop_flag) {
-        entryDNA._setLoopStartSample(DSPNibbleToSample(header.x10_loop_start_nibble));
-        entryDNA.setLoopEndSample(DSPNibbleToSample(header.x14_loop_end_nibble));
-      }
+    PackedSample& packed = *job.packed;
+    if (!job.encoded && packed.m_dspSize && packed.m_dspModTime == dspStat.st_mtime &&
+        packed.m_dspSize == dspStat.st_size) {
+      job.valid = true;
+      return;
+    }
+
+    athena::io::FileReader r(dspPath);
+    if (r.hasError())
+      return;
+    packed.m_header.read(r);
+    packed.m_data.resize((packed.m_header.x4_num_nibbles + 1) / 2);
+    r.readUBytesToBuf(packed.m_data.data(), packed.m_data.size());
+    packed.m_dspModTime = dspStat.st_mtime;
+    packed.m_dspSize = dspStat.st_size;
+    job.valid = true;
+  });
+
+  /* Write SAMP in ID order */
+  athena::io::VectorWriter fo;
+  athena::io::VectorWriter sfo;
 
-      ADPCMParms adpcmParms;
-      adpcmParms.dsp.m_bytesPerFrame = 8;
-      adpcmParms.dsp.m_ps = uint8_t(header.x3e_ps);
-      adpcmParms.dsp.m_lps = uint8_t(header.x44_loop_ps);
-      adpcmParms.dsp.m_hist1 = header.x40_hist1;
-      adpcmParms.dsp.m_hist2 = header.x42_hist2;
-      for (int i = 0; i < 8; ++i)
-        for (int j = 0; j < 2; ++j)
-          adpcmParms.dsp.m_coefs[i][j] = header.x1c_coef[i][j];
-
-      uint32_t dataLen = (header.x4_num_nibbles + 1) / 2;
-      auto dspData = r.readUBytes(dataLen);
-      sfo.writeUBytes(dspData.get(), dataLen);
-      sfo.seekAlign32();
-
-      entryDNA.m_sampleOff = sampleOffset;
-      sampleOffset += ROUND_UP_32(dataLen);
-      entryDNA.binarySize(adpcmOffset);
-      entries.emplace_back(entryDNA, adpcmParms);
+  std::vector<std::pair<EntryDNA<DNAE>, ADPCMParms>> entries;
+  entries.reserve(jobs.size());
+  size_t sampleOffset = 0;
+  size_t adpcmOffset = 0;
+  for (const Job& job : jobs) {
+    if (!job.valid)
+      continue;
+
+    const DSPADPCMHeader& header = job.packed->m_header;
+    EntryDNA<DNAE> entryDNA = job.entry->toDNA<DNAE>(job.id);
+    entryDNA.m_pitch = header.m_pitch;
+    entryDNA.m_sampleRate = atUint16(header.x8_sample_rate);
+    entryDNA.m_numSamples = header.x0_num_samples;
+    if (header.xc_loop_flag) {
+      entryDNA._setLoopStartSample(DSPNibbleToSample(header.x10_loop_start_nibble));
+      entryDNA.setLoopEndSample(DSPNibbleToSample(header.x14_loop_end_nibble));
     }
+
+    ADPCMParms adpcmParms;
+    adpcmParms.dsp.m_bytesPerFrame = 8;
+    adpcmParms.dsp.m_ps = uint8_t(header.x3e_ps);
+    adpcmParms.dsp.m_lps = uint8_t(header.x44_loop_ps);
+    adpcmParms.dsp.m_hist1 = header.x40_hist1;
+    adpcmParms.dsp.m_hist2 = header.x42_hist2;
+    for (int i = 0; i < 8; ++i)
+      for (int j = 0; j < 2; ++j)
+        adpcmParms.dsp.m_coefs[i][j] = header.x1c_coef[i][j];
+
+    const std::vector<uint8_t>& dspData = job.packed->m_data;
+    sfo.writeUBytes(dspData.data(), dspData.size());
+    sfo.seekAlign32();
+
+    entryDNA.m_sampleOff = sampleOffset;
+    sampleOffset += ROUND_UP_32(dspData.size());
+    entryDNA.binarySize(adpcmOffset);
+    entries.emplace_back(entryDNA, adpcmParms);
   }
   adpcmOffset += 4;
 
@@ -951,6 +1088,18 @@ AudioGroupSampleDirectory::toGCNData(const AudioGroupDatabase& group) const {
     fo.writeUBytes((uint8_t*)&p.second, sizeof(ADPCMParms::DSPParms));
   }
 
+  if (useManifest) {
+    /* Records stay valid while their .dsp is untouched; they are re-checked against it on use */
+    PackManifest newManifest;
+    for (const Job& job : jobs) {
+      if (job.hasRecord)
+        newManifest[job.id] = job.record;
+      else if (auto search = manifest.find(job.id); search != manifest.cend())
+        newManifest[job.id] = search->second;
+    }
+    WritePackManifest(manifestPath, newManifest);
+  }
+
   return {fo.data(), sfo.data()};
 }
 } // namespace amuse
@@ -1,5 +1,7 @@
 #include "amuse/BooBackend.hpp"
 
+#include <algorithm>
+
 #include "amuse/Engine.hpp"
 #include "amuse/Submix.hpp"
 #include "amuse/Voice.hpp"
@@ -29,6 +31,16 @@ void BooBackendVoice::VoiceCallback::routeAudio(size_t frames, size_t channels,
   m_parent.m_clientVox.routeAudio(frames, dt, busId, in, out);
 }
 
+void* BooBackendVoice::operator new(size_t size, BooBackendVoiceAllocator& root) {
+  return root.m_voicePool->allocate();
+}
+
+void BooBackendVoice::operator delete(void* ptr, BooBackendVoiceAllocator& root) noexcept {
+  BooVoicePool::Deallocate(ptr);
+}
+
+void BooBackendVoice::operator delete(void* ptr) noexcept { BooVoicePool::Deallocate(ptr); }
+
 BooBackendVoice::BooBackendVoice(boo::IAudioVoiceEngine& engine, Voice& clientVox, double sampleRate, bool dynamicPitch)
 : m_clientVox(clientVox), m_cb(*this), m_booVoice(engine.allocateNewMonoVoice(sampleRate, &m_cb, dynamicPitch)) {}
 
@@ -84,6 +96,7 @@ BooBackendMIDIReader::~BooBackendMIDIReader() {}
 
 BooBackendMIDIReader::BooBackendMIDIReader(Engine& engine, bool useLock)
 : m_engine(engine), m_decoder(*this), m_useLock(useLock) {
+  m_decodeBuf.reserve(QueuedMessage::MaxBytes);
   BooBackendVoiceAllocator& voxAlloc = static_cast<BooBackendVoiceAllocator&>(engine.getBackend());
   auto devices = voxAlloc.m_booEngine.enumerateMIDIInputs();
   for (const auto& dev : devices) {
@@ -127,7 +140,18 @@ void BooBackendMIDIReader::_MIDIReceive(std::vector<uint8_t>&& bytes, double tim
   std::unique_lock<std::mutex> lk(m_midiMutex, std::defer_lock_t{});
   if (m_useLock)
     lk.lock();
-  m_queue.emplace_back(time, std::move(bytes));
+
+  const size_t head = m_queueHead.load(std::memory_order_relaxed);
+  if (bytes.size() > QueuedMessage::MaxBytes || head - m_queueTail.load(std::memory_order_acquire) == QueueCapacity) {
+    m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  QueuedMessage& msg = m_queue[head & (QueueCapacity - 1)];
+  msg.m_time = time;
+  msg.m_size = uint8_t(bytes.size());
+  std::copy(bytes.cbegin(), bytes.cend(), msg.m_bytes.begin());
+  m_queueHead.store(head + 1, std::memory_order_release);
 #if 0
     openlog("LogIt", (LOG_CONS|LOG_PERROR|LOG_PID), LOG_DAEMON);
     syslog(LOG_EMERG, "MIDI receive %f\n", time);
@@ -136,40 +160,37 @@ void BooBackendMIDIReader::_MIDIReceive(std::vector<uint8_t>&& bytes, double tim
 }
 
 void BooBackendMIDIReader::pumpReader(double dt) {
+  const double period = dt;
   dt += 0.001; /* Add 1ms to ensure consumer keeps up with producer */
 
-  std::unique_lock<std::mutex> lk(m_midiMutex, std::defer_lock_t{});
-  if (m_useLock)
-    lk.lock();
-  if (m_queue.empty())
+  const size_t head = m_queueHead.load(std::memory_order_acquire);
+  size_t tail = m_queueTail.load(std::memory_order_relaxed);
+  if (tail == head)
     return;
 
-  /* Determine range of buffer updates within this period */
-  auto periodEnd = m_queue.cbegin();
-  double startPt = m_queue.front().first;
-  for (; periodEnd != m_queue.cend(); ++periodEnd) {
-    double delta = periodEnd->first - startPt;
-    if (delta > dt)
+  /* Dispatch messages within this period of the oldest queued one */
+  const double startPt = m_queue[tail & (QueueCapacity - 1)].m_time;
+  for (; tail != head; ++tail) {
+    const QueuedMessage& msg = m_queue[tail & (QueueCapacity - 1)];
+    if (msg.m_time - startPt > dt)
       break;
-  }
-
-  if (m_queue.cbegin() == periodEnd)
-    return;
-
-  /* Dispatch buffers */
-  for (auto it = m_queue.begin(); it != periodEnd;) {
 #if 0
         char str[64];
-        sprintf(str, "MIDI %zu %f ", it->second.size(), it->first);
-        for (uint8_t byte : it->second)
-            sprintf(str + strlen(str), "%02X ", byte);
+        sprintf(str, "MIDI %u %f ", msg.m_size, msg.m_time);
+        for (uint8_t i = 0; i < msg.m_size; ++i)
+            sprintf(str + strlen(str), "%02X ", msg.m_bytes[i]);
         openlog("LogIt", (LOG_CONS|LOG_PERROR|LOG_PID), LOG_DAEMON);
         syslog(LOG_EMERG, "%s\n", str);
         closelog();
 #endif
-    m_decoder.receiveBytes(it->second.cbegin(), it->second.cend());
-    it = m_queue.erase(it);
+    /* Keep message spacing within the period rather than starting every event on its first frame */
+    m_engine.setEventOffset(std::clamp(msg.m_time - startPt, 0.0, period));
+    m_decodeBuf.assign(msg.m_bytes.cbegin(), msg.m_bytes.cbegin() + msg.m_size);
+    m_decoder.receiveBytes(m_decodeBuf.cbegin(), m_decodeBuf.cend());
   }
+
+  /* Hand the slots back to the MIDI threads */
+  m_queueTail.store(tail, std::memory_order_release);
 }
 
 void BooBackendMIDIReader::noteOff(uint8_t chan, uint8_t key, uint8_t velocity) {
@@ -253,7 +274,8 @@ BooBackendVoiceAllocator::BooBackendVoiceAllocator(boo::IAudioVoiceEngine& booEn
 
 std::unique_ptr<IBackendVoice> BooBackendVoiceAllocator::allocateVoice(Voice& clientVox, double sampleRate,
                                                                        bool dynamicPitch) {
-  return std::make_unique<BooBackendVoice>(m_booEngine, clientVox, sampleRate, dynamicPitch);
+  return std::unique_ptr<IBackendVoice>(
+      new (*this) BooBackendVoice(m_booEngine, clientVox, sampleRate, dynamicPitch));
 }
 
 std::unique_ptr<IBackendSubmix> BooBackendVoiceAllocator::allocateSubmix(Submix& clientSmx, bool mainOut, int busId) {
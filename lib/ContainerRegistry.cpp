@@ -1,13 +1,17 @@
 #include "amuse/ContainerRegistry.hpp"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "amuse/Common.hpp"
+#include "amuse/MemoryMappedFile.hpp"
+#include "amuse/SampleStream.hpp"
 
 #include <zlib.h>
 #include <lzokay.hpp>
@@ -227,7 +231,8 @@ static bool ValidateMP1(FILE* fp) {
   return false;
 }
 
-static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadMP1(FILE* fp) {
+static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadMP1(FILE* fp,
+                                                                            const SystemChar* streamPath = nullptr) {
   std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ret;
   FileLength(fp);
 
@@ -288,8 +293,15 @@ static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadMP1(FIL
             uint32_t sampLen;
             fread(&sampLen, 1, 4, fp);
             sampLen = SBig(sampLen);
-            std::unique_ptr<uint8_t[]> samp(new uint8_t[sampLen]);
-            fread(samp.get(), 1, sampLen, fp);
+            std::unique_ptr<uint8_t[]> samp;
+            std::shared_ptr<ISampleProvider> sampProvider;
+            if (streamPath) {
+              sampProvider = std::make_shared<FileSampleProvider>(streamPath, size_t(FTell(fp)), sampLen);
+              FSeek(fp, sampLen, SEEK_CUR);
+            } else {
+              samp.reset(new uint8_t[sampLen]);
+              fread(samp.get(), 1, sampLen, fp);
+            }
 
             uint32_t sdirLen;
             fread(&sdirLen, 1, 4, fp);
@@ -300,6 +312,7 @@ static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadMP1(FIL
             ret.emplace_back(std::move(name),
                              IntrusiveAudioGroupData{proj.release(), projLen, pool.release(), poolLen, sdir.release(),
                                                      sdirLen, samp.release(), sampLen, GCNDataTag{}});
+            ret.back().second.setSampleProvider(std::move(sampProvider));
           }
         }
         FSeek(fp, origPos, SEEK_SET);
@@ -310,6 +323,129 @@ static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadMP1(FIL
   return ret;
 }
 
+/* Bounds-checked big-endian cursor over an in-memory container */
+class MemoryCursor {
+  unsigned char* m_data;
+  size_t m_size;
+  size_t m_pos = 0;
+  bool m_error = false;
+
+public:
+  MemoryCursor(unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+
+  bool error() const { return m_error; }
+
+  void seek(size_t pos) {
+    if (pos > m_size)
+      m_error = true;
+    else
+      m_pos = pos;
+  }
+
+  void skip(size_t len) {
+    if (len > m_size - m_pos)
+      m_error = true;
+    else
+      m_pos += len;
+  }
+
+  uint16_t readUint16Big() {
+    uint16_t ret = 0;
+    if (m_size - m_pos < 2) {
+      m_error = true;
+      return ret;
+    }
+    memcpy(&ret, m_data + m_pos, 2);
+    m_pos += 2;
+    return SBig(ret);
+  }
+
+  uint32_t readUint32Big() {
+    uint32_t ret = 0;
+    if (m_size - m_pos < 4) {
+      m_error = true;
+      return ret;
+    }
+    memcpy(&ret, m_data + m_pos, 4);
+    m_pos += 4;
+    return SBig(ret);
+  }
+
+  SystemString readString() {
+    SystemString ret;
+    while (m_pos < m_size && m_data[m_pos] != 0)
+      ret.push_back(m_data[m_pos++]);
+    if (m_pos < m_size)
+      ++m_pos;
+    return ret;
+  }
+
+  /** Pointer to the next `len` bytes, advancing past them */
+  unsigned char* view(size_t len) {
+    if (len > m_size - m_pos) {
+      m_error = true;
+      return nullptr;
+    }
+    unsigned char* ret = m_data + m_pos;
+    m_pos += len;
+    return ret;
+  }
+};
+
+static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>>
+LoadMP1Mapped(const std::shared_ptr<MemoryMappedFile>& file) {
+  std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ret;
+  MemoryCursor r(file->data(), file->size());
+
+  if (r.readUint32Big() != 0x00030005)
+    return ret;
+
+  r.seek(8);
+  uint32_t nameCount = r.readUint32Big();
+  for (uint32_t i = 0; i < nameCount && !r.error(); ++i) {
+    r.skip(8);
+    r.skip(r.readUint32Big());
+  }
+
+  uint32_t resCount = r.readUint32Big();
+  for (uint32_t i = 0; i < resCount && !r.error(); ++i) {
+    r.skip(4);
+    uint32_t type = r.readUint32Big();
+    r.skip(8);
+    uint32_t offset = r.readUint32Big();
+    if (type != 0x41475343)
+      continue;
+
+    MemoryCursor res(file->data(), file->size());
+    res.seek(offset);
+    const unsigned char* testBuf = res.view(6);
+    if (!testBuf || memcmp(testBuf, "Audio/", 6))
+      continue;
+
+    res.seek(offset);
+    res.readString();
+    SystemString name = res.readString();
+
+    uint32_t poolLen = res.readUint32Big();
+    unsigned char* pool = res.view(poolLen);
+    uint32_t projLen = res.readUint32Big();
+    unsigned char* proj = res.view(projLen);
+    uint32_t sampLen = res.readUint32Big();
+    unsigned char* samp = res.view(sampLen);
+    uint32_t sdirLen = res.readUint32Big();
+    unsigned char* sdir = res.view(sdirLen);
+    if (res.error())
+      continue;
+
+    ret.emplace_back(std::move(name),
+                     IntrusiveAudioGroupData{
+                         AudioGroupData{proj, projLen, pool, poolLen, sdir, sdirLen, samp, sampLen, GCNDataTag{}},
+                         {file}});
+  }
+
+  return ret;
+}
+
 static bool ValidateMP1Songs(FILE* fp) {
   if (FileLength(fp) > 40 * 1024 * 1024)
     return false;
@@ -504,124 +640,298 @@ static bool ValidateMP2(FILE* fp) {
   return false;
 }
 
-static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadMP2(FILE* fp) {
-  std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ret;
-  FileLength(fp);
+/* One AGSC resource located by the MP2 index pass */
+struct MP2Resource {
+  bool compressed;
+  uint32_t size;
+  uint32_t offset;
+};
+
+/* Reads an MP2 AGSC resource body: version, name and the four chunk sizes followed by the chunks */
+static bool ReadMP2AGSC(MemoryCursor& r, SystemString& name, unsigned char* (&chunks)[4], uint32_t (&sizes)[4]) {
+  if (r.readUint32Big() != 0x1)
+    return false;
+
+  name = r.readString();
+  r.skip(2);
+  for (uint32_t& size : sizes)
+    size = r.readUint32Big();
+  for (int c = 0; c < 4; ++c)
+    chunks[c] = r.view(sizes[c]);
+
+  return !r.error() && sizes[0] && sizes[1] && sizes[2] && sizes[3];
+}
+
+/* Inflates an LZO-compressed MP2 resource body; returns null on truncated or corrupt data */
+static std::unique_ptr<uint8_t[]> InflateMP2Resource(MemoryCursor& r, uint32_t& decompSz) {
+  decompSz = r.readUint32Big();
+  if (r.error())
+    return {};
+
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[decompSz]);
+  uint8_t* bufCur = buf.get();
+  uint32_t rem = decompSz;
+  while (rem && !r.error()) {
+    uint16_t chunkSz = r.readUint16Big();
+    const unsigned char* compBuf = r.view(chunkSz);
+    if (!compBuf)
+      break;
+    size_t dsz = 0;
+    lzokay::decompress(compBuf, chunkSz, bufCur, rem, dsz);
+    if (!dsz)
+      break;
+    bufCur += dsz;
+    rem -= dsz;
+  }
+  if (rem)
+    return {};
+
+  return buf;
+}
+
+/* Inflates a compressed AGSC and copies its chunks out; pool, proj, sdir, samp order */
+static bool InflateMP2AGSC(MemoryCursor& r, SystemString& name, std::unique_ptr<uint8_t[]> (&chunks)[4],
+                           uint32_t (&sizes)[4], bool& isAGSC) {
+  uint32_t decompSz;
+  std::unique_ptr<uint8_t[]> buf = InflateMP2Resource(r, decompSz);
+  if (!buf)
+    return false;
+
+  MemoryCursor dec(buf.get(), decompSz);
+  isAGSC = dec.readUint32Big() == 0x1;
+  dec.seek(0);
+
+  unsigned char* views[4];
+  if (!ReadMP2AGSC(dec, name, views, sizes))
+    return false;
+
+  for (int c = 0; c < 4; ++c) {
+    chunks[c].reset(new uint8_t[sizes[c]]);
+    memmove(chunks[c].get(), views[c], sizes[c]);
+  }
+  return true;
+}
+
+/* Index pass over the resource table, collecting every AGSC resource in table order */
+static std::vector<MP2Resource> IndexMP2(FILE* fp) {
+  std::vector<MP2Resource> ret;
 
   uint32_t magic;
   fread(&magic, 1, 4, fp);
   magic = SBig(magic);
+  if (magic != 0x00030005)
+    return ret;
 
-  if (magic == 0x00030005) {
-    FSeek(fp, 8, SEEK_SET);
+  FSeek(fp, 8, SEEK_SET);
+
+  uint32_t nameCount;
+  fread(&nameCount, 1, 4, fp);
+  nameCount = SBig(nameCount);
+  for (uint32_t i = 0; i < nameCount; ++i) {
+    FSeek(fp, 8, SEEK_CUR);
+    uint32_t nameLen;
+    fread(&nameLen, 1, 4, fp);
+    nameLen = SBig(nameLen);
+    FSeek(fp, nameLen, SEEK_CUR);
+  }
 
-    uint32_t nameCount;
-    fread(&nameCount, 1, 4, fp);
-    nameCount = SBig(nameCount);
-    for (uint32_t i = 0; i < nameCount; ++i) {
-      FSeek(fp, 8, SEEK_CUR);
-      uint32_t nameLen;
-      fread(&nameLen, 1, 4, fp);
-      nameLen = SBig(nameLen);
-      FSeek(fp, nameLen, SEEK_CUR);
-    }
+  uint32_t resCount;
+  fread(&resCount, 1, 4, fp);
+  resCount = SBig(resCount);
+  for (uint32_t i = 0; i < resCount; ++i) {
+    uint32_t compressed;
+    fread(&compressed, 1, 4, fp);
+    uint32_t type;
+    fread(&type, 1, 4, fp);
+    type = SBig(type);
+    FSeek(fp, 4, SEEK_CUR);
+    uint32_t size;
+    fread(&size, 1, 4, fp);
+    size = SBig(size);
+    uint32_t offset;
+    fread(&offset, 1, 4, fp);
+    offset = SBig(offset);
 
-    uint32_t resCount;
-    fread(&resCount, 1, 4, fp);
-    resCount = SBig(resCount);
-    ret.reserve(resCount);
-    for (uint32_t i = 0; i < resCount; ++i) {
-      uint32_t compressed;
-      fread(&compressed, 1, 4, fp);
-      uint32_t type;
-      fread(&type, 1, 4, fp);
-      type = SBig(type);
-      FSeek(fp, 8, SEEK_CUR);
-      uint32_t offset;
-      fread(&offset, 1, 4, fp);
-      offset = SBig(offset);
+    if (type == 0x41475343)
+      ret.push_back({compressed != 0, size, offset});
+  }
 
-      if (type == 0x41475343) {
-        int64_t origPos = FTell(fp);
-        FSeek(fp, offset, SEEK_SET);
-        char testBuf[4];
-        FILE* old_fp = fp;
-        if (compressed) {
-          uint32_t decompSz;
-          fread(&decompSz, 1, 4, fp);
-          decompSz = SBig(decompSz);
-          uint8_t compBuf[0x8000];
-          uint8_t* buf = new uint8_t[decompSz];
-          uint8_t* bufCur = buf;
-          uint32_t rem = decompSz;
-          while (rem) {
-            uint16_t chunkSz;
-            fread(&chunkSz, 1, 2, fp);
-            chunkSz = SBig(chunkSz);
-            fread(compBuf, 1, chunkSz, fp);
-            size_t dsz;
-            lzokay::decompress(compBuf, chunkSz, bufCur, rem, dsz);
-            bufCur += dsz;
-            rem -= dsz;
-          }
+  return ret;
+}
 
-          fp = FOpen(_SYS_STR("amuse_tmp.dat"), _SYS_STR("rw"));
-          rewind(fp);
-          fwrite(buf, 1, decompSz, fp);
-          rewind(fp);
-        }
-        if (fread(testBuf, 1, 4, fp) == 4) {
-          if (amuse::SBig(*reinterpret_cast<uint32_t*>(testBuf)) == 0x1) {
-            FSeek(fp, offset + 4, SEEK_SET);
-            SystemString name = ReadString(fp);
+static std::vector<MP2Resource> IndexMP2(MemoryCursor& r) {
+  std::vector<MP2Resource> ret;
+
+  if (r.readUint32Big() != 0x00030005)
+    return ret;
+
+  r.seek(8);
+  uint32_t nameCount = r.readUint32Big();
+  for (uint32_t i = 0; i < nameCount && !r.error(); ++i) {
+    r.skip(8);
+    r.skip(r.readUint32Big());
+  }
 
-            FSeek(fp, 2, SEEK_CUR);
-            uint32_t poolSz;
-            fread(&poolSz, 1, 4, fp);
-            poolSz = SBig(poolSz);
+  uint32_t resCount = r.readUint32Big();
+  for (uint32_t i = 0; i < resCount && !r.error(); ++i) {
+    uint32_t compressed = r.readUint32Big();
+    uint32_t type = r.readUint32Big();
+    r.skip(4);
+    uint32_t size = r.readUint32Big();
+    uint32_t offset = r.readUint32Big();
+    if (type == 0x41475343 && !r.error())
+      ret.push_back({compressed != 0, size, offset});
+  }
 
-            uint32_t projSz;
-            fread(&projSz, 1, 4, fp);
-            projSz = SBig(projSz);
+  return ret;
+}
 
-            uint32_t sdirSz;
-            fread(&sdirSz, 1, 4, fp);
-            sdirSz = SBig(sdirSz);
+/* Validation is folded into loading: the pak is MP2 when its first AGSC resource is version 1.
+ * Resources are read in one sequential pass, then compressed ones are inflated in parallel. */
+static bool LoadMP2(FILE* fp, std::vector<std::pair<SystemString, IntrusiveAudioGroupData>>& ret,
+                    const SystemChar* streamPath = nullptr) {
+  const size_t fileLen = FileLength(fp);
+  const std::vector<MP2Resource> resources = IndexMP2(fp);
+  if (resources.empty())
+    return false;
 
-            uint32_t sampSz;
-            fread(&sampSz, 1, 4, fp);
-            sampSz = SBig(sampSz);
+  struct Loaded {
+    SystemString name;
+    std::unique_ptr<uint8_t[]> raw;
+    size_t rawSz = 0;
+    std::unique_ptr<uint8_t[]> chunks[4];
+    uint32_t sizes[4] = {};
+    std::shared_ptr<ISampleProvider> sampProvider;
+    bool isAGSC = false;
+    bool loaded = false;
+  };
+  std::vector<Loaded> loaded(resources.size());
+
+  for (size_t i = 0; i < resources.size(); ++i) {
+    const MP2Resource& res = resources[i];
+    Loaded& out = loaded[i];
+    if (res.offset >= fileLen)
+      continue;
+    FSeek(fp, res.offset, SEEK_SET);
+
+    if (res.compressed) {
+      out.rawSz = std::min(size_t(res.size), fileLen - res.offset);
+      out.raw.reset(new uint8_t[out.rawSz]);
+      out.rawSz = fread(out.raw.get(), 1, out.rawSz, fp);
+      continue;
+    }
 
-            if (projSz && poolSz && sdirSz && sampSz) {
-              std::unique_ptr<uint8_t[]> pool(new uint8_t[poolSz]);
-              fread(pool.get(), 1, poolSz, fp);
+    uint32_t version;
+    if (fread(&version, 1, 4, fp) != 4)
+      continue;
+    out.isAGSC = SBig(version) == 0x1;
+    if (!out.isAGSC)
+      continue;
 
-              std::unique_ptr<uint8_t[]> proj(new uint8_t[projSz]);
-              fread(proj.get(), 1, projSz, fp);
+    out.name = ReadString(fp);
+    FSeek(fp, 2, SEEK_CUR);
+    for (uint32_t& size : out.sizes) {
+      fread(&size, 1, 4, fp);
+      size = SBig(size);
+    }
+    if (!out.sizes[0] || !out.sizes[1] || !out.sizes[2] || !out.sizes[3])
+      continue;
 
-              std::unique_ptr<uint8_t[]> sdir(new uint8_t[sdirSz]);
-              fread(sdir.get(), 1, sdirSz, fp);
+    for (int c = 0; c < 3; ++c) {
+      out.chunks[c].reset(new uint8_t[out.sizes[c]]);
+      fread(out.chunks[c].get(), 1, out.sizes[c], fp);
+    }
+    if (streamPath) {
+      out.sampProvider = std::make_shared<FileSampleProvider>(streamPath, size_t(FTell(fp)), out.sizes[3]);
+    } else {
+      out.chunks[3].reset(new uint8_t[out.sizes[3]]);
+      fread(out.chunks[3].get(), 1, out.sizes[3], fp);
+    }
+    out.loaded = true;
+  }
 
-              std::unique_ptr<uint8_t[]> samp(new uint8_t[sampSz]);
-              fread(samp.get(), 1, sampSz, fp);
+  ParallelFor(loaded.size(), [&](size_t i) {
+    Loaded& out = loaded[i];
+    if (!out.raw)
+      return;
+    MemoryCursor r(out.raw.get(), out.rawSz);
+    out.loaded = InflateMP2AGSC(r, out.name, out.chunks, out.sizes, out.isAGSC);
+    out.raw.reset();
+  });
 
-              ret.emplace_back(std::move(name),
-                               IntrusiveAudioGroupData{proj.release(), projSz, pool.release(), poolSz, sdir.release(),
-                                                       sdirSz, samp.release(), sampSz, GCNDataTag{}});
-            }
-          }
-        }
-        if (compressed) {
-          fclose(fp);
-          Unlink(_SYS_STR("amuse_tmp.dat"));
-        }
-        fp = old_fp;
-        FSeek(fp, origPos, SEEK_SET);
-      }
+  if (!loaded.front().isAGSC)
+    return false;
+
+  ret.reserve(loaded.size());
+  for (Loaded& out : loaded) {
+    if (!out.loaded)
+      continue;
+    ret.emplace_back(std::move(out.name),
+                     IntrusiveAudioGroupData{out.chunks[1].release(), out.sizes[1], out.chunks[0].release(),
+                                             out.sizes[0], out.chunks[2].release(), out.sizes[2],
+                                             out.chunks[3].release(), out.sizes[3], GCNDataTag{}});
+    ret.back().second.setSampleProvider(std::move(out.sampProvider));
+  }
+
+  return true;
+}
+
+static bool LoadMP2Mapped(const std::shared_ptr<MemoryMappedFile>& file,
+                          std::vector<std::pair<SystemString, IntrusiveAudioGroupData>>& ret) {
+  MemoryCursor r(file->data(), file->size());
+  const std::vector<MP2Resource> resources = IndexMP2(r);
+  if (resources.empty())
+    return false;
+
+  struct Loaded {
+    SystemString name;
+    unsigned char* views[4] = {};
+    std::unique_ptr<uint8_t[]> chunks[4];
+    uint32_t sizes[4] = {};
+    bool isAGSC = false;
+    bool loaded = false;
+  };
+  std::vector<Loaded> loaded(resources.size());
+
+  ParallelFor(loaded.size(), [&](size_t i) {
+    const MP2Resource& res = resources[i];
+    Loaded& out = loaded[i];
+    MemoryCursor body(file->data(), file->size());
+    body.seek(res.offset);
+
+    /* Compressed resources must be inflated; their chunks are copied out as before */
+    if (res.compressed) {
+      out.loaded = InflateMP2AGSC(body, out.name, out.chunks, out.sizes, out.isAGSC);
+      return;
     }
+
+    out.isAGSC = body.readUint32Big() == 0x1;
+    body.seek(res.offset);
+    out.loaded = ReadMP2AGSC(body, out.name, out.views, out.sizes);
+  });
+
+  if (!loaded.front().isAGSC)
+    return false;
+
+  /* Chunk order within the resource is pool, proj, sdir, samp */
+  ret.reserve(loaded.size());
+  for (Loaded& out : loaded) {
+    if (!out.loaded)
+      continue;
+    if (out.chunks[0])
+      ret.emplace_back(std::move(out.name),
+                       IntrusiveAudioGroupData{out.chunks[1].release(), out.sizes[1], out.chunks[0].release(),
+                                               out.sizes[0], out.chunks[2].release(), out.sizes[2],
+                                               out.chunks[3].release(), out.sizes[3], GCNDataTag{}});
+    else
+      ret.emplace_back(std::move(out.name),
+                       IntrusiveAudioGroupData{AudioGroupData{out.views[1], out.sizes[1], out.views[0], out.sizes[0],
+                                                              out.views[2], out.sizes[2], out.views[3], out.sizes[3],
+                                                              GCNDataTag{}},
+                                               {file}});
   }
 
-  return ret;
+  return true;
 }
 
 struct RS1FSTEntry {
@@ -641,6 +951,49 @@ struct RS1FSTEntry {
   }
 };
 
+/* Extracts the proj, pool, sdir and samp entries (named with `suffix`) of a Factor5 FST;
+ * compressed entries are independent zlib streams and are inflated concurrently */
+static IntrusiveAudioGroupData LoadFactor5FSTGroup(const uint8_t* dataSeg, const RS1FSTEntry* entry,
+                                                   const RS1FSTEntry* lastEnt, const char* suffix, bool absOffs) {
+  static constexpr const char* ChunkNames[] = {"proj", "pool", "sdir", "samp"};
+  char names[4][16];
+  for (int c = 0; c < 4; ++c)
+    snprintf(names[c], 16, "%s%s", ChunkNames[c], suffix);
+
+  RS1FSTEntry found[4] = {};
+  bool present[4] = {};
+  for (; entry != lastEnt; ++entry) {
+    RS1FSTEntry ent = *entry;
+    ent.swapBig();
+    for (int c = 0; c < 4; ++c) {
+      if (!strncmp(names[c], ent.name, 16)) {
+        found[c] = ent;
+        present[c] = true;
+        break;
+      }
+    }
+  }
+
+  std::unique_ptr<uint8_t[]> chunks[4];
+  size_t sizes[4] = {};
+  ParallelFor(4, [&](size_t c) {
+    if (!present[c])
+      return;
+    const RS1FSTEntry& ent = found[c];
+    chunks[c].reset(new uint8_t[ent.decompSz]);
+    if (ent.compSz == 0xffffffff) {
+      memmove(chunks[c].get(), dataSeg + ent.offset, ent.decompSz);
+    } else {
+      uLongf outSz = ent.decompSz;
+      uncompress(chunks[c].get(), &outSz, dataSeg + ent.offset, ent.compSz);
+    }
+    sizes[c] = ent.decompSz;
+  });
+
+  return IntrusiveAudioGroupData{chunks[0].release(), sizes[0], chunks[1].release(), sizes[1], chunks[2].release(),
+                                 sizes[2], chunks[3].release(), sizes[3], absOffs, N64DataTag{}};
+}
+
 static void SwapN64Rom16(void* data, size_t size) {
   uint16_t* words = reinterpret_cast<uint16_t*>(data);
   for (size_t i = 0; i < size / 2; ++i)
@@ -910,65 +1263,7 @@ static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadRS1N64(
     const RS1FSTEntry* entry = reinterpret_cast<const RS1FSTEntry*>(dataSeg + fstOff);
     const RS1FSTEntry* lastEnt = reinterpret_cast<const RS1FSTEntry*>(dataSeg + fstEnd);
 
-    std::unique_ptr<uint8_t[]> proj;
-    size_t projSz = 0;
-    std::unique_ptr<uint8_t[]> pool;
-    size_t poolSz = 0;
-    std::unique_ptr<uint8_t[]> sdir;
-    size_t sdirSz = 0;
-    std::unique_ptr<uint8_t[]> samp;
-    size_t sampSz = 0;
-
-    for (; entry != lastEnt; ++entry) {
-      RS1FSTEntry ent = *entry;
-      ent.swapBig();
-
-      if (!strncmp("proj_SND", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          proj.reset(new uint8_t[ent.decompSz]);
-          memmove(proj.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          proj.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(proj.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        projSz = ent.decompSz;
-      } else if (!strncmp("pool_SND", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          pool.reset(new uint8_t[ent.decompSz]);
-          memmove(pool.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          pool.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(pool.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        poolSz = ent.decompSz;
-      } else if (!strncmp("sdir_SND", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          sdir.reset(new uint8_t[ent.decompSz]);
-          memmove(sdir.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          sdir.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(sdir.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        sdirSz = ent.decompSz;
-      } else if (!strncmp("samp_SND", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          samp.reset(new uint8_t[ent.decompSz]);
-          memmove(samp.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          samp.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(samp.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        sampSz = ent.decompSz;
-      }
-    }
-
-    ret.emplace_back(_SYS_STR("Group"),
-                     IntrusiveAudioGroupData{proj.release(), projSz, pool.release(), poolSz, sdir.release(), sdirSz,
-                                             samp.release(), sampSz, false, N64DataTag{}});
+    ret.emplace_back(_SYS_STR("Group"), LoadFactor5FSTGroup(dataSeg, entry, lastEnt, "_SND", false));
   }
 
   return ret;
@@ -1096,65 +1391,7 @@ static std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> LoadFactor5
     const RS1FSTEntry* entry = reinterpret_cast<const RS1FSTEntry*>(dataSeg + fstOff);
     const RS1FSTEntry* lastEnt = reinterpret_cast<const RS1FSTEntry*>(dataSeg + fstEnd);
 
-    std::unique_ptr<uint8_t[]> proj;
-    size_t projSz = 0;
-    std::unique_ptr<uint8_t[]> pool;
-    size_t poolSz = 0;
-    std::unique_ptr<uint8_t[]> sdir;
-    size_t sdirSz = 0;
-    std::unique_ptr<uint8_t[]> samp;
-    size_t sampSz = 0;
-
-    for (; entry != lastEnt; ++entry) {
-      RS1FSTEntry ent = *entry;
-      ent.swapBig();
-
-      if (!strncmp("proj", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          proj.reset(new uint8_t[ent.decompSz]);
-          memmove(proj.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          proj.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(proj.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        projSz = ent.decompSz;
-      } else if (!strncmp("pool", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          pool.reset(new uint8_t[ent.decompSz]);
-          memmove(pool.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          pool.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(pool.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        poolSz = ent.decompSz;
-      } else if (!strncmp("sdir", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          sdir.reset(new uint8_t[ent.decompSz]);
-          memmove(sdir.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          sdir.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(sdir.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        sdirSz = ent.decompSz;
-      } else if (!strncmp("samp", ent.name, 16)) {
-        if (ent.compSz == 0xffffffff) {
-          samp.reset(new uint8_t[ent.decompSz]);
-          memmove(samp.get(), dataSeg + ent.offset, ent.decompSz);
-        } else {
-          samp.reset(new uint8_t[ent.decompSz]);
-          uLongf outSz = ent.decompSz;
-          uncompress(samp.get(), &outSz, dataSeg + ent.offset, ent.compSz);
-        }
-        sampSz = ent.decompSz;
-      }
-    }
-
-    ret.emplace_back(_SYS_STR("Group"),
-                     IntrusiveAudioGroupData{proj.release(), projSz, pool.release(), poolSz, sdir.release(), sdirSz,
-                                             samp.release(), sampSz, true, N64DataTag{}});
+    ret.emplace_back(_SYS_STR("Group"), LoadFactor5FSTGroup(dataSeg, entry, lastEnt, "", true));
   }
 
   return ret;
@@ -1741,13 +1978,14 @@ ContainerRegistry::Type ContainerRegistry::DetectContainerType(const SystemChar*
   return Type::Invalid;
 }
 
-std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry::LoadContainer(const SystemChar* path) {
+std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry::LoadContainer(const SystemChar* path,
+                                                                                               LoadMode mode) {
   Type typeOut;
-  return LoadContainer(path, typeOut);
+  return LoadContainer(path, typeOut, mode);
 };
 
-std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry::LoadContainer(const SystemChar* path,
-                                                                                               Type& typeOut) {
+std::vector<std::pair<SystemString, IntrusiveAudioGroupData>>
+ContainerRegistry::LoadContainer(const SystemChar* path, Type& typeOut, LoadMode mode) {
   FILE* fp;
   typeOut = Type::Invalid;
 
@@ -1810,6 +2048,37 @@ std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry:
     }
     fclose(fp);
 
+    if (mode == LoadMode::MemoryMap) {
+      std::shared_ptr<MemoryMappedFile> projMap = MemoryMappedFile::Open(projPath.c_str());
+      std::shared_ptr<MemoryMappedFile> poolMap = MemoryMappedFile::Open(poolPath.c_str());
+      std::shared_ptr<MemoryMappedFile> sdirMap = MemoryMappedFile::Open(sdirPath.c_str());
+      std::shared_ptr<MemoryMappedFile> sampMap = MemoryMappedFile::Open(sampPath.c_str());
+      if (projMap && poolMap && sdirMap && sdirMap->size() >= 12 && sampMap) {
+        unsigned char* sdir = sdirMap->data();
+        std::vector<std::shared_ptr<MemoryMappedFile>> maps{projMap, poolMap, sdirMap, sampMap};
+        if (*reinterpret_cast<uint32_t*>(sdir + 8) == 0x0)
+          ret.emplace_back(baseName, IntrusiveAudioGroupData{AudioGroupData{projMap->data(), projMap->size(),
+                                                                            poolMap->data(), poolMap->size(), sdir,
+                                                                            sdirMap->size(), sampMap->data(),
+                                                                            sampMap->size(), GCNDataTag{}},
+                                                             std::move(maps)});
+        else if (sdir[9] == 0x0)
+          ret.emplace_back(baseName, IntrusiveAudioGroupData{AudioGroupData{projMap->data(), projMap->size(),
+                                                                            poolMap->data(), poolMap->size(), sdir,
+                                                                            sdirMap->size(), sampMap->data(),
+                                                                            sampMap->size(), false, N64DataTag{}},
+                                                             std::move(maps)});
+        else
+          ret.emplace_back(baseName, IntrusiveAudioGroupData{AudioGroupData{projMap->data(), projMap->size(),
+                                                                            poolMap->data(), poolMap->size(), sdir,
+                                                                            sdirMap->size(), sampMap->data(),
+                                                                            sampMap->size(), false, PCDataTag{}},
+                                                             std::move(maps)});
+        typeOut = Type::Raw4;
+        return ret;
+      }
+    }
+
     fp = FOpen(projPath.c_str(), _SYS_STR("rb"));
     size_t projLen = FileLength(fp);
     if (!projLen)
@@ -1835,8 +2104,14 @@ std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry:
     size_t sampLen = FileLength(fp);
     if (!sampLen)
       return ret;
-    std::unique_ptr<uint8_t[]> samp(new uint8_t[sampLen]);
-    fread(samp.get(), 1, sampLen, fp);
+    std::unique_ptr<uint8_t[]> samp;
+    std::shared_ptr<ISampleProvider> sampProvider;
+    if (mode == LoadMode::Stream) {
+      sampProvider = std::make_shared<FileSampleProvider>(sampPath.c_str(), 0, sampLen);
+    } else {
+      samp.reset(new uint8_t[sampLen]);
+      fread(samp.get(), 1, sampLen, fp);
+    }
 
     fclose(fp);
 
@@ -1853,6 +2128,7 @@ std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry:
       ret.emplace_back(baseName,
                        IntrusiveAudioGroupData{proj.release(), projLen, pool.release(), poolLen, sdir.release(),
                                                sdirLen, samp.release(), sampLen, false, PCDataTag{}});
+    ret.back().second.setSampleProvider(std::move(sampProvider));
 
     typeOut = Type::Raw4;
     return ret;
@@ -1862,17 +2138,31 @@ std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ContainerRegistry:
   fp = FOpen(path, _SYS_STR("rb"));
   if (fp) {
     if (ValidateMP1(fp)) {
-      auto ret = LoadMP1(fp);
+      if (mode == LoadMode::MemoryMap) {
+        if (std::shared_ptr<MemoryMappedFile> map = MemoryMappedFile::Open(path)) {
+          fclose(fp);
+          typeOut = Type::MetroidPrime;
+          return LoadMP1Mapped(map);
+        }
+      }
+      auto ret = LoadMP1(fp, mode == LoadMode::Stream ? path : nullptr);
       fclose(fp);
       typeOut = Type::MetroidPrime;
       return ret;
     }
 
-    if (ValidateMP2(fp)) {
-      auto ret = LoadMP2(fp);
-      fclose(fp);
-      typeOut = Type::MetroidPrime2;
-      return ret;
+    /* MP2 is validated while loading so compressed resources are only inflated once */
+    {
+      std::vector<std::pair<SystemString, IntrusiveAudioGroupData>> ret;
+      std::shared_ptr<MemoryMappedFile> map;
+      if (mode == LoadMode::MemoryMap)
+        map = MemoryMappedFile::Open(path);
+      if (map ? LoadMP2Mapped(map, ret) : LoadMP2(fp, ret, mode == LoadMode::Stream ? path : nullptr)) {
+        fclose(fp);
+        typeOut = Type::MetroidPrime2;
+        return ret;
+      }
+      FSeek(fp, 0, SEEK_SET);
     }
 
     if (ValidateRS1PC(fp)) {
@@ -5,38 +5,105 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
+
+#include "amuse/Common.hpp"
 
 #if __SWITCH__
 #include "switch_math.hpp"
 #endif
 
+#if __SSE2__
+#include <emmintrin.h>
+#elif __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 #undef min
 #undef max
 
 #pragma mark Decoder
 
-static const int32_t NibbleToInt[16] = {0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1};
+/* Expands the nibbles of a frame up to `lastSample` into pre-scaled, pre-rounded residuals.
+ * Only the 2-tap predictor that follows is inherently serial. */
+static void DSPUnpackFrame(int32_t out[16], const uint8_t* in, unsigned lastSample) {
+  const uint8_t exp = in[0] & 0xf;
+  const size_t byteCount = lastSample >= 14 ? 7 : (lastSample + 1) / 2;
+#if __SSE2__
+  __m128i raw;
+  if (byteCount == 7) {
+    raw = _mm_srli_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)), 1);
+  } else {
+    uint8_t bytes[8] = {};
+    std::memcpy(bytes, in + 1, byteCount);
+    raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes));
+  }
+  const __m128i lowMask = _mm_set1_epi8(0xf);
+  const __m128i hi = _mm_and_si128(_mm_srli_epi16(raw, 4), lowMask);
+  const __m128i lo = _mm_and_si128(raw, lowMask);
+  /* High nibble first; place each nibble in the top of a 16-bit lane and sign-extend */
+  const __m128i nibs = _mm_unpacklo_epi8(hi, lo);
+  const __m128i n0 = _mm_srai_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(_mm_setzero_si128(), nibs), 4), 12);
+  const __m128i n1 = _mm_srai_epi16(_mm_slli_epi16(_mm_unpackhi_epi8(_mm_setzero_si128(), nibs), 4), 12);
+  const __m128i shift = _mm_cvtsi32_si128(exp + 11);
+  const __m128i bias = _mm_set1_epi32(1024);
+  auto widen = [&](__m128i v16, bool high) {
+    const __m128i v32 = _mm_srai_epi32(high ? _mm_unpackhi_epi16(v16, v16) : _mm_unpacklo_epi16(v16, v16), 16);
+    return _mm_add_epi32(_mm_sll_epi32(v32, shift), bias);
+  };
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 0), widen(n0, false));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), widen(n0, true));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), widen(n1, false));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), widen(n1, true));
+#elif __ARM_NEON
+  uint8_t bytes[8] = {};
+  std::memcpy(bytes, in + 1, byteCount);
+  const uint8x8_t raw = vld1_u8(bytes);
+  const uint8x8x2_t nibs = vzip_u8(vshr_n_u8(raw, 4), vand_u8(raw, vdup_n_u8(0xf)));
+  int8x16_t n = vreinterpretq_s8_u8(vcombine_u8(nibs.val[0], nibs.val[1]));
+  n = vshrq_n_s8(vshlq_n_s8(n, 4), 4);
+  const int16x8_t n0 = vmovl_s8(vget_low_s8(n));
+  const int16x8_t n1 = vmovl_s8(vget_high_s8(n));
+  const int32x4_t shift = vdupq_n_s32(exp + 11);
+  const int32x4_t bias = vdupq_n_s32(1024);
+  vst1q_s32(out + 0, vaddq_s32(vshlq_s32(vmovl_s16(vget_low_s16(n0)), shift), bias));
+  vst1q_s32(out + 4, vaddq_s32(vshlq_s32(vmovl_s16(vget_high_s16(n0)), shift), bias));
+  vst1q_s32(out + 8, vaddq_s32(vshlq_s32(vmovl_s16(vget_low_s16(n1)), shift), bias));
+  vst1q_s32(out + 12, vaddq_s32(vshlq_s32(vmovl_s16(vget_high_s16(n1)), shift), bias));
+#else
+  static const int32_t NibbleToInt[16] = {0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1};
+  for (unsigned s = 0; s < 14 && s / 2 < byteCount; ++s) {
+    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
+    sampleData <<= exp;
+    sampleData <<= 11;
+    sampleData += 1024;
+    out[s] = sampleData;
+  }
+#endif
+}
 
 unsigned DSPDecompressFrame(int16_t* out, const uint8_t* in, const int16_t coefs[8][2], int16_t* prev1, int16_t* prev2,
                             unsigned lastSample) {
   uint8_t cIdx = (in[0] >> 4) & 0xf;
   int32_t factor1 = coefs[cIdx][0];
   int32_t factor2 = coefs[cIdx][1];
-  uint8_t exp = in[0] & 0xf;
+  int32_t scaled[16];
+  DSPUnpackFrame(scaled, in, lastSample);
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
   unsigned ret = 0;
   for (unsigned s = 0; s < 14 && s < lastSample; ++s) {
-    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
-    sampleData <<= exp;
-    sampleData <<= 11;
-    sampleData += 1024;
-    sampleData += factor1 * ((int32_t)(*prev1)) + factor2 * ((int32_t)(*prev2));
+    int32_t sampleData = scaled[s];
+    sampleData += factor1 * hist1 + factor2 * hist2;
     sampleData >>= 11;
     sampleData = DSPSampClamp(sampleData);
     out[s] = sampleData;
-    *prev2 = *prev1;
-    *prev1 = sampleData;
+    hist2 = hist1;
+    hist1 = sampleData;
     ++ret;
   }
+  *prev1 = hist1;
+  *prev2 = hist2;
   return ret;
 }
 
@@ -45,21 +112,23 @@ unsigned DSPDecompressFrameStereoStride(int16_t* out, const uint8_t* in, const i
   uint32_t cIdx = (in[0] >> 4) & 0xf;
   int32_t factor1 = coefs[cIdx][0];
   int32_t factor2 = coefs[cIdx][1];
-  uint32_t exp = in[0] & 0xf;
+  int32_t scaled[16];
+  DSPUnpackFrame(scaled, in, lastSample);
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
   unsigned ret = 0;
   for (unsigned s = 0; s < 14 && s < lastSample; ++s) {
-    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
-    sampleData <<= exp;
-    sampleData <<= 11;
-    sampleData += 1024;
-    sampleData += factor1 * ((int32_t)(*prev1)) + factor2 * ((int32_t)(*prev2));
+    int32_t sampleData = scaled[s];
+    sampleData += factor1 * hist1 + factor2 * hist2;
     sampleData >>= 11;
     sampleData = DSPSampClamp(sampleData);
     out[s * 2] = sampleData;
-    *prev2 = *prev1;
-    *prev1 = sampleData;
+    hist2 = hist1;
+    hist1 = sampleData;
     ++ret;
   }
+  *prev1 = hist1;
+  *prev2 = hist2;
   return ret;
 }
 
@@ -68,22 +137,24 @@ unsigned DSPDecompressFrameStereoDupe(int16_t* out, const uint8_t* in, const int
   uint8_t cIdx = (in[0] >> 4) & 0xf;
   int32_t factor1 = coefs[cIdx][0];
   int32_t factor2 = coefs[cIdx][1];
-  uint8_t exp = in[0] & 0xf;
+  int32_t scaled[16];
+  DSPUnpackFrame(scaled, in, lastSample);
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
   unsigned ret = 0;
   for (unsigned s = 0; s < 14 && s < lastSample; ++s) {
-    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
-    sampleData <<= exp;
-    sampleData <<= 11;
-    sampleData += 1024;
-    sampleData += factor1 * ((int32_t)(*prev1)) + factor2 * ((int32_t)(*prev2));
+    int32_t sampleData = scaled[s];
+    sampleData += factor1 * hist1 + factor2 * hist2;
     sampleData >>= 11;
     sampleData = DSPSampClamp(sampleData);
     out[s * 2] = sampleData;
     out[s * 2 + 1] = sampleData;
-    *prev2 = *prev1;
-    *prev1 = sampleData;
+    hist2 = hist1;
+    hist1 = sampleData;
     ++ret;
   }
+  *prev1 = hist1;
+  *prev2 = hist2;
   return ret;
 }
 
@@ -92,21 +163,23 @@ unsigned DSPDecompressFrameRanged(int16_t* out, const uint8_t* in, const int16_t
   uint8_t cIdx = (in[0] >> 4) & 0xf;
   int32_t factor1 = coefs[cIdx][0];
   int32_t factor2 = coefs[cIdx][1];
-  uint8_t exp = in[0] & 0xf;
+  int32_t scaled[16];
+  DSPUnpackFrame(scaled, in, lastSample);
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
   unsigned ret = 0;
   for (unsigned s = firstSample; s < 14 && s < lastSample; ++s) {
-    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
-    sampleData <<= exp;
-    sampleData <<= 11;
-    sampleData += 1024;
-    sampleData += factor1 * ((int32_t)(*prev1)) + factor2 * ((int32_t)(*prev2));
+    int32_t sampleData = scaled[s];
+    sampleData += factor1 * hist1 + factor2 * hist2;
     sampleData >>= 11;
     sampleData = DSPSampClamp(sampleData);
     *out++ = sampleData;
-    *prev2 = *prev1;
-    *prev1 = sampleData;
+    hist2 = hist1;
+    hist1 = sampleData;
     ++ret;
   }
+  *prev1 = hist1;
+  *prev2 = hist2;
   return ret;
 }
 
@@ -115,20 +188,22 @@ unsigned DSPDecompressFrameStateOnly(const uint8_t* in, const int16_t coefs[8][2
   uint8_t cIdx = (in[0] >> 4) & 0xf;
   int32_t factor1 = coefs[cIdx][0];
   int32_t factor2 = coefs[cIdx][1];
-  uint8_t exp = in[0] & 0xf;
+  int32_t scaled[16];
+  DSPUnpackFrame(scaled, in, lastSample);
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
   unsigned ret = 0;
   for (unsigned s = 0; s < 14 && s < lastSample; ++s) {
-    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
-    sampleData <<= exp;
-    sampleData <<= 11;
-    sampleData += 1024;
-    sampleData += factor1 * ((int32_t)(*prev1)) + factor2 * ((int32_t)(*prev2));
+    int32_t sampleData = scaled[s];
+    sampleData += factor1 * hist1 + factor2 * hist2;
     sampleData >>= 11;
     sampleData = DSPSampClamp(sampleData);
-    *prev2 = *prev1;
-    *prev1 = sampleData;
+    hist2 = hist1;
+    hist1 = sampleData;
     ++ret;
   }
+  *prev1 = hist1;
+  *prev2 = hist2;
   return ret;
 }
 
@@ -137,20 +212,22 @@ unsigned DSPDecompressFrameRangedStateOnly(const uint8_t* in, const int16_t coef
   uint8_t cIdx = (in[0] >> 4) & 0xf;
   int32_t factor1 = coefs[cIdx][0];
   int32_t factor2 = coefs[cIdx][1];
-  uint8_t exp = in[0] & 0xf;
+  int32_t scaled[16];
+  DSPUnpackFrame(scaled, in, lastSample);
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
   unsigned ret = 0;
   for (unsigned s = firstSample; s < 14 && s < lastSample; ++s) {
-    int32_t sampleData = (s & 1) ? NibbleToInt[(in[s / 2 + 1]) & 0xf] : NibbleToInt[(in[s / 2 + 1] >> 4) & 0xf];
-    sampleData <<= exp;
-    sampleData <<= 11;
-    sampleData += 1024;
-    sampleData += factor1 * ((int32_t)(*prev1)) + factor2 * ((int32_t)(*prev2));
+    int32_t sampleData = scaled[s];
+    sampleData += factor1 * hist1 + factor2 * hist2;
     sampleData >>= 11;
     sampleData = DSPSampClamp(sampleData);
-    *prev2 = *prev1;
-    *prev1 = sampleData;
+    hist2 = hist1;
+    hist1 = sampleData;
     ++ret;
   }
+  *prev1 = hist1;
+  *prev2 = hist2;
   return ret;
 }
 
@@ -403,61 +480,72 @@ static void FilterRecords(tvec vecBest[8], int exp, tvec records[], int recordCo
   }
 }
 
+/* Derive the predictor record of one frame; `pcmBuf` must be preceded by the previous frame's samples */
+static bool CorrelateFrame(short pcmBuf[14], tvec recordOut) {
+  tvec vec;
+  tvec mtx[3];
+  int vecIdxs[3];
+
+  InnerProductMerge(vec, pcmBuf);
+  if (fabs(vec[0]) > 10.0) {
+    OuterProductMerge(mtx, pcmBuf);
+    if (!AnalyzeRanges(mtx, vecIdxs)) {
+      BidirectionalFilter(mtx, vecIdxs, vec);
+      if (!QuadraticMerge(vec)) {
+        FinishRecord(vec, recordOut);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* Frames analyzed per work item; long samples are split into ranges correlated concurrently */
+constexpr int CorrelateRangeFrames = 0x1000;
+
 void DSPCorrelateCoefs(const short* source, int samples, short coefsOut[8][2]) {
   int numFrames = (samples + 13) / 14;
-  int frameSamples;
-
-  short* blockBuffer = (short*)calloc(sizeof(short), 0x3800);
-  short pcmHistBuffer[2][14] = {};
+  int numRanges = (numFrames + CorrelateRangeFrames - 1) / CorrelateRangeFrames;
 
   tvec vec1;
   tvec vec2;
 
-  tvec mtx[3];
-  int vecIdxs[3];
-
   tvec* records = (tvec*)calloc(sizeof(tvec), numFrames * 2);
-  int recordCount = 0;
+  std::vector<int> rangeCounts(numRanges);
 
   tvec vecBest[8];
 
-  /* Iterate though 1024-block frames */
-  for (int x = samples; x > 0;) {
-    if (x > 0x3800) /* Full 1024-block frame */
-    {
-      frameSamples = 0x3800;
-      x -= 0x3800;
-    } else /* Partial frame */
-    {
-      /* Zero lingering block samples */
-      frameSamples = x;
-      for (int z = 0; z < 14 && z + frameSamples < 0x3800; z++)
-        blockBuffer[frameSamples + z] = 0;
-      x = 0;
+  /* Each range writes its records at its first frame's slot */
+  amuse::ParallelFor(size_t(numRanges), [&](size_t r) {
+    int frame = int(r) * CorrelateRangeFrames;
+    int endFrame = std::min(frame + CorrelateRangeFrames, numFrames);
+    tvec* rangeRecords = records + frame;
+    int count = 0;
+
+    /* Previous frame followed by the current one; samples past the end are zero */
+    short pcmHistBuffer[2][14] = {};
+    if (frame > 0)
+      std::memcpy(pcmHistBuffer[1], source + (frame - 1) * 14, sizeof(pcmHistBuffer[1]));
+
+    for (; frame < endFrame; frame++) {
+      int frameSamples = std::min(14, samples - frame * 14);
+      std::memcpy(pcmHistBuffer[0], pcmHistBuffer[1], sizeof(pcmHistBuffer[0]));
+      std::memcpy(pcmHistBuffer[1], source + frame * 14, frameSamples * sizeof(short));
+      for (int z = frameSamples; z < 14; z++)
+        pcmHistBuffer[1][z] = 0;
+
+      if (CorrelateFrame(pcmHistBuffer[1], rangeRecords[count]))
+        count++;
     }
+    rangeCounts[r] = count;
+  });
 
-    /* Copy (potentially non-frame-aligned PCM samples into aligned buffer) */
-    std::memcpy(blockBuffer, source, frameSamples * sizeof(short));
-    source += frameSamples;
-
-    for (int i = 0; i < frameSamples;) {
-      for (int z = 0; z < 14; z++)
-        pcmHistBuffer[0][z] = pcmHistBuffer[1][z];
-      for (int z = 0; z < 14; z++)
-        pcmHistBuffer[1][z] = blockBuffer[i++];
-
-      InnerProductMerge(vec1, pcmHistBuffer[1]);
-      if (fabs(vec1[0]) > 10.0) {
-        OuterProductMerge(mtx, pcmHistBuffer[1]);
-        if (!AnalyzeRanges(mtx, vecIdxs)) {
-          BidirectionalFilter(mtx, vecIdxs, vec1);
-          if (!QuadraticMerge(vec1)) {
-            FinishRecord(vec1, records[recordCount]);
-            recordCount++;
-          }
-        }
-      }
-    }
+  /* Gather records in frame order so the result does not depend on scheduling */
+  int recordCount = 0;
+  for (int r = 0; r < numRanges; r++) {
+    if (recordCount != r * CorrelateRangeFrames)
+      std::memmove(records + recordCount, records + r * CorrelateRangeFrames, rangeCounts[r] * sizeof(tvec));
+    recordCount += rangeCounts[r];
   }
 
   vec1[0] = 1.0;
@@ -505,11 +593,11 @@ void DSPCorrelateCoefs(const short* source, int samples, short coefsOut[8][2]) {
 
   /* Free memory */
   free(records);
-  free(blockBuffer);
 }
 
 /* Make sure source includes the yn values (16 samples total) */
-void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2]) {
+void DSPEncodeFrameReference(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8],
+                             const short coefsIn[8][2]) {
   int inSamples[8][16];
   int outSamples[8][14];
 
@@ -613,3 +701,174 @@ void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[
     adpcmOut[y + 1] = (char)((outSamples[bestIndex][y * 2] << 4) | (outSamples[bestIndex][y * 2 + 1] & 0xF));
   }
 }
+
+#if __SSE2__
+/* Saturate 32-bit lanes to the 16-bit sample range */
+static inline __m128i DSPClampLanes(__m128i v) {
+  const __m128i packed = _mm_packs_epi32(v, v);
+  return _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+}
+
+/* Signed division by 2048 rounding toward zero, as C integer division does */
+static inline __m128i DSPDivLanes2048(__m128i v) {
+  return _mm_srai_epi32(_mm_add_epi32(v, _mm_and_si128(_mm_srai_epi32(v, 31), _mm_set1_epi32(2047))), 11);
+}
+
+static inline __m128i DSPAbsLanes(__m128i v) {
+  const __m128i sign = _mm_srai_epi32(v, 31);
+  return _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+}
+
+/* Per-lane `mask ? a : b` */
+static inline __m128i DSPSelectLanes(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* Packs a coefficient pair (or two history samples) into one 32-bit lane for _mm_madd_epi16 */
+static inline int DSPPairLane(short lo, short hi) { return int(uint16_t(lo) | (uint32_t(uint16_t(hi)) << 16)); }
+
+/* Round v/2^scale to nearest with the same double-precision expression as the reference encoder */
+static inline __m128i DSPRoundScaled(__m128i v, __m128d recipLo, __m128d recipHi) {
+  const __m128d half = _mm_set1_pd(0.4999999f);
+  const __m128d signMask = _mm_set1_pd(-0.0);
+  const __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(v), recipLo);
+  const __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), recipHi);
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_add_pd(lo, _mm_or_pd(half, _mm_and_pd(lo, signMask)))),
+                            _mm_cvttpd_epi32(_mm_add_pd(hi, _mm_or_pd(half, _mm_and_pd(hi, signMask)))));
+}
+
+/* Runs DSPEncodeFrameReference's search for four coefficient pairs at once, one pair per lane.
+ * Lanes iterate their scale independently; a lane stops updating its outputs once its search ends.
+ * Per-sample results are stored lane-interleaved as [sample][lane]. */
+static void DSPEncodeCandidates4(const short pcmIn[16], int sampleCount, const short coefsIn[4][2], int scale[4],
+                                 int64_t distAccum[4], int32_t outSamples[14][4], int32_t inSamples[14][4]) {
+  const __m128i coefs = _mm_setr_epi32(DSPPairLane(coefsIn[0][1], coefsIn[0][0]),
+                                       DSPPairLane(coefsIn[1][1], coefsIn[1][0]),
+                                       DSPPairLane(coefsIn[2][1], coefsIn[2][0]),
+                                       DSPPairLane(coefsIn[3][1], coefsIn[3][0]));
+  const __m128i lowMask = _mm_set1_epi32(0xffff);
+  const __m128i minNibble = _mm_set1_epi32(-8);
+  const __m128i maxNibble = _mm_set1_epi32(7);
+
+  /* Largest prediction error of the undecoded signal sets the initial scale */
+  __m128i distance = _mm_setzero_si128();
+  for (int s = 0; s < sampleCount; s++) {
+    const __m128i hist = _mm_set1_epi32(DSPPairLane(pcmIn[s], pcmIn[s + 1]));
+    const __m128i v1 = DSPDivLanes2048(_mm_madd_epi16(hist, coefs));
+    const __m128i v3 = DSPClampLanes(_mm_sub_epi32(_mm_set1_epi32(pcmIn[s + 2]), v1));
+    distance = DSPSelectLanes(_mm_cmpgt_epi32(DSPAbsLanes(v3), DSPAbsLanes(distance)), v3, distance);
+  }
+
+  alignas(16) int32_t dist[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(dist), distance);
+  for (int i = 0; i < 4; i++) {
+    for (scale[i] = 0; (scale[i] <= 12) && ((dist[i] > 7) || (dist[i] < -8)); scale[i]++, dist[i] /= 2) {}
+    scale[i] = (scale[i] <= 1) ? -1 : scale[i] - 2;
+  }
+
+  bool laneActive[4] = {true, true, true, true};
+  __m128i active = _mm_set1_epi32(-1);
+  do {
+    for (int i = 0; i < 4; i++)
+      if (laneActive[i])
+        scale[i]++;
+
+    const __m128i pow = _mm_setr_epi32(1 << scale[0], 1 << scale[1], 1 << scale[2], 1 << scale[3]);
+    const __m128d recipLo = _mm_setr_pd(1.0 / (1 << scale[0]), 1.0 / (1 << scale[1]));
+    const __m128d recipHi = _mm_setr_pd(1.0 / (1 << scale[2]), 1.0 / (1 << scale[3]));
+
+    __m128i hist2 = _mm_set1_epi32(pcmIn[0]);
+    __m128i hist1 = _mm_set1_epi32(pcmIn[1]);
+    __m128i index = _mm_setzero_si128();
+    __m128i distEven = _mm_setzero_si128(); /* 64-bit sums of lanes 0 and 2 */
+    __m128i distOdd = _mm_setzero_si128();  /* 64-bit sums of lanes 1 and 3 */
+
+    for (int s = 0; s < sampleCount; s++) {
+      /* Multiply previous */
+      __m128i v1 = _mm_madd_epi16(_mm_or_si128(_mm_and_si128(hist2, lowMask), _mm_slli_epi32(hist1, 16)), coefs);
+      /* Evaluate from real sample */
+      const __m128i target = _mm_set1_epi32(pcmIn[s + 2]);
+      __m128i v3 = DSPRoundScaled(DSPDivLanes2048(_mm_sub_epi32(_mm_slli_epi32(target, 11), v1)), recipLo, recipHi);
+
+      /* Clamp sample and set index */
+      const __m128i under = _mm_cmplt_epi32(v3, minNibble);
+      const __m128i over = _mm_cmpgt_epi32(v3, maxNibble);
+      const __m128i excess = _mm_or_si128(_mm_and_si128(under, _mm_sub_epi32(minNibble, v3)),
+                                          _mm_and_si128(over, _mm_sub_epi32(v3, maxNibble)));
+      index = DSPSelectLanes(_mm_cmpgt_epi32(excess, index), excess, index);
+      v3 = DSPSelectLanes(under, minNibble, DSPSelectLanes(over, maxNibble, v3));
+
+      /* Round and expand; v3 * 2^scale fits the 16-bit multiplier */
+      v1 = _mm_add_epi32(v1, _mm_slli_epi32(_mm_madd_epi16(v3, pow), 11));
+      const __m128i decoded = DSPClampLanes(_mm_srai_epi32(_mm_add_epi32(v1, _mm_set1_epi32(1024)), 11));
+
+      /* Accumulate distance */
+      const __m128i err = DSPAbsLanes(_mm_sub_epi32(target, decoded));
+      distEven = _mm_add_epi64(distEven, _mm_mul_epu32(err, err));
+      distOdd = _mm_add_epi64(distOdd, _mm_mul_epu32(_mm_srli_epi64(err, 32), _mm_srli_epi64(err, 32)));
+
+      __m128i* outPtr = reinterpret_cast<__m128i*>(outSamples[s]);
+      __m128i* inPtr = reinterpret_cast<__m128i*>(inSamples[s]);
+      _mm_store_si128(outPtr, DSPSelectLanes(active, v3, _mm_load_si128(outPtr)));
+      _mm_store_si128(inPtr, DSPSelectLanes(active, decoded, _mm_load_si128(inPtr)));
+
+      hist2 = hist1;
+      hist1 = decoded;
+    }
+
+    alignas(16) int32_t indices[4];
+    alignas(16) int64_t even[2];
+    alignas(16) int64_t odd[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+    _mm_store_si128(reinterpret_cast<__m128i*>(even), distEven);
+    _mm_store_si128(reinterpret_cast<__m128i*>(odd), distOdd);
+    const int64_t passDist[4] = {even[0], odd[0], even[1], odd[1]};
+
+    for (int i = 0; i < 4; i++) {
+      if (!laneActive[i])
+        continue;
+      distAccum[i] = passDist[i];
+      for (int x = indices[i] + 8; x > 256; x >>= 1)
+        if (++scale[i] >= 12)
+          scale[i] = 11;
+      laneActive[i] = (scale[i] < 12) && (indices[i] > 1);
+    }
+    active = _mm_setr_epi32(-laneActive[0], -laneActive[1], -laneActive[2], -laneActive[3]);
+  } while (_mm_movemask_epi8(active));
+}
+#endif
+
+/* Make sure source includes the yn values (16 samples total) */
+void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2]) {
+#if __SSE2__
+  /* Squared errors are sums of integers below 2^53, so integer totals order the
+   * candidates exactly as the reference's doubles do */
+  alignas(16) int32_t outSamples[2][14][4] = {};
+  alignas(16) int32_t inSamples[2][14][4] = {};
+  int scale[8];
+  int64_t distAccum[8];
+  DSPEncodeCandidates4(pcmInOut, sampleCount, coefsIn, scale, distAccum, outSamples[0], inSamples[0]);
+  DSPEncodeCandidates4(pcmInOut, sampleCount, coefsIn + 4, scale + 4, distAccum + 4, outSamples[1], inSamples[1]);
+
+  int bestIndex = 0;
+  for (int i = 1; i < 8; i++)
+    if (distAccum[i] < distAccum[bestIndex])
+      bestIndex = i;
+  const int group = bestIndex / 4;
+  const int lane = bestIndex % 4;
+
+  /* Write converted samples */
+  for (int s = 0; s < sampleCount; s++)
+    pcmInOut[s + 2] = short(inSamples[group][s][lane]);
+
+  /* Write ps */
+  adpcmOut[0] = (char)((bestIndex << 4) | (scale[bestIndex] & 0xF));
+
+  /* Write output samples, zeroing the remainder */
+  auto nibble = [&](int s) { return s < sampleCount ? outSamples[group][s][lane] : 0; };
+  for (int y = 0; y < 7; y++)
+    adpcmOut[y + 1] = (char)((nibble(y * 2) << 4) | (nibble(y * 2 + 1) & 0xF));
+#else
+  DSPEncodeFrameReference(pcmInOut, sampleCount, adpcmOut, coefsIn);
+#endif
+}
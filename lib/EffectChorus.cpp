@@ -169,24 +169,35 @@ void EffectChorusImp<T>::_setup(double sampleRate) {
 
   x6c_src.x88_trigger = chanPitch;
 
+  m_seatedBaseDelay = 0;
   m_dirty = true;
 }
 
 template <typename T>
 void EffectChorusImp<T>::_update() {
-  size_t chanPitch = m_blockSamples * AMUSE_CHORUS_NUM_BLOCKS;
-  size_t fifteenSamps = 15 * m_sampsPerMs;
+  /* Only a new base delay (or a fresh setup) moves the read position. Variation and period
+   * changes keep the modulation phase so automating them does not jump the delay. */
+  const bool fresh = m_seatedBaseDelay == 0;
+  if (m_seatedBaseDelay != x90_baseDelay) {
+    size_t chanPitch = m_blockSamples * AMUSE_CHORUS_NUM_BLOCKS;
+    size_t fifteenSamps = 15 * m_sampsPerMs;
 
-  x5c_currentPosHi = m_blockSamples * 2 - (x90_baseDelay - 5) * m_sampsPerMs;
-  x58_currentPosLo = 0;
-  uint32_t temp = (x5c_currentPosHi + (x24_currentLast - 1) * m_blockSamples);
-  x5c_currentPosHi = temp % (chanPitch / fifteenSamps * fifteenSamps);
+    x5c_currentPosHi = m_blockSamples * 2 - (x90_baseDelay - 5) * m_sampsPerMs;
+    x58_currentPosLo = 0;
+    uint32_t temp = (x5c_currentPosHi + (x24_currentLast - 1) * m_blockSamples);
+    x5c_currentPosHi = temp % (chanPitch / fifteenSamps * fifteenSamps);
+    m_seatedBaseDelay = x90_baseDelay;
+  }
 
+  const bool falling = !fresh && x60_pitchOffset < 0;
   x68_pitchOffsetPeriod = (x98_period / 5 + 1) & ~1;
-  x64_pitchOffsetPeriodCount = x68_pitchOffsetPeriod / 2;
+  if (fresh)
+    x64_pitchOffsetPeriodCount = x68_pitchOffsetPeriod / 2;
+  else
+    x64_pitchOffsetPeriodCount = std::min(x64_pitchOffsetPeriodCount, x68_pitchOffsetPeriod);
   x60_pitchOffset = x94_variation * 2048 / x68_pitchOffsetPeriod;
-
-  m_dirty = false;
+  if (falling)
+    x60_pitchOffset = -x60_pitchOffset;
 }
 
 template <typename T>
@@ -195,7 +206,7 @@ EffectChorusImp<T>::~EffectChorusImp() {
 }
 
 template <typename T>
-void EffectChorusImp<T>::SrcInfo::doSrc1(size_t blockSamples, size_t chanCount) {
+void EffectChorusImp<T>::SrcInfo::doSrc1(size_t blockSamples, size_t stride) {
   float old1 = x74_old[0];
   float old2 = x74_old[1];
   float old3 = x74_old[2];
@@ -213,7 +224,7 @@ void EffectChorusImp<T>::SrcInfo::doSrc1(size_t blockSamples, size_t chanCount)
       if (x7c_posHi == x88_trigger)
         x7c_posHi = x8c_target;
       *dest = ClampFull<T>(selTab[0] * old1 + selTab[1] * old2 + selTab[2] * old3 + selTab[3] * cur);
-      dest += chanCount;
+      dest += stride;
       old1 = old2;
       old2 = old3;
       old3 = cur;
@@ -221,7 +232,7 @@ void EffectChorusImp<T>::SrcInfo::doSrc1(size_t blockSamples, size_t chanCount)
     } else {
       x78_posLo = ovrTest;
       *dest = ClampFull<T>(selTab[0] * old1 + selTab[1] * old2 + selTab[2] * old3 + selTab[3] * cur);
-      dest += chanCount;
+      dest += stride;
     }
   }
 
@@ -231,7 +242,7 @@ void EffectChorusImp<T>::SrcInfo::doSrc1(size_t blockSamples, size_t chanCount)
 }
 
 template <typename T>
-void EffectChorusImp<T>::SrcInfo::doSrc2(size_t blockSamples, size_t chanCount) {
+void EffectChorusImp<T>::SrcInfo::doSrc2(size_t blockSamples, size_t stride) {
   float old1 = x74_old[0];
   float old2 = x74_old[1];
   float old3 = x74_old[2];
@@ -259,14 +270,14 @@ void EffectChorusImp<T>::SrcInfo::doSrc2(size_t blockSamples, size_t chanCount)
         x7c_posHi = x8c_target;
 
       *dest = ClampFull<T>(selTab[0] * old1 + selTab[1] * old2 + selTab[2] * old3 + selTab[3] * cur);
-      dest += chanCount;
+      dest += stride;
 
       cur = x70_smpBase[x7c_posHi];
     } else {
       x78_posLo = ovrTest;
 
       *dest = ClampFull<T>(selTab[0] * old1 + selTab[1] * old2 + selTab[2] * old3 + selTab[3] * cur);
-      dest += chanCount;
+      dest += stride;
 
       old1 = old2;
       old2 = old3;
@@ -285,24 +296,19 @@ void EffectChorusImp<T>::SrcInfo::doSrc2(size_t blockSamples, size_t chanCount)
 }
 
 template <typename T>
-void EffectChorusImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
-  if (m_dirty)
+void EffectChorusImp<T>::_process(EffectChannels<T> chans, size_t frameCount) {
+  if (m_dirty.exchange(false))
     _update();
 
-  size_t remFrames = frameCount;
   for (size_t f = 0; f < frameCount;) {
     uint8_t next = x24_currentLast + 1;
     uint8_t buf = next % 3;
-    std::array<T*, 8> bufs{
-        x0_lastChans[0][buf], x0_lastChans[1][buf], x0_lastChans[2][buf], x0_lastChans[3][buf],
-        x0_lastChans[4][buf], x0_lastChans[5][buf], x0_lastChans[6][buf], x0_lastChans[7][buf],
-    };
-
-    T* inBuf = audio;
-    for (size_t s = 0; f < frameCount && s < m_blockSamples; ++s, ++f) {
-      for (size_t c = 0; c < chanMap.m_channelCount && c < NumChannels; ++c) {
-        *bufs[c]++ = *inBuf++;
-      }
+    const size_t bs = std::min(frameCount - f, size_t(m_blockSamples));
+
+    for (unsigned c = 0; c < chans.m_count; ++c) {
+      T* lastBuf = x0_lastChans[c][buf];
+      for (size_t s = 0; s < bs; ++s)
+        lastBuf[s] = chans.at(c, s);
     }
 
     x6c_src.x84_pitchHi = (x60_pitchOffset >> 16) + 1;
@@ -314,30 +320,28 @@ void EffectChorusImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelM
       x60_pitchOffset = -x60_pitchOffset;
     }
 
-    T* outBuf = audio;
-    size_t bs = std::min(remFrames, size_t(m_blockSamples));
-    for (size_t c = 0; c < chanMap.m_channelCount && c < NumChannels; ++c) {
+    for (unsigned c = 0; c < chans.m_count; ++c) {
       x6c_src.x7c_posHi = x5c_currentPosHi;
       x6c_src.x78_posLo = x58_currentPosLo;
 
-      x6c_src.x6c_dest = outBuf++;
+      x6c_src.x6c_dest = chans.m_chans[c];
       x6c_src.x70_smpBase = x0_lastChans[c][0];
       x6c_src.x74_old = x28_oldChans[c].data();
 
       switch (x6c_src.x84_pitchHi) {
       case 0:
-        x6c_src.doSrc1(bs, chanMap.m_channelCount);
+        x6c_src.doSrc1(bs, chans.m_stride);
         break;
       case 1:
-        x6c_src.doSrc2(bs, chanMap.m_channelCount);
+        x6c_src.doSrc2(bs, chans.m_stride);
         break;
       default:
         break;
       }
     }
 
-    audio += bs * chanMap.m_channelCount;
-    remFrames -= bs;
+    chans.advance(bs);
+    f += bs;
 
     size_t chanPitch = m_blockSamples * AMUSE_CHORUS_NUM_BLOCKS;
     size_t fifteenSamps = 15 * m_sampsPerMs;
@@ -348,6 +352,22 @@ void EffectChorusImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelM
   }
 }
 
+template <typename T>
+size_t EffectChorusImp<T>::tailFrames() const {
+  /* No feedback; output never lags input by more than the block history */
+  return size_t(m_blockSamples) * AMUSE_CHORUS_NUM_BLOCKS;
+}
+
+template <typename T>
+void EffectChorusImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Interleaved(audio, chanMap), frameCount);
+}
+
+template <typename T>
+void EffectChorusImp<T>::applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Planar(chans, chanMap), frameCount);
+}
+
 template class EffectChorusImp<int16_t>;
 template class EffectChorusImp<int32_t>;
 template class EffectChorusImp<float>;
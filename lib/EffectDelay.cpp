@@ -1,6 +1,8 @@
 #include "amuse/EffectDelay.hpp"
 
 #include <cmath>
+#include <limits>
+#include <utility>
 
 #include "amuse/Common.hpp"
 #include "amuse/IBackendVoice.hpp"
@@ -31,48 +33,227 @@ EffectDelayImp<T>::EffectDelayImp(const EffectDelayInfo& info, double sampleRate
   _setup(sampleRate);
 }
 
+template <typename T>
+EffectDelayImp<T>::~EffectDelayImp() {
+  delete m_pendingLines.exchange(nullptr);
+  delete m_migrating;
+  _freeRetired();
+}
+
+template <typename T>
+uint32_t EffectDelayImp<T>::_delayBlocks(uint32_t delay) const {
+  /* A zero-block tap would land on the write position and replay the whole ring, so
+   * delays rounding below one block get the shortest delay the line can express */
+  const uint32_t blocks = delay > 5 ? ((delay - 5) * m_sampsPerMs + 159) / 160 : 0;
+  return std::max(blocks, 1u);
+}
+
 template <typename T>
 void EffectDelayImp<T>::_setup(double sampleRate) {
   m_sampsPerMs = std::ceil(sampleRate / 1000.0);
   m_blockSamples = m_sampsPerMs * 5;
 
+  /* Lines hold the longest configured delay; longer settings later get new lines built by the setter */
+  delete m_pendingLines.exchange(nullptr);
+  delete m_migrating;
+  m_migrating = nullptr;
+  _freeRetired();
+  m_lineBlocks = 1;
+  for (uint32_t delay : x3c_delay)
+    m_lineBlocks = std::max(m_lineBlocks, _delayBlocks(delay));
+  m_reservedBlocks = m_lineBlocks;
+  for (auto& line : x30_chanLines)
+    line = std::make_unique<T[]>(size_t(m_blockSamples) * m_lineBlocks);
+  xc_currentPos.fill(0);
+
+  m_dirty = false;
+  _update();
+  m_ramp = false;
+}
+
+template <typename T>
+void EffectDelayImp<T>::_freeRetired() {
+  for (Lines* lines = m_retiredLines.exchange(nullptr); lines;) {
+    Lines* next = lines->m_nextRetired;
+    delete lines;
+    lines = next;
+  }
+}
+
+template <typename T>
+void EffectDelayImp<T>::_reserveDelay(uint32_t delay) {
+  _freeRetired();
+  const uint32_t blocks = _delayBlocks(delay);
+  if (blocks <= m_reservedBlocks)
+    return;
+
+  auto lines = std::make_unique<Lines>();
+  lines->m_blocks = blocks;
+  for (auto& line : lines->m_chans)
+    line = std::make_unique<T[]>(size_t(m_blockSamples) * blocks);
+  m_reservedBlocks = blocks;
+
+  /* Lines published earlier but not yet adopted are smaller than these, so they are dropped */
+  delete m_pendingLines.exchange(lines.release());
+}
+
+template <typename T>
+void EffectDelayImp<T>::_beginMigration() {
+  m_migrating = m_pendingLines.exchange(nullptr);
+  if (!m_migrating)
+    return;
+  m_migrateStart = xc_currentPos;
+  m_migrateCopied.fill(0);
+}
+
+template <typename T>
+void EffectDelayImp<T>::_migrateLines(size_t blockSamples) {
+  /* Each ring is copied oldest-first to the front of its replacement, continuing through the samples written
+   * since. Copying MigrateRate samples per sample played outruns the writes (which overwrite the oldest entries
+   * that are already copied), so the switch comes after a seventh of the old delay and no callback copies
+   * more than a few blocks. */
+  constexpr size_t MigrateRate = 8;
+  const size_t oldSamples = size_t(m_lineBlocks) * m_blockSamples;
+  const size_t newSamples = size_t(m_migrating->m_blocks) * m_blockSamples;
+  std::array<size_t, NumChannels> ends;
+  bool done = true;
+  for (size_t c = 0; c < NumChannels; ++c) {
+    /* History in copy order: the old ring from the starting position, then everything written since */
+    const size_t start = m_migrateStart[c];
+    ends[c] = (xc_currentPos[c] + oldSamples - start) % oldSamples + oldSamples;
+    size_t& copied = m_migrateCopied[c];
+    const size_t target = std::min(ends[c], copied + MigrateRate * blockSamples);
+    const T* src = x30_chanLines[c].get();
+    T* dst = m_migrating->m_chans[c].get();
+    while (copied < target) {
+      const size_t srcIdx = (start + copied) % oldSamples;
+      const size_t dstIdx = copied % newSamples;
+      const size_t run = std::min({target - copied, oldSamples - srcIdx, newSamples - dstIdx});
+      std::copy_n(src + srcIdx, run, dst + dstIdx);
+      copied += run;
+    }
+    done &= copied == ends[c];
+  }
+  if (!done)
+    return;
+
+  for (size_t c = 0; c < NumChannels; ++c) {
+    xc_currentPos[c] = uint32_t(ends[c] % newSamples);
+    std::swap(x30_chanLines[c], m_migrating->m_chans[c]);
+  }
+  std::swap(m_lineBlocks, m_migrating->m_blocks);
+
+  /* The old lines go back to the setter side so the audio thread never frees memory */
+  Lines* lines = std::exchange(m_migrating, nullptr);
+  lines->m_nextRetired = m_retiredLines.load();
+  while (!m_retiredLines.compare_exchange_weak(lines->m_nextRetired, lines)) {}
+
+  /* Delays capped by the old lines now glide out to their settings */
   _update();
 }
 
 template <typename T>
 void EffectDelayImp<T>::_update() {
+  /* Runs on the audio thread: lines keep their history, so the next block glides to the new settings */
+  if (!m_migrating)
+    _beginMigration();
+  m_prevSize = x0_currentSize;
+  m_prevFeedback = x18_currentFeedback;
+  m_prevOutput = x24_currentOutput;
+  m_ramp = true;
+
   for (size_t i = 0; i < NumChannels; ++i) {
-    x0_currentSize[i] = ((x3c_delay[i] - 5) * m_sampsPerMs + 159) / 160;
-    xc_currentPos[i] = 0;
+    /* Delays racing ahead of their lines are capped until the next update adopts them */
+    x0_currentSize[i] = std::min(_delayBlocks(x3c_delay[i]), m_lineBlocks);
     x18_currentFeedback[i] = x48_feedback[i] * 128 / 100;
     x24_currentOutput[i] = x54_output[i] * 128 / 100;
-
-    x30_chanLines[i] = std::make_unique<T[]>(m_blockSamples * x0_currentSize[i]);
   }
-
-  m_dirty = false;
 }
 
 template <typename T>
-void EffectDelayImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
-  if (m_dirty)
+void EffectDelayImp<T>::_process(EffectChannels<T> chans, size_t frameCount) {
+  if (m_dirty.exchange(false))
     _update();
 
+  /* Lines are rings of whole samples; a short call still delays by exactly the configured block count */
+  size_t lineSamples = size_t(m_lineBlocks) * m_blockSamples;
+  auto tapFor = [&](size_t pos, uint32_t size) {
+    return (pos + lineSamples - size_t(size) * m_blockSamples) % lineSamples;
+  };
+  auto next = [&](size_t idx) { return idx + 1 == lineSamples ? 0 : idx + 1; };
+
   for (size_t f = 0; f < frameCount;) {
-    for (unsigned c = 0; c < chanMap.m_channelCount; ++c) {
-      T* chanAud = audio + c;
-      for (unsigned i = 0; i < m_blockSamples && f < frameCount; ++i, ++f) {
-        T& liveSamp = chanAud[chanMap.m_channelCount * i];
-        T& samp = x30_chanLines[c][xc_currentPos[c] * m_blockSamples + i];
-        samp = ClampFull<T>(samp * x18_currentFeedback[c] / 128 + liveSamp);
-        liveSamp = samp * x24_currentOutput[c] / 128;
+    const size_t blockSamples = std::min(size_t(m_blockSamples), frameCount - f);
+    if (m_migrating) {
+      _migrateLines(blockSamples);
+      lineSamples = size_t(m_lineBlocks) * m_blockSamples;
+    }
+    for (unsigned c = 0; c < chans.m_count; ++c) {
+      T* line = x30_chanLines[c].get();
+      size_t pos = xc_currentPos[c];
+      size_t tap = tapFor(pos, x0_currentSize[c]);
+      if (m_ramp && (m_prevSize[c] != x0_currentSize[c] || m_prevFeedback[c] != x18_currentFeedback[c] ||
+                     m_prevOutput[c] != x24_currentOutput[c])) {
+        /* Crossfade from the old tap and glide the attenuators so the change does not click */
+        size_t prevTap = tapFor(pos, m_prevSize[c]);
+        for (size_t i = 0; i < blockSamples; ++i) {
+          const float t = float(i) / blockSamples;
+          const T delayed = T(line[prevTap] + (line[tap] - line[prevTap]) * t);
+          const uint32_t feedback =
+              (m_prevFeedback[c] * (blockSamples - i) + x18_currentFeedback[c] * i) / blockSamples;
+          const uint32_t output = (m_prevOutput[c] * (blockSamples - i) + x24_currentOutput[c] * i) / blockSamples;
+          T& liveSamp = chans.at(c, i);
+          T& samp = line[pos];
+          samp = ClampFull<T>(delayed * feedback / 128 + liveSamp);
+          liveSamp = samp * output / 128;
+          pos = next(pos);
+          tap = next(tap);
+          prevTap = next(prevTap);
+        }
+      } else {
+        for (size_t i = 0; i < blockSamples; ++i) {
+          T& liveSamp = chans.at(c, i);
+          T& samp = line[pos];
+          samp = ClampFull<T>(line[tap] * x18_currentFeedback[c] / 128 + liveSamp);
+          liveSamp = samp * x24_currentOutput[c] / 128;
+          pos = next(pos);
+          tap = next(tap);
+        }
       }
-      xc_currentPos[c] = (xc_currentPos[c] + 1) % x0_currentSize[c];
+      xc_currentPos[c] = pos;
     }
-    audio += chanMap.m_channelCount * m_blockSamples;
+    m_ramp = false;
+    chans.advance(blockSamples);
+    f += blockSamples;
   }
 }
 
+template <typename T>
+size_t EffectDelayImp<T>::tailFrames() const {
+  size_t tail = 0;
+  for (size_t i = 0; i < NumChannels; ++i) {
+    const uint32_t feedback = x48_feedback[i] * 128 / 100;
+    if (feedback >= 128)
+      return std::numeric_limits<size_t>::max();
+
+    /* Each echo is quieter by the feedback attenuator; count repeats until they are 120 dB down */
+    const size_t repeats = feedback != 0 ? size_t(std::ceil(std::log(1e-6) / std::log(feedback / 128.0))) + 1 : 1;
+    const size_t delay = size_t(_delayBlocks(x3c_delay[i])) * m_blockSamples;
+    tail = std::max(tail, repeats * delay);
+  }
+  return tail;
+}
+
+template <typename T>
+void EffectDelayImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Interleaved(audio, chanMap), frameCount);
+}
+
+template <typename T>
+void EffectDelayImp<T>::applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Planar(chans, chanMap), frameCount);
+}
+
 template class EffectDelayImp<int16_t>;
 template class EffectDelayImp<int32_t>;
 template class EffectDelayImp<float>;
@@ -5,6 +5,12 @@
 
 #include "amuse/IBackendVoice.hpp"
 
+#if __SSE2__
+#include <emmintrin.h>
+#elif __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 namespace amuse {
 
 /* clang-format off */
@@ -36,20 +42,132 @@ constexpr std::array<size_t, 8> LPTapDelays{
 
 /* clang-format on */
 
-void ReverbDelayLine::allocate(int32_t delay) {
-  delay += 2;
-  x8_length = delay;
-  xc_inputs = std::make_unique<float[]>(delay);
-  x10_lastInput = 0.f;
-  setdelay(delay / 2);
-  x0_inPoint = 0;
-  x4_outPoint = 0;
+/* Four adjacent channels of one frame, processed as SIMD lanes */
+#if __SSE2__
+using ReverbLanes = __m128;
+static ReverbLanes LanesLoad(const float* in) { return _mm_loadu_ps(in); }
+static void LanesStore(float* out, ReverbLanes v) { _mm_storeu_ps(out, v); }
+static ReverbLanes LanesSplat(float v) { return _mm_set1_ps(v); }
+static ReverbLanes LanesAdd(ReverbLanes a, ReverbLanes b) { return _mm_add_ps(a, b); }
+static ReverbLanes LanesSub(ReverbLanes a, ReverbLanes b) { return _mm_sub_ps(a, b); }
+static ReverbLanes LanesMul(ReverbLanes a, ReverbLanes b) { return _mm_mul_ps(a, b); }
+#elif __ARM_NEON
+using ReverbLanes = float32x4_t;
+static ReverbLanes LanesLoad(const float* in) { return vld1q_f32(in); }
+static void LanesStore(float* out, ReverbLanes v) { vst1q_f32(out, v); }
+static ReverbLanes LanesSplat(float v) { return vdupq_n_f32(v); }
+static ReverbLanes LanesAdd(ReverbLanes a, ReverbLanes b) { return vaddq_f32(a, b); }
+static ReverbLanes LanesSub(ReverbLanes a, ReverbLanes b) { return vsubq_f32(a, b); }
+static ReverbLanes LanesMul(ReverbLanes a, ReverbLanes b) { return vmulq_f32(a, b); }
+#else
+struct ReverbLanes {
+  std::array<float, 4> v;
+};
+static ReverbLanes LanesLoad(const float* in) { return {{in[0], in[1], in[2], in[3]}}; }
+static void LanesStore(float* out, ReverbLanes v) { std::copy(v.v.begin(), v.v.end(), out); }
+static ReverbLanes LanesSplat(float v) { return {{v, v, v, v}}; }
+static ReverbLanes LanesAdd(ReverbLanes a, ReverbLanes b) {
+  return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+static ReverbLanes LanesSub(ReverbLanes a, ReverbLanes b) {
+  return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+}
+static ReverbLanes LanesMul(ReverbLanes a, ReverbLanes b) {
+  return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+#endif
+
+constexpr unsigned ReverbLaneCount = 4;
+constexpr int ReverbBlockSamples = 160;
+
+/* Longest pre-delay in seconds; pre-delay lines are sized for it up front */
+constexpr float MaxPreDelay = 0.1f;
+
+/* Coefficient gliding linearly across one block from its value before a parameter change
+ * to its new value. With equal endpoints it holds the value exactly. */
+struct LaneRamp {
+  ReverbLanes m_value;
+  ReverbLanes m_step;
+
+  LaneRamp(ReverbLanes from, ReverbLanes to, ReverbLanes rate)
+  : m_value(from), m_step(LanesMul(LanesSub(to, from), rate)) {}
+  void next() { m_value = LanesAdd(m_value, m_step); }
+};
+
+/* Combs fall 60 dB per decay time; two decay times put the tail 120 dB down. The all-pass and
+ * low-pass lines each add one pass of delay on top. */
+static size_t ReverbTailFrames(float preDelay, float time, double sampleRate) {
+  const double rateRatio = sampleRate / NativeSampleRate;
+  const size_t lowPassDelay = *std::max_element(LPTapDelays.begin(), LPTapDelays.end());
+  const size_t passFrames = (APTapDelays[0] + APTapDelays[1] + lowPassDelay) * rateRatio;
+  return size_t((preDelay + 2.f * time) * sampleRate) + passFrames;
 }
 
-void ReverbDelayLine::setdelay(int32_t delay) {
-  x4_outPoint = x0_inPoint - delay;
-  while (x4_outPoint < 0)
-    x4_outPoint += x8_length;
+/* The pre-delay ring has always cycled over one less than the pre-delay time */
+static uint32_t PreDelayFrames(int32_t preDelayTime) { return preDelayTime != 0 ? preDelayTime - 1 : 0; }
+
+void ReverbDelayLine::allocate(int32_t maxDelay) {
+  uint32_t length = 1;
+  while (length < uint32_t(maxDelay) + 1)
+    length <<= 1;
+  m_mask = length - 1;
+  m_inputs = std::make_unique<float[]>(size_t(length) * NumChannels);
+  m_inPoint = 0;
+  m_delay.fill(0);
+  m_lastInput.fill(0.f);
+}
+
+void ReverbDelayLine::setdelay(unsigned chan, int32_t delay) { m_delay[chan] = std::min(uint32_t(delay), m_mask); }
+
+void ReverbDelayLine::setdelay(int32_t delay) { m_delay.fill(std::min(uint32_t(delay), m_mask)); }
+
+/* Channels [lane, lane + 4) of the line frame at `pos` */
+static float* LineFrame(ReverbDelayLine& line, uint32_t pos, unsigned lane) {
+  return &line.m_inputs[size_t(pos & line.m_mask) * NumChannels + lane];
+}
+
+/* Read the frame written `delay` frames before sample `s` of the current block */
+static ReverbLanes LineRead(ReverbDelayLine& line, int s, unsigned lane, uint32_t delay) {
+  return LanesLoad(LineFrame(line, line.m_inPoint + s - delay, lane));
+}
+
+/* Write `in` at sample `s` of the current block and read back the frame written one delay earlier.
+ * All four lanes share the delay of `lane`. */
+static ReverbLanes LineTap(ReverbDelayLine& line, int s, unsigned lane, ReverbLanes in) {
+  LanesStore(LineFrame(line, line.m_inPoint + s, lane), in);
+  return LineRead(line, s, lane, line.m_delay[lane]);
+}
+
+/* LineTap for lines whose delay differs per channel */
+static ReverbLanes LineTapGather(ReverbDelayLine& line, int s, unsigned lane, ReverbLanes in) {
+  const uint32_t pos = line.m_inPoint + s;
+  LanesStore(LineFrame(line, pos, lane), in);
+  float out[ReverbLaneCount];
+  for (unsigned i = 0; i < ReverbLaneCount; ++i)
+    out[i] = LineFrame(line, pos - line.m_delay[lane + i], lane)[i];
+  return LanesLoad(out);
+}
+
+/* Copy a block into lane-padded float frames, zeroing the padding lanes */
+template <typename T>
+static void StageFrames(float* frames, const EffectChannels<T>& chans, int sampleCount) {
+  const unsigned padded = (chans.m_count + ReverbLaneCount - 1) / ReverbLaneCount * ReverbLaneCount;
+  for (int s = 0; s < sampleCount; ++s) {
+    float* frame = &frames[s * NumChannels];
+    for (unsigned c = 0; c < chans.m_count; ++c)
+      frame[c] = chans.at(c, s);
+    for (unsigned c = chans.m_count; c < padded; ++c)
+      frame[c] = 0.f;
+  }
+}
+
+template <typename T>
+static void UnstageFrames(const EffectChannels<T>& chans, const float* frames, int sampleCount) {
+  for (int s = 0; s < sampleCount; ++s) {
+    const float* frame = &frames[s * NumChannels];
+    for (unsigned c = 0; c < chans.m_count; ++c)
+      chans.at(c, s) = ClampFull<T>(frame[c]);
+  }
 }
 
 EffectReverbStd::EffectReverbStd(float coloration, float mix, float time, float damping, float preDelay)
@@ -72,28 +190,46 @@ EffectReverbStdImp<T>::EffectReverbStdImp(float coloration, float mix, float tim
 template <typename T>
 void EffectReverbStdImp<T>::_setup(double sampleRate) {
   m_sampleRate = sampleRate;
+  const double rateRatio = m_sampleRate / NativeSampleRate;
+
+  /* Lines only depend on the sample rate; sizing them here keeps parameter changes allocation-free */
+  for (size_t t = 0; t < x78_C.size(); ++t) {
+    ReverbDelayLine& combLine = x78_C[t];
+    const size_t tapDelay = CTapDelays[t] * rateRatio;
+    combLine.allocate(tapDelay);
+    combLine.setdelay(tapDelay);
+  }
+
+  for (size_t t = 0; t < x0_AP.size(); ++t) {
+    ReverbDelayLine& allPassLine = x0_AP[t];
+    const size_t tapDelay = APTapDelays[t] * rateRatio;
+    allPassLine.allocate(tapDelay);
+    allPassLine.setdelay(tapDelay);
+  }
+
+  x124_preDelayLine.allocate(int32_t(m_sampleRate * MaxPreDelay));
+  x10c_lpLastout.fill(0.f);
+
+  m_dirty = false;
   _update();
+  m_ramp = false;
 }
 
 template <typename T>
 void EffectReverbStdImp<T>::_update() {
-  float timeSamples = x148_x1d0_time * m_sampleRate;
-  double rateRatio = m_sampleRate / NativeSampleRate;
-  for (size_t c = 0; c < NumChannels; ++c) {
-    for (size_t t = 0; t < x78_C[c].size(); ++t) {
-      ReverbDelayLine& combLine = x78_C[c][t];
-      size_t tapDelay = CTapDelays[t] * rateRatio;
-      combLine.allocate(tapDelay);
-      combLine.setdelay(tapDelay);
-      xf4_combCoef[c][t] = std::pow(10.f, tapDelay * -3.f / timeSamples);
-    }
+  /* Runs on the audio thread: recompute coefficients only, leaving line contents (and the tail) intact */
+  m_prevAllPassCoef = xf0_allPassCoef;
+  m_prevCombCoef = xf4_combCoef;
+  m_prevLevel = x118_level;
+  m_prevDamping = x11c_damping;
+  m_prevPreDelayTime = x120_preDelayTime;
+  m_ramp = true;
 
-    for (size_t t = 0; t < x0_AP[c].size(); ++t) {
-      ReverbDelayLine& allPassLine = x0_AP[c][t];
-      size_t tapDelay = APTapDelays[t] * rateRatio;
-      allPassLine.allocate(tapDelay);
-      allPassLine.setdelay(tapDelay);
-    }
+  const float timeSamples = x148_x1d0_time * m_sampleRate;
+  const double rateRatio = m_sampleRate / NativeSampleRate;
+  for (size_t t = 0; t < x78_C.size(); ++t) {
+    const size_t tapDelay = CTapDelays[t] * rateRatio;
+    xf4_combCoef[t].fill(std::pow(10.f, tapDelay * -3.f / timeSamples));
   }
 
   xf0_allPassCoef = x140_x1c8_coloration;
@@ -105,119 +241,128 @@ void EffectReverbStdImp<T>::_update() {
 
   x11c_damping = 1.f - (x11c_damping * 0.8f + 0.05);
 
-  if (x150_x1d8_preDelay != 0.f) {
-    x120_preDelayTime = m_sampleRate * x150_x1d8_preDelay;
-    for (size_t i = 0; i < NumChannels; ++i) {
-      x124_preDelayLine[i] = std::make_unique<float[]>(x120_preDelayTime);
-      x130_preDelayPtr[i] = x124_preDelayLine[i].get();
-    }
-  } else {
-    x120_preDelayTime = 0;
-    for (auto& delayLine : x124_preDelayLine) {
-      delayLine.reset();
-    }
-    x130_preDelayPtr.fill(nullptr);
-  }
-
-  m_dirty = false;
+  x120_preDelayTime = x150_x1d8_preDelay != 0.f ? int32_t(m_sampleRate * x150_x1d8_preDelay) : 0;
+  x124_preDelayLine.setdelay(PreDelayFrames(x120_preDelayTime));
 }
 
 template <typename T>
-void EffectReverbStdImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
-  if (m_dirty)
-    _update();
-
+template <bool Ramp>
+void EffectReverbStdImp<T>::_handleReverb(float* frames, unsigned lane, int sampleCount) {
   const float dampWet = x118_level * 0.6f;
   const float dampDry = 0.6f - dampWet;
+  const float prevWet = Ramp ? m_prevLevel * 0.6f : dampWet;
+  const CombCoeffArray& prevCombCoef = Ramp ? m_prevCombCoef : xf4_combCoef;
+  const bool preDelayMoved = Ramp && m_prevPreDelayTime != x120_preDelayTime;
+
+  const ReverbLanes rate = LanesSplat(1.f / sampleCount);
+  LaneRamp wet(LanesSplat(prevWet), LanesSplat(dampWet), rate);
+  LaneRamp dry(LanesSplat(0.6f - prevWet), LanesSplat(dampDry), rate);
+  LaneRamp allPassCoef(LanesSplat(Ramp ? m_prevAllPassCoef : xf0_allPassCoef), LanesSplat(xf0_allPassCoef), rate);
+  LaneRamp damping(LanesSplat(Ramp ? m_prevDamping : x11c_damping), LanesSplat(x11c_damping), rate);
+  LaneRamp combCoef0(LanesLoad(&prevCombCoef[0][lane]), LanesLoad(&xf4_combCoef[0][lane]), rate);
+  LaneRamp combCoef1(LanesLoad(&prevCombCoef[1][lane]), LanesLoad(&xf4_combCoef[1][lane]), rate);
+  LaneRamp preDelayFade(LanesSplat(0.f), LanesSplat(1.f), rate);
+  const ReverbLanes lowPassScale = LanesSplat(0.3f);
+
+  auto& linesC = x78_C;
+  auto& linesAP = x0_AP;
+  ReverbLanes lastC0 = LanesLoad(&linesC[0].m_lastInput[lane]);
+  ReverbLanes lastC1 = LanesLoad(&linesC[1].m_lastInput[lane]);
+  ReverbLanes lastAP0 = LanesLoad(&linesAP[0].m_lastInput[lane]);
+  ReverbLanes lastAP1 = LanesLoad(&linesAP[1].m_lastInput[lane]);
+  ReverbLanes lpLastOut = LanesLoad(&x10c_lpLastout[lane]);
 
-  for (size_t f = 0; f < frameCount; f += 160) {
-    for (unsigned c = 0; c < chanMap.m_channelCount; ++c) {
-      const auto& combCoefs = xf4_combCoef[c];
-      float& lpLastOut = x10c_lpLastout[c];
-      float* preDelayLine = x124_preDelayLine[c].get();
-      float* preDelayPtr = x130_preDelayPtr[c];
-      float* lastPreDelaySamp = &preDelayLine[x120_preDelayTime - 1];
-
-      auto& linesC = x78_C[c];
-      auto& linesAP = x0_AP[c];
-
-      const int procSamples = std::min(size_t(160), frameCount - f);
-      for (int s = 0; s < procSamples; ++s) {
-        const float sample = audio[s * chanMap.m_channelCount + c];
-
-        /* Pre-delay stage */
-        float sample2 = sample;
-        if (x120_preDelayTime != 0) {
-          sample2 = *preDelayPtr;
-          *preDelayPtr = sample;
-          preDelayPtr += 1;
-          if (preDelayPtr == lastPreDelaySamp)
-            preDelayPtr = preDelayLine;
-        }
-
-        /* Comb filter stage */
-        linesC[0].xc_inputs[linesC[0].x0_inPoint] = combCoefs[0] * linesC[0].x10_lastInput + sample2;
-        linesC[0].x0_inPoint += 1;
-
-        linesC[1].xc_inputs[linesC[1].x0_inPoint] = combCoefs[1] * linesC[1].x10_lastInput + sample2;
-        linesC[1].x0_inPoint += 1;
-
-        linesC[0].x10_lastInput = linesC[0].xc_inputs[linesC[0].x4_outPoint];
-        linesC[0].x4_outPoint += 1;
+  for (int s = 0; s < sampleCount; ++s) {
+    float* frame = &frames[s * NumChannels + lane];
+    const ReverbLanes sample = LanesLoad(frame);
+
+    /* Pre-delay stage; the line is always written so a later pre-delay change finds fresh history.
+     * A moved pre-delay crossfades from the old tap to the new one. */
+    ReverbLanes sample2 = LineTap(x124_preDelayLine, s, lane, sample);
+    if (preDelayMoved) {
+      const ReverbLanes from = LineRead(x124_preDelayLine, s, lane, PreDelayFrames(m_prevPreDelayTime));
+      sample2 = LanesAdd(from, LanesMul(preDelayFade.m_value, LanesSub(sample2, from)));
+    }
 
-        linesC[1].x10_lastInput = linesC[1].xc_inputs[linesC[1].x4_outPoint];
-        linesC[1].x4_outPoint += 1;
+    /* Comb filter stage */
+    lastC0 = LineTap(linesC[0], s, lane, LanesAdd(LanesMul(combCoef0.m_value, lastC0), sample2));
+    lastC1 = LineTap(linesC[1], s, lane, LanesAdd(LanesMul(combCoef1.m_value, lastC1), sample2));
 
-        if (linesC[0].x0_inPoint == linesC[0].x8_length)
-          linesC[0].x0_inPoint = 0;
+    /* All-pass filter stage */
+    const ReverbLanes inAP0 = LanesAdd(LanesAdd(LanesMul(allPassCoef.m_value, lastAP0), lastC0), lastC1);
+    const ReverbLanes lowPass = LanesSub(lastAP0, LanesMul(allPassCoef.m_value, inAP0));
+    lastAP0 = LineTap(linesAP[0], s, lane, inAP0);
 
-        if (linesC[1].x0_inPoint == linesC[1].x8_length)
-          linesC[1].x0_inPoint = 0;
+    lpLastOut = LanesAdd(LanesMul(damping.m_value, lpLastOut), LanesMul(lowPass, lowPassScale));
+    const ReverbLanes inAP1 = LanesAdd(LanesMul(allPassCoef.m_value, lastAP1), lpLastOut);
+    const ReverbLanes allPass = LanesSub(lastAP1, LanesMul(allPassCoef.m_value, inAP1));
+    lastAP1 = LineTap(linesAP[1], s, lane, inAP1);
 
-        if (linesC[0].x4_outPoint == linesC[0].x8_length)
-          linesC[0].x4_outPoint = 0;
+    /* Mix out */
+    LanesStore(frame, LanesAdd(LanesMul(wet.m_value, allPass), LanesMul(dry.m_value, sample)));
+
+    if (Ramp) {
+      wet.next();
+      dry.next();
+      allPassCoef.next();
+      damping.next();
+      combCoef0.next();
+      combCoef1.next();
+      preDelayFade.next();
+    }
+  }
 
-        if (linesC[1].x4_outPoint == linesC[1].x8_length)
-          linesC[1].x4_outPoint = 0;
+  LanesStore(&linesC[0].m_lastInput[lane], lastC0);
+  LanesStore(&linesC[1].m_lastInput[lane], lastC1);
+  LanesStore(&linesAP[0].m_lastInput[lane], lastAP0);
+  LanesStore(&linesAP[1].m_lastInput[lane], lastAP1);
+  LanesStore(&x10c_lpLastout[lane], lpLastOut);
+}
 
-        /* All-pass filter stage */
-        linesAP[0].xc_inputs[linesAP[0].x0_inPoint] =
-            xf0_allPassCoef * linesAP[0].x10_lastInput + linesC[0].x10_lastInput + linesC[1].x10_lastInput;
-        const float lowPass =
-            -(xf0_allPassCoef * linesAP[0].xc_inputs[linesAP[0].x0_inPoint] - linesAP[0].x10_lastInput);
-        linesAP[0].x0_inPoint += 1;
+template <typename T>
+void EffectReverbStdImp<T>::_process(EffectChannels<T> chans, size_t frameCount) {
+  if (m_dirty.exchange(false))
+    _update();
 
-        linesAP[0].x10_lastInput = linesAP[0].xc_inputs[linesAP[0].x4_outPoint];
-        linesAP[0].x4_outPoint += 1;
+  float frames[ReverbBlockSamples * NumChannels];
 
-        if (linesAP[0].x0_inPoint == linesAP[0].x8_length)
-          linesAP[0].x0_inPoint = 0;
+  for (size_t f = 0; f < frameCount; f += ReverbBlockSamples) {
+    const int procSamples = std::min(size_t(ReverbBlockSamples), frameCount - f);
 
-        if (linesAP[0].x4_outPoint == linesAP[0].x8_length)
-          linesAP[0].x4_outPoint = 0;
+    /* Every channel's network runs in lanes over the same block of frames */
+    StageFrames(frames, chans, procSamples);
+    for (unsigned lane = 0; lane < chans.m_count; lane += ReverbLaneCount) {
+      if (m_ramp)
+        _handleReverb<true>(frames, lane, procSamples);
+      else
+        _handleReverb<false>(frames, lane, procSamples);
+    }
+    UnstageFrames(chans, frames, procSamples);
+    m_ramp = false;
 
-        lpLastOut = x11c_damping * lpLastOut + lowPass * 0.3f;
-        linesAP[1].xc_inputs[linesAP[1].x0_inPoint] = xf0_allPassCoef * linesAP[1].x10_lastInput + lpLastOut;
-        const float allPass =
-            -(xf0_allPassCoef * linesAP[1].xc_inputs[linesAP[1].x0_inPoint] - linesAP[1].x10_lastInput);
-        linesAP[1].x0_inPoint += 1;
+    for (auto& line : x78_C)
+      line.advance(procSamples);
+    for (auto& line : x0_AP)
+      line.advance(procSamples);
+    x124_preDelayLine.advance(procSamples);
 
-        linesAP[1].x10_lastInput = linesAP[1].xc_inputs[linesAP[1].x4_outPoint];
-        linesAP[1].x4_outPoint += 1;
+    chans.advance(procSamples);
+  }
+}
 
-        if (linesAP[1].x0_inPoint == linesAP[1].x8_length)
-          linesAP[1].x0_inPoint = 0;
+template <typename T>
+size_t EffectReverbStdImp<T>::tailFrames() const {
+  return ReverbTailFrames(x150_x1d8_preDelay, x148_x1d0_time, m_sampleRate);
+}
 
-        if (linesAP[1].x4_outPoint == linesAP[1].x8_length)
-          linesAP[1].x4_outPoint = 0;
+template <typename T>
+void EffectReverbStdImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Interleaved(audio, chanMap), frameCount);
+}
 
-        /* Mix out */
-        audio[s * chanMap.m_channelCount + c] = ClampFull<T>(dampWet * allPass + dampDry * sample);
-      }
-      x130_preDelayPtr[c] = preDelayPtr;
-    }
-    audio += chanMap.m_channelCount * 160;
-  }
+template <typename T>
+void EffectReverbStdImp<T>::applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Planar(chans, chanMap), frameCount);
 }
 
 template <typename T>
@@ -230,34 +375,51 @@ EffectReverbHiImp<T>::EffectReverbHiImp(float coloration, float mix, float time,
 template <typename T>
 void EffectReverbHiImp<T>::_setup(double sampleRate) {
   m_sampleRate = sampleRate;
+  const double rateRatio = m_sampleRate / NativeSampleRate;
+
+  /* Lines only depend on the sample rate; sizing them here keeps parameter changes allocation-free */
+  for (size_t t = 0; t < xb4_C.size(); ++t) {
+    ReverbDelayLine& combLine = xb4_C[t];
+    const size_t tapDelay = CTapDelays[t] * rateRatio;
+    combLine.allocate(tapDelay);
+    combLine.setdelay(tapDelay);
+  }
+
+  for (size_t t = 0; t < x0_AP.size(); ++t) {
+    ReverbDelayLine& allPassLine = x0_AP[t];
+    const size_t tapDelay = APTapDelays[t] * rateRatio;
+    allPassLine.allocate(tapDelay);
+    allPassLine.setdelay(tapDelay);
+  }
+
+  x78_LP.allocate(*std::max_element(LPTapDelays.begin(), LPTapDelays.end()) * rateRatio);
+  for (size_t c = 0; c < NumChannels; ++c)
+    x78_LP.setdelay(c, LPTapDelays[c] * rateRatio);
+
+  x1ac_preDelayLine.allocate(int32_t(m_sampleRate * MaxPreDelay));
+  x190_lpLastout.fill(0.f);
+
+  m_dirty = false;
   _update();
+  m_ramp = false;
 }
 
 template <typename T>
 void EffectReverbHiImp<T>::_update() {
+  /* Runs on the audio thread: recompute coefficients only, leaving line contents (and the tail) intact */
+  m_prevAllPassCoef = x168_allPassCoef;
+  m_prevCombCoef = x16c_combCoef;
+  m_prevLevel = x19c_level;
+  m_prevDamping = x1a0_damping;
+  m_prevPreDelayTime = x1a4_preDelayTime;
+  m_prevCrosstalk = x1a8_internalCrosstalk;
+  m_ramp = true;
+
   const float timeSamples = x148_x1d0_time * m_sampleRate;
   const double rateRatio = m_sampleRate / NativeSampleRate;
-
-  for (size_t c = 0; c < NumChannels; ++c) {
-    for (size_t t = 0; t < xb4_C[c].size(); ++t) {
-      ReverbDelayLine& combLine = xb4_C[c][t];
-      const size_t tapDelay = CTapDelays[t] * rateRatio;
-      combLine.allocate(tapDelay);
-      combLine.setdelay(tapDelay);
-      x16c_combCoef[c][t] = std::pow(10.f, tapDelay * -3.f / timeSamples);
-    }
-
-    for (size_t t = 0; t < x0_AP[c].size(); ++t) {
-      ReverbDelayLine& allPassLine = x0_AP[c][t];
-      const size_t tapDelay = APTapDelays[t] * rateRatio;
-      allPassLine.allocate(tapDelay);
-      allPassLine.setdelay(tapDelay);
-    }
-
-    ReverbDelayLine& lpLine = x78_LP[c];
-    const size_t tapDelay = LPTapDelays[c] * rateRatio;
-    lpLine.allocate(tapDelay);
-    lpLine.setdelay(tapDelay);
+  for (size_t t = 0; t < xb4_C.size(); ++t) {
+    const size_t tapDelay = CTapDelays[t] * rateRatio;
+    x16c_combCoef[t].fill(std::pow(10.f, tapDelay * -3.f / timeSamples));
   }
 
   x168_allPassCoef = x140_x1c8_coloration;
@@ -269,176 +431,169 @@ void EffectReverbHiImp<T>::_update() {
 
   x1a0_damping = 1.f - (x1a0_damping * 0.8f + 0.05);
 
-  if (x150_x1d8_preDelay != 0.f) {
-    x1a4_preDelayTime = m_sampleRate * x150_x1d8_preDelay;
-    for (size_t i = 0; i < NumChannels; ++i) {
-      x1ac_preDelayLine[i] = std::make_unique<float[]>(x1a4_preDelayTime);
-      x1b8_preDelayPtr[i] = x1ac_preDelayLine[i].get();
-    }
-  } else {
-    x1a4_preDelayTime = 0;
-    for (auto& delayLine : x1ac_preDelayLine) {
-      delayLine.reset();
-    }
-    x1b8_preDelayPtr.fill(nullptr);
-  }
+  x1a4_preDelayTime = x150_x1d8_preDelay != 0.f ? int32_t(m_sampleRate * x150_x1d8_preDelay) : 0;
+  x1ac_preDelayLine.setdelay(PreDelayFrames(x1a4_preDelayTime));
 
   x1a8_internalCrosstalk = x1dc_crosstalk;
-  m_dirty = false;
 }
 
 template <typename T>
-void EffectReverbHiImp<T>::_handleReverb(T* audio, int c, int chanCount, int sampleCount) {
+template <bool Ramp>
+void EffectReverbHiImp<T>::_handleReverb(float* frames, unsigned lane, int sampleCount) {
   const float dampWet = x19c_level * 0.6f;
   const float dampDry = 0.6f - dampWet;
-
-  const auto& combCoefs = x16c_combCoef[c];
-  float& lpLastOut = x190_lpLastout[c];
-  float* preDelayLine = x1ac_preDelayLine[c].get();
-  float* preDelayPtr = x1b8_preDelayPtr[c];
-  float* lastPreDelaySamp = &preDelayLine[x1a4_preDelayTime - 1];
-
-  auto& linesC = xb4_C[c];
-  auto& linesAP = x0_AP[c];
-  ReverbDelayLine& lineLP = x78_LP[c];
-
-  const float allPassCoef = x168_allPassCoef;
-  const float damping = x1a0_damping;
-  const int32_t preDelayTime = x1a4_preDelayTime;
+  const float prevWet = Ramp ? m_prevLevel * 0.6f : dampWet;
+  const CombCoefficients& prevCombCoef = Ramp ? m_prevCombCoef : x16c_combCoef;
+  const bool preDelayMoved = Ramp && m_prevPreDelayTime != x1a4_preDelayTime;
+
+  const ReverbLanes rate = LanesSplat(1.f / sampleCount);
+  LaneRamp wet(LanesSplat(prevWet), LanesSplat(dampWet), rate);
+  LaneRamp dry(LanesSplat(0.6f - prevWet), LanesSplat(dampDry), rate);
+  LaneRamp allPassCoef(LanesSplat(Ramp ? m_prevAllPassCoef : x168_allPassCoef), LanesSplat(x168_allPassCoef), rate);
+  LaneRamp damping(LanesSplat(Ramp ? m_prevDamping : x1a0_damping), LanesSplat(x1a0_damping), rate);
+  LaneRamp combCoef0(LanesLoad(&prevCombCoef[0][lane]), LanesLoad(&x16c_combCoef[0][lane]), rate);
+  LaneRamp combCoef1(LanesLoad(&prevCombCoef[1][lane]), LanesLoad(&x16c_combCoef[1][lane]), rate);
+  LaneRamp combCoef2(LanesLoad(&prevCombCoef[2][lane]), LanesLoad(&x16c_combCoef[2][lane]), rate);
+  LaneRamp preDelayFade(LanesSplat(0.f), LanesSplat(1.f), rate);
+  const ReverbLanes lowPassScale = LanesSplat(0.3f);
+
+  auto& linesC = xb4_C;
+  auto& linesAP = x0_AP;
+  ReverbDelayLine& lineLP = x78_LP;
+  ReverbLanes lastC0 = LanesLoad(&linesC[0].m_lastInput[lane]);
+  ReverbLanes lastC1 = LanesLoad(&linesC[1].m_lastInput[lane]);
+  ReverbLanes lastC2 = LanesLoad(&linesC[2].m_lastInput[lane]);
+  ReverbLanes lastAP0 = LanesLoad(&linesAP[0].m_lastInput[lane]);
+  ReverbLanes lastAP1 = LanesLoad(&linesAP[1].m_lastInput[lane]);
+  ReverbLanes lastLP = LanesLoad(&lineLP.m_lastInput[lane]);
+  ReverbLanes lpLastOut = LanesLoad(&x190_lpLastout[lane]);
 
   for (int s = 0; s < sampleCount; ++s) {
-    const float sample = audio[s * chanCount + c];
-
-    /* Pre-delay stage */
-    float sample2 = sample;
-    if (preDelayTime != 0) {
-      sample2 = *preDelayPtr;
-      *preDelayPtr = sample;
-      preDelayPtr += 1;
-      if (preDelayPtr == lastPreDelaySamp)
-        preDelayPtr = preDelayLine;
+    float* frame = &frames[s * NumChannels + lane];
+    const ReverbLanes sample = LanesLoad(frame);
+
+    /* Pre-delay stage; the line is always written so a later pre-delay change finds fresh history.
+     * A moved pre-delay crossfades from the old tap to the new one. */
+    ReverbLanes sample2 = LineTap(x1ac_preDelayLine, s, lane, sample);
+    if (preDelayMoved) {
+      const ReverbLanes from = LineRead(x1ac_preDelayLine, s, lane, PreDelayFrames(m_prevPreDelayTime));
+      sample2 = LanesAdd(from, LanesMul(preDelayFade.m_value, LanesSub(sample2, from)));
     }
 
     /* Comb filter stage */
-    linesC[0].xc_inputs[linesC[0].x0_inPoint] = combCoefs[0] * linesC[0].x10_lastInput + sample2;
-    linesC[0].x0_inPoint += 1;
-
-    linesC[1].xc_inputs[linesC[1].x0_inPoint] = combCoefs[1] * linesC[1].x10_lastInput + sample2;
-    linesC[1].x0_inPoint += 1;
-
-    linesC[2].xc_inputs[linesC[2].x0_inPoint] = combCoefs[2] * linesC[2].x10_lastInput + sample2;
-    linesC[2].x0_inPoint += 1;
-
-    linesC[0].x10_lastInput = linesC[0].xc_inputs[linesC[0].x4_outPoint];
-    linesC[0].x4_outPoint += 1;
-
-    linesC[1].x10_lastInput = linesC[1].xc_inputs[linesC[1].x4_outPoint];
-    linesC[1].x4_outPoint += 1;
-
-    linesC[2].x10_lastInput = linesC[2].xc_inputs[linesC[2].x4_outPoint];
-    linesC[2].x4_outPoint += 1;
-
-    if (linesC[0].x0_inPoint == linesC[0].x8_length)
-      linesC[0].x0_inPoint = 0;
-
-    if (linesC[1].x0_inPoint == linesC[1].x8_length)
-      linesC[1].x0_inPoint = 0;
-
-    if (linesC[2].x0_inPoint == linesC[2].x8_length)
-      linesC[2].x0_inPoint = 0;
-
-    if (linesC[0].x4_outPoint == linesC[0].x8_length)
-      linesC[0].x4_outPoint = 0;
-
-    if (linesC[1].x4_outPoint == linesC[1].x8_length)
-      linesC[1].x4_outPoint = 0;
-
-    if (linesC[2].x4_outPoint == linesC[2].x8_length)
-      linesC[2].x4_outPoint = 0;
+    lastC0 = LineTap(linesC[0], s, lane, LanesAdd(LanesMul(combCoef0.m_value, lastC0), sample2));
+    lastC1 = LineTap(linesC[1], s, lane, LanesAdd(LanesMul(combCoef1.m_value, lastC1), sample2));
+    lastC2 = LineTap(linesC[2], s, lane, LanesAdd(LanesMul(combCoef2.m_value, lastC2), sample2));
 
     /* All-pass filter stage */
-    linesAP[0].xc_inputs[linesAP[0].x0_inPoint] = allPassCoef * linesAP[0].x10_lastInput + linesC[0].x10_lastInput +
-                                                  linesC[1].x10_lastInput + linesC[2].x10_lastInput;
-
-    linesAP[1].xc_inputs[linesAP[1].x0_inPoint] =
-        allPassCoef * linesAP[1].x10_lastInput -
-        (allPassCoef * linesAP[0].xc_inputs[linesAP[0].x0_inPoint] - linesAP[0].x10_lastInput);
-
-    const float lowPass = -(allPassCoef * linesAP[1].xc_inputs[linesAP[1].x0_inPoint] - linesAP[1].x10_lastInput);
-    linesAP[0].x0_inPoint += 1;
-    linesAP[1].x0_inPoint += 1;
-
-    if (linesAP[0].x0_inPoint == linesAP[0].x8_length)
-      linesAP[0].x0_inPoint = 0;
-
-    if (linesAP[1].x0_inPoint == linesAP[1].x8_length)
-      linesAP[1].x0_inPoint = 0;
-
-    linesAP[0].x10_lastInput = linesAP[0].xc_inputs[linesAP[0].x4_outPoint];
-    linesAP[0].x4_outPoint += 1;
-
-    linesAP[1].x10_lastInput = linesAP[1].xc_inputs[linesAP[1].x4_outPoint];
-    linesAP[1].x4_outPoint += 1;
-
-    if (linesAP[0].x4_outPoint == linesAP[0].x8_length)
-      linesAP[0].x4_outPoint = 0;
-
-    if (linesAP[1].x4_outPoint == linesAP[1].x8_length)
-      linesAP[1].x4_outPoint = 0;
-
-    lpLastOut = damping * lpLastOut + lowPass * 0.3f;
-    lineLP.xc_inputs[lineLP.x0_inPoint] = allPassCoef * lineLP.x10_lastInput + lpLastOut;
-    const float allPass = -(allPassCoef * lineLP.xc_inputs[lineLP.x0_inPoint] - lineLP.x10_lastInput);
-    lineLP.x0_inPoint += 1;
-
-    lineLP.x10_lastInput = lineLP.xc_inputs[lineLP.x4_outPoint];
-    lineLP.x4_outPoint += 1;
-
-    if (lineLP.x0_inPoint == lineLP.x8_length)
-      lineLP.x0_inPoint = 0;
-
-    if (lineLP.x4_outPoint == lineLP.x8_length)
-      lineLP.x4_outPoint = 0;
+    const ReverbLanes apCoef = allPassCoef.m_value;
+    const ReverbLanes inAP0 = LanesAdd(LanesAdd(LanesAdd(LanesMul(apCoef, lastAP0), lastC0), lastC1), lastC2);
+    const ReverbLanes inAP1 = LanesSub(LanesMul(apCoef, lastAP1), LanesSub(LanesMul(apCoef, inAP0), lastAP0));
+    const ReverbLanes lowPass = LanesSub(lastAP1, LanesMul(apCoef, inAP1));
+    lastAP0 = LineTap(linesAP[0], s, lane, inAP0);
+    lastAP1 = LineTap(linesAP[1], s, lane, inAP1);
+
+    lpLastOut = LanesAdd(LanesMul(damping.m_value, lpLastOut), LanesMul(lowPass, lowPassScale));
+    const ReverbLanes inLP = LanesAdd(LanesMul(apCoef, lastLP), lpLastOut);
+    const ReverbLanes allPass = LanesSub(lastLP, LanesMul(apCoef, inLP));
+    lastLP = LineTapGather(lineLP, s, lane, inLP);
 
     /* Mix out */
-    audio[s * chanCount + c] = ClampFull<T>(dampWet * allPass + dampDry * sample);
+    LanesStore(frame, LanesAdd(LanesMul(wet.m_value, allPass), LanesMul(dry.m_value, sample)));
+
+    if (Ramp) {
+      wet.next();
+      dry.next();
+      allPassCoef.next();
+      damping.next();
+      combCoef0.next();
+      combCoef1.next();
+      combCoef2.next();
+      preDelayFade.next();
+    }
   }
 
-  x1b8_preDelayPtr[c] = preDelayPtr;
+  LanesStore(&linesC[0].m_lastInput[lane], lastC0);
+  LanesStore(&linesC[1].m_lastInput[lane], lastC1);
+  LanesStore(&linesC[2].m_lastInput[lane], lastC2);
+  LanesStore(&linesAP[0].m_lastInput[lane], lastAP0);
+  LanesStore(&linesAP[1].m_lastInput[lane], lastAP1);
+  LanesStore(&lineLP.m_lastInput[lane], lastLP);
+  LanesStore(&x190_lpLastout[lane], lpLastOut);
 }
 
 template <typename T>
-void EffectReverbHiImp<T>::_doCrosstalk(T* audio, float wet, float dry, int chanCount, int sampleCount) {
+void EffectReverbHiImp<T>::_doCrosstalk(float* frames, float fromWet, float toWet, unsigned chanCount,
+                                        int sampleCount) {
+  /* Staged samples still round through T as the crosstalk mix always has */
+  const float step = (toWet - fromWet) / sampleCount;
   for (int i = 0; i < sampleCount; ++i) {
-    T* base = &audio[chanCount * i];
+    const float wet = fromWet + step * i;
+    const float dry = 1.f - wet;
+    float* base = &frames[i * NumChannels];
     float allWet = 0;
-    for (int c = 0; c < chanCount; ++c) {
+    for (unsigned c = 0; c < chanCount; ++c) {
       allWet += base[c] * wet;
-      base[c] *= dry;
+      base[c] = T(base[c] * dry);
     }
-    for (int c = 0; c < chanCount; ++c)
+    for (unsigned c = 0; c < chanCount; ++c)
       base[c] = ClampFull<T>(base[c] + allWet);
   }
 }
 
 template <typename T>
-void EffectReverbHiImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
-  if (m_dirty)
+void EffectReverbHiImp<T>::_process(EffectChannels<T> chans, size_t frameCount) {
+  if (m_dirty.exchange(false))
     _update();
 
-  for (size_t f = 0; f < frameCount; f += 160) {
-    size_t blockSamples = std::min(size_t(160), frameCount - f);
-    for (unsigned i = 0; i < chanMap.m_channelCount; ++i) {
-      if (i == 0 && x1a8_internalCrosstalk != 0.f) {
-        float crossWet = x1a8_internalCrosstalk * 0.5;
-        _doCrosstalk(audio, crossWet, 1.f - crossWet, chanMap.m_channelCount, blockSamples);
-      }
-      _handleReverb(audio, i, chanMap.m_channelCount, blockSamples);
+  float frames[ReverbBlockSamples * NumChannels];
+
+  for (size_t f = 0; f < frameCount; f += ReverbBlockSamples) {
+    const int blockSamples = std::min(size_t(ReverbBlockSamples), frameCount - f);
+
+    /* Every channel's network runs in lanes over the same block of frames */
+    StageFrames(frames, chans, blockSamples);
+    const float prevCrosstalk = m_ramp ? m_prevCrosstalk : x1a8_internalCrosstalk;
+    if (chans.m_count != 0 && (x1a8_internalCrosstalk != 0.f || prevCrosstalk != 0.f)) {
+      const float crossWet = x1a8_internalCrosstalk * 0.5;
+      const float prevCrossWet = prevCrosstalk * 0.5;
+      _doCrosstalk(frames, prevCrossWet, crossWet, chans.m_count, blockSamples);
+    }
+    for (unsigned lane = 0; lane < chans.m_count; lane += ReverbLaneCount) {
+      if (m_ramp)
+        _handleReverb<true>(frames, lane, blockSamples);
+      else
+        _handleReverb<false>(frames, lane, blockSamples);
     }
-    audio += chanMap.m_channelCount * 160;
+    UnstageFrames(chans, frames, blockSamples);
+    m_ramp = false;
+
+    for (auto& line : xb4_C)
+      line.advance(blockSamples);
+    for (auto& line : x0_AP)
+      line.advance(blockSamples);
+    x78_LP.advance(blockSamples);
+    x1ac_preDelayLine.advance(blockSamples);
+
+    chans.advance(blockSamples);
   }
 }
 
+template <typename T>
+size_t EffectReverbHiImp<T>::tailFrames() const {
+  return ReverbTailFrames(x150_x1d8_preDelay, x148_x1d0_time, m_sampleRate);
+}
+
+template <typename T>
+void EffectReverbHiImp<T>::applyEffect(T* audio, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Interleaved(audio, chanMap), frameCount);
+}
+
+template <typename T>
+void EffectReverbHiImp<T>::applyEffectPlanar(T* const* chans, size_t frameCount, const ChannelMap& chanMap) {
+  _process(EffectChannels<T>::Planar(chans, chanMap), frameCount);
+}
+
 template class EffectReverbStdImp<int16_t>;
 template class EffectReverbStdImp<int32_t>;
 template class EffectReverbStdImp<float>;
@@ -1,5 +1,6 @@
 #include "amuse/Engine.hpp"
 
+#include <algorithm>
 #include <array>
 
 #include "amuse/AudioGroup.hpp"
@@ -26,8 +27,10 @@ Engine::~Engine() {
     vox->_destroy();
 }
 
-Engine::Engine(IBackendVoiceAllocator& backend, AmplitudeMode ampMode)
-: m_backend(backend), m_ampMode(ampMode), m_defaultStudio(_allocateStudio(true)) {
+Engine::Engine(IBackendVoiceAllocator& backend, AmplitudeMode ampMode, EffectMode effectMode)
+: m_backend(backend), m_ampMode(ampMode), m_effectMode(effectMode), m_defaultStudio(_allocateStudio(true)) {
+  m_activeVoices.reserve(m_maxVoices);
+  m_voicePool->reserve(m_maxVoices);
   m_defaultStudio->getAuxA().makeReverbStd(0.5f, 0.8f, 3.0f, 0.5f, 0.1f);
   m_defaultStudio->getAuxB().makeChorus(15, 0, 500);
   m_defaultStudioReady = true;
@@ -53,15 +56,73 @@ std::pair<AudioGroup*, const SFXGroupIndex*> Engine::_findSFXGroup(GroupId group
   return {};
 }
 
-std::list<ObjToken<Voice>>::iterator Engine::_allocateVoice(const AudioGroup& group, GroupId groupId, double sampleRate,
-                                                            bool dynamicPitch, bool emitter, ObjToken<Studio> studio) {
-  auto it =
-      m_activeVoices.emplace(m_activeVoices.end(), MakeObj<Voice>(*this, group, groupId, m_nextVid++, emitter, studio));
-  m_activeVoices.back()->m_backendVoice = m_backend.allocateVoice(*m_activeVoices.back(), sampleRate, dynamicPitch);
-  m_activeVoices.back()->m_backendVoice->setChannelLevels(studio->getMaster().m_backendSubmix.get(), FullLevels, false);
-  m_activeVoices.back()->m_backendVoice->setChannelLevels(studio->getAuxA().m_backendSubmix.get(), FullLevels, false);
-  m_activeVoices.back()->m_backendVoice->setChannelLevels(studio->getAuxB().m_backendSubmix.get(), FullLevels, false);
-  return it;
+template <typename Func>
+void Engine::_visitVoices(std::vector<ObjToken<Voice>>& voices, Func&& func) {
+  for (ObjToken<Voice>& vox : voices) {
+    func(*vox);
+    _visitVoices(vox->m_childVoices, func);
+  }
+}
+
+size_t Engine::_countBudgetedVoices(const void* source) {
+  size_t count = 0;
+  _visitVoices(m_activeVoices, [&](Voice& vox) {
+    if (vox._isBudgeted() && (!source || vox.m_budgetSource == source))
+      ++count;
+  });
+  return count;
+}
+
+Voice* Engine::_findStealVictim(uint8_t maxPriority, const void* source) {
+  /* Lowest priority first, then oldest, then quietest */
+  Voice* victim = nullptr;
+  _visitVoices(m_activeVoices, [&](Voice& vox) {
+    if (!vox._isBudgeted() || vox.m_priority > maxPriority || (source && vox.m_budgetSource != source))
+      return;
+    if (!victim || vox.m_priority < victim->m_priority ||
+        (vox.m_priority == victim->m_priority &&
+         (vox.m_startTick < victim->m_startTick ||
+          (vox.m_startTick == victim->m_startTick && vox.m_nextLevel < victim->m_nextLevel))))
+      victim = &vox;
+  });
+  return victim;
+}
+
+bool Engine::_reserveVoice(const VoiceBudget& budget) {
+  /* Newest voice always wins within its own page/SFX budget; data authored with 0 has no limit */
+  if (budget.source && budget.maxVoices) {
+    while (_countBudgetedVoices(budget.source) >= budget.maxVoices) {
+      Voice* victim = _findStealVictim(UINT8_MAX, budget.source);
+      if (!victim)
+        return false;
+      victim->_steal();
+    }
+  }
+
+  /* Global budget may only be reclaimed from voices of equal or lower priority */
+  while (_countBudgetedVoices(nullptr) >= m_maxVoices) {
+    Voice* victim = _findStealVictim(budget.priority, nullptr);
+    if (!victim)
+      return false;
+    victim->_steal();
+  }
+
+  return true;
+}
+
+ObjToken<Voice> Engine::_allocateVoice(const AudioGroup& group, GroupId groupId, double sampleRate, bool dynamicPitch,
+                                       bool emitter, ObjToken<Studio> studio, const VoiceBudget& budget) {
+  ObjToken<Voice> vox = new (*this) Voice(*this, group, groupId, m_nextVid++, emitter, studio);
+  vox->m_priority = budget.priority;
+  vox->m_budgetSource = budget.source;
+  vox->m_startTick = m_pumpTick;
+  vox->m_startDelay = m_eventOffset;
+  vox->m_backendVoice = m_backend.allocateVoice(*vox, sampleRate, dynamicPitch);
+  vox->m_backendVoice->setChannelLevels(studio->getMaster().m_backendSubmix.get(), FullLevels, false);
+  vox->m_backendVoice->setChannelLevels(studio->getAuxA().m_backendSubmix.get(), FullLevels, false);
+  vox->m_backendVoice->setChannelLevels(studio->getAuxB().m_backendSubmix.get(), FullLevels, false);
+  m_activeVoices.push_back(vox);
+  return vox;
 }
 
 std::list<ObjToken<Sequencer>>::iterator Engine::_allocateSequencer(const AudioGroup& group, GroupId groupId,
@@ -86,10 +147,15 @@ ObjToken<Studio> Engine::_allocateStudio(bool mainOut) {
   ret->m_master.m_backendSubmix = m_backend.allocateSubmix(ret->m_master, mainOut, 0);
   ret->m_auxA.m_backendSubmix = m_backend.allocateSubmix(ret->m_auxA, mainOut, 1);
   ret->m_auxB.m_backendSubmix = m_backend.allocateSubmix(ret->m_auxB, mainOut, 2);
+  if (m_effectMode == EffectMode::Planar) {
+    ret->m_master.setPlanarEffects(true);
+    ret->m_auxA.setPlanarEffects(true);
+    ret->m_auxB.setPlanarEffects(true);
+  }
   return ret;
 }
 
-std::list<ObjToken<Voice>>::iterator Engine::_destroyVoice(std::list<ObjToken<Voice>>::iterator it) {
+std::vector<ObjToken<Voice>>::iterator Engine::_destroyVoice(std::vector<ObjToken<Voice>>::iterator it) {
   assert(this == &(*it)->getEngine());
   if ((*it)->m_destroyed)
     return m_activeVoices.begin();
@@ -97,6 +163,14 @@ std::list<ObjToken<Voice>>::iterator Engine::_destroyVoice(std::list<ObjToken<Vo
   return m_activeVoices.erase(it);
 }
 
+void Engine::_destroyVoice(Voice* vox) {
+  /* Recently allocated voices sit at the back */
+  auto search = std::find_if(m_activeVoices.rbegin(), m_activeVoices.rend(),
+                             [vox](const ObjToken<Voice>& other) { return other.get() == vox; });
+  if (search != m_activeVoices.rend())
+    _destroyVoice(std::next(search).base());
+}
+
 std::list<ObjToken<Sequencer>>::iterator Engine::_destroySequencer(std::list<ObjToken<Sequencer>>::iterator it) {
   assert(this == &(*it)->getEngine());
   if ((*it)->m_destroyed)
@@ -139,14 +213,20 @@ void Engine::_bringOutYourDead() {
 
 void Engine::_on5MsInterval(IBackendVoiceAllocator& engine, double dt) {
   m_channelSet = engine.getAvailableSet();
-  if (m_midiReader)
+  ++m_pumpTick;
+  if (m_midiReader) {
     m_midiReader->pumpReader(dt);
-  for (ObjToken<Sequencer>& seq : m_activeSequencers)
+    m_eventOffset = 0.0;
+  }
+  for (ObjToken<Sequencer>& seq : m_activeSequencers) {
     seq->advance(dt);
+    m_eventOffset = 0.0;
+  }
   for (ObjToken<Emitter>& emitter : m_activeEmitters)
     emitter->_update();
   for (ObjToken<Listener>& listener : m_activeListeners)
     listener->m_dirty = false;
+  m_sampleCache.pump();
 }
 
 void Engine::_onPumpCycleComplete(IBackendVoiceAllocator& engine) {
@@ -226,6 +306,7 @@ void Engine::removeAudioGroup(const AudioGroupData& data) {
     }
   }
 
+  m_sampleCache.purgeGroup(*grp);
   m_audioGroups.erase(search);
 }
 
@@ -243,19 +324,22 @@ ObjToken<Voice> Engine::fxStart(SFXId sfxId, float vol, float pan, ObjToken<Stud
   if (!grp)
     return {};
 
-  std::list<ObjToken<Voice>>::iterator ret =
-      _allocateVoice(*grp, std::get<1>(search->second), NativeSampleRate, true, false, smx);
+  const VoiceBudget budget{entry->priority, entry->maxVoices, entry};
+  if (!_reserveVoice(budget))
+    return {};
+
+  ObjToken<Voice> ret = _allocateVoice(*grp, std::get<1>(search->second), NativeSampleRate, true, false, smx, budget);
 
-  if (!(*ret)->loadPageObject(entry->objId, 1000.f, entry->defKey, entry->defVel, 0)) {
-    _destroyVoice(ret);
+  if (!ret->loadPageObject(entry->objId, 1000.f, entry->defKey, entry->defVel, 0)) {
+    _destroyVoice(ret.get());
     return {};
   }
 
-  (*ret)->setVolume(vol);
+  ret->setVolume(vol);
   float evalPan = pan != 0.f ? pan : ((entry->panning - 64.f) / 63.f);
   evalPan = std::clamp(evalPan, -1.f, 1.f);
-  (*ret)->setPan(evalPan);
-  return *ret;
+  ret->setPan(evalPan);
+  return ret;
 }
 
 /** Start soundFX playing from explicit group data (for editor use) */
@@ -265,41 +349,46 @@ ObjToken<Voice> Engine::fxStart(const AudioGroup* group, GroupId groupId, SFXId
   if (sfxIdx) {
     auto search = sfxIdx->m_sfxEntries.find(sfxId);
     if (search != sfxIdx->m_sfxEntries.cend()) {
-      std::list<ObjToken<Voice>>::iterator ret = _allocateVoice(*group, groupId, NativeSampleRate, true, false, smx);
-
       auto& entry = search->second;
-      if (!(*ret)->loadPageObject(entry.objId, 1000.f, entry.defKey, entry.defVel, 0)) {
-        _destroyVoice(ret);
+      const VoiceBudget budget{entry.priority, entry.maxVoices, &entry};
+      if (!_reserveVoice(budget))
+        return {};
+
+      ObjToken<Voice> ret = _allocateVoice(*group, groupId, NativeSampleRate, true, false, smx, budget);
+
+      if (!ret->loadPageObject(entry.objId, 1000.f, entry.defKey, entry.defVel, 0)) {
+        _destroyVoice(ret.get());
         return {};
       }
 
-      (*ret)->setVolume(vol);
+      ret->setVolume(vol);
       float evalPan = pan != 0.f ? pan : ((entry.panning - 64.f) / 63.f);
       evalPan = std::clamp(evalPan, -1.f, 1.f);
-      (*ret)->setPan(evalPan);
-      return *ret;
+      ret->setPan(evalPan);
+      return ret;
     }
   }
 
   return {};
 }
 
-/** Start SoundMacro node playing directly (for editor use) */
+/** Start SoundMacro node playing directly (for editor use).
+ *  Editor previews bypass voice budgets so an audition is never refused. */
 ObjToken<Voice> Engine::macroStart(const AudioGroup* group, SoundMacroId id, uint8_t key, uint8_t vel, uint8_t mod,
                                    ObjToken<Studio> smx) {
   if (!group)
     return {};
 
-  std::list<ObjToken<Voice>>::iterator ret = _allocateVoice(*group, {}, NativeSampleRate, true, false, smx);
+  ObjToken<Voice> ret = _allocateVoice(*group, {}, NativeSampleRate, true, false, smx);
 
-  if (!(*ret)->loadMacroObject(id, 0, 1000.f, key, vel, mod)) {
-    _destroyVoice(ret);
+  if (!ret->loadMacroObject(id, 0, 1000.f, key, vel, mod)) {
+    _destroyVoice(ret.get());
     return {};
   }
 
-  (*ret)->setVolume(1.f);
-  (*ret)->setPan(0.f);
-  return *ret;
+  ret->setVolume(1.f);
+  ret->setPan(0.f);
+  return ret;
 }
 
 /** Start SoundMacro object playing directly (for editor use) */
@@ -308,16 +397,16 @@ ObjToken<Voice> Engine::macroStart(const AudioGroup* group, const SoundMacro* ma
   if (!group)
     return {};
 
-  std::list<ObjToken<Voice>>::iterator ret = _allocateVoice(*group, {}, NativeSampleRate, true, false, smx);
+  ObjToken<Voice> ret = _allocateVoice(*group, {}, NativeSampleRate, true, false, smx);
 
-  if (!(*ret)->loadMacroObject(macro, 0, 1000.f, key, vel, mod)) {
-    _destroyVoice(ret);
+  if (!ret->loadMacroObject(macro, 0, 1000.f, key, vel, mod)) {
+    _destroyVoice(ret.get());
     return {};
   }
 
-  (*ret)->setVolume(1.f);
-  (*ret)->setPan(0.f);
-  return *ret;
+  ret->setVolume(1.f);
+  ret->setPan(0.f);
+  return ret;
 }
 
 /** Start PageObject node playing directly (for editor use) */
@@ -326,14 +415,14 @@ ObjToken<Voice> Engine::pageObjectStart(const AudioGroup* group, ObjectId id, ui
   if (!group)
     return {};
 
-  std::list<ObjToken<Voice>>::iterator ret = _allocateVoice(*group, {}, NativeSampleRate, true, false, smx);
+  ObjToken<Voice> ret = _allocateVoice(*group, {}, NativeSampleRate, true, false, smx);
 
-  if (!(*ret)->loadPageObject(id, 1000.f, key, vel, mod)) {
-    _destroyVoice(ret);
+  if (!ret->loadPageObject(id, 1000.f, key, vel, mod)) {
+    _destroyVoice(ret.get());
     return {};
   }
 
-  return *ret;
+  return ret;
 }
 
 /** Start soundFX playing from loaded audio groups, attach to positional emitter */
@@ -348,16 +437,19 @@ ObjToken<Emitter> Engine::addEmitter(const float* pos, const float* dir, float m
   if (!grp)
     return {};
 
-  std::list<ObjToken<Voice>>::iterator vox =
-      _allocateVoice(*grp, std::get<1>(search->second), NativeSampleRate, true, true, smx);
+  const VoiceBudget budget{entry->priority, entry->maxVoices, entry};
+  if (!_reserveVoice(budget))
+    return {};
+
+  ObjToken<Voice> vox = _allocateVoice(*grp, std::get<1>(search->second), NativeSampleRate, true, true, smx, budget);
 
-  if (!(*vox)->loadPageObject(entry->objId, 1000.f, entry->defKey, entry->defVel, 0)) {
-    _destroyVoice(vox);
+  if (!vox->loadPageObject(entry->objId, 1000.f, entry->defKey, entry->defVel, 0)) {
+    _destroyVoice(vox.get());
     return {};
   }
 
   auto emitIt = m_activeEmitters.emplace(m_activeEmitters.end(),
-                                         MakeObj<Emitter>(*this, *grp, *vox, maxDist, minVol, falloff, doppler));
+                                         MakeObj<Emitter>(*this, *grp, vox, maxDist, minVol, falloff, doppler));
   Emitter& ret = *(*emitIt);
 
   ret.getVoice()->setPan(entry->panning);
@@ -436,6 +528,13 @@ ObjToken<Sequencer> Engine::seqPlay(const AudioGroup* group, GroupId groupId, So
   return {};
 }
 
+/** Set maximum count of concurrently playing voices */
+void Engine::setMaxVoices(size_t maxVoices) {
+  m_maxVoices = maxVoices;
+  m_activeVoices.reserve(maxVoices);
+  m_voicePool->reserve(maxVoices);
+}
+
 /** Set total volume of engine */
 void Engine::setVolume(float vol) { m_masterVolume = vol; }
 
@@ -1,6 +1,8 @@
 #include "amuse/Envelope.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 #include "amuse/AudioGroupPool.hpp"
 #include "amuse/Voice.hpp"
@@ -18,6 +20,63 @@ constexpr std::array<int32_t, 104> MIDItoTIME{
     26000, 28000, 30000, 32000, 34000, 37000, 39000, 42000, 45000, 49000, 50000, 55000, 60000, 65000,
 };
 
+static double ControllerTime(const Voice& vox, uint8_t ctrl) {
+  return MIDItoTIME[std::clamp(int(vox.getCtrlValue(ctrl)), 0, 103)] / 1000.0;
+}
+
+void Envelope::_evaluate(const Voice* vox) {
+  m_usingControllers = vox != nullptr;
+  if (vox) {
+    m_curAttackTime = ControllerTime(*vox, vox->m_state.m_midiAttack);
+    m_curDecayTime = ControllerTime(*vox, vox->m_state.m_midiDecay);
+    m_curSustainFactor = std::clamp(int(vox->getCtrlValue(vox->m_state.m_midiSustain)), 0, 127) / 127.0;
+    m_curReleaseTime = ControllerTime(*vox, vox->m_state.m_midiRelease);
+  } else {
+    m_curAttackTime = m_attackTime;
+    m_curDecayTime = m_decayTime;
+    m_curSustainFactor = m_sustainFactor;
+    m_curReleaseTime = m_releaseTime;
+  }
+  _prepareStage();
+}
+
+void Envelope::_prepareStage() {
+  switch (m_phase) {
+  case State::Attack:
+    m_stageEnd = m_curAttackTime;
+    m_stageBase = 0.0;
+    m_stageSlope = m_stageEnd > 0.0 ? 1.0 / m_stageEnd : 0.0;
+    break;
+  case State::Decay:
+    m_stageEnd = m_curDecayTime;
+    m_stageBase = 1.0;
+    m_stageSlope = m_stageEnd > 0.0 ? (m_curSustainFactor - 1.0) / m_stageEnd : 0.0;
+    break;
+  case State::Sustain:
+    m_stageEnd = 0.0;
+    m_stageBase = m_curSustainFactor;
+    m_stageSlope = 0.0;
+    break;
+  case State::Release:
+    m_stageEnd = m_curReleaseTime;
+    m_stageBase = 1.0;
+    m_stageSlope = m_stageEnd > 0.0 ? -1.0 / m_stageEnd : 0.0;
+    break;
+  case State::Complete:
+  default:
+    m_stageEnd = 0.0;
+    m_stageBase = 0.0;
+    m_stageSlope = 0.0;
+    break;
+  }
+}
+
+void Envelope::_enterStage(State phase) {
+  m_phase = phase;
+  m_curTime = 0.0;
+  _prepareStage();
+}
+
 void Envelope::reset(const ADSR* adsr) {
   m_phase = State::Attack;
   m_curTime = 0.0;
@@ -27,6 +86,7 @@ void Envelope::reset(const ADSR* adsr) {
   m_releaseTime = adsr->getRelease();
   m_releaseStartFactor = 0.0;
   m_adsrSet = true;
+  _evaluate(nullptr);
 }
 
 void Envelope::reset(const ADSRDLS* adsr, int8_t note, int8_t vel) {
@@ -38,178 +98,118 @@ void Envelope::reset(const ADSRDLS* adsr, int8_t note, int8_t vel) {
   m_releaseTime = adsr->getRelease();
   m_releaseStartFactor = 0.0;
   m_adsrSet = true;
+  _evaluate(nullptr);
 }
 
 void Envelope::keyOff(const Voice& vox) {
-  double releaseTime = m_releaseTime;
-  if (vox.m_state.m_useAdsrControllers) {
-    releaseTime = MIDItoTIME[std::clamp(int(vox.getCtrlValue(vox.m_state.m_midiRelease)), 0, 103)] / 1000.0;
-  }
+  if (vox.m_state.m_useAdsrControllers)
+    m_curReleaseTime = ControllerTime(vox, vox.m_state.m_midiRelease);
+  else
+    m_curReleaseTime = m_releaseTime;
 
-  m_phase = (releaseTime != 0.0) ? State::Release : State::Complete;
-  m_curTime = 0.0;
+  _enterStage((m_curReleaseTime != 0.0) ? State::Release : State::Complete);
 }
 
 void Envelope::keyOff() {
-  m_phase = (m_releaseTime != 0.0) ? State::Release : State::Complete;
-  m_curTime = 0.0;
+  m_curReleaseTime = m_releaseTime;
+  _enterStage((m_curReleaseTime != 0.0) ? State::Release : State::Complete);
 }
 
-float Envelope::advance(double dt, const Voice& vox) {
-  if (!m_adsrSet && !vox.m_state.m_useAdsrControllers)
-    return 1.f;
+void Envelope::update(const Voice& vox) {
+  if (vox.m_state.m_useAdsrControllers)
+    _evaluate(&vox);
+  else if (m_usingControllers)
+    _evaluate(nullptr);
+}
 
+float Envelope::_advance(double dt) {
   double thisTime = m_curTime;
   m_curTime += dt;
 
   switch (m_phase) {
-  case State::Attack: {
-    double attackTime = m_attackTime;
-    if (vox.m_state.m_useAdsrControllers) {
-      attackTime = MIDItoTIME[std::clamp(int(vox.getCtrlValue(vox.m_state.m_midiAttack)), 0, 103)] / 1000.0;
-    }
-
-    if (attackTime == 0.0) {
-      m_phase = State::Decay;
-      m_curTime = 0.0;
+  case State::Attack:
+    if (thisTime >= m_stageEnd) {
+      _enterStage(State::Decay);
       m_releaseStartFactor = 1.f;
       return 1.f;
     }
-    double attackFac = thisTime / attackTime;
-    if (attackFac >= 1.0) {
-      m_phase = State::Decay;
-      m_curTime = 0.0;
-      m_releaseStartFactor = 1.f;
-      return 1.f;
-    }
-    m_releaseStartFactor = attackFac;
-    return attackFac;
-  }
-  case State::Decay: {
-    double decayTime = m_decayTime;
-    if (vox.m_state.m_useAdsrControllers) {
-      decayTime = MIDItoTIME[std::clamp(int(vox.getCtrlValue(vox.m_state.m_midiDecay)), 0, 103)] / 1000.0;
-    }
-
-    double sustainFactor = m_sustainFactor;
-    if (vox.m_state.m_useAdsrControllers) {
-      sustainFactor = std::clamp(int(vox.getCtrlValue(vox.m_state.m_midiSustain)), 0, 127) / 127.0;
-    }
-
-    if (decayTime == 0.0) {
-      m_phase = State::Sustain;
-      m_curTime = 0.0;
-      m_releaseStartFactor = sustainFactor;
-      return sustainFactor;
-    }
-    double decayFac = thisTime / decayTime;
-    if (decayFac >= 1.0) {
-      m_phase = State::Sustain;
-      m_curTime = 0.0;
-      m_releaseStartFactor = sustainFactor;
-      return sustainFactor;
-    }
-    m_releaseStartFactor = (1.0 - decayFac) + decayFac * sustainFactor;
+    m_releaseStartFactor = m_stageBase + m_stageSlope * thisTime;
     return m_releaseStartFactor;
-  }
-  case State::Sustain: {
-    double sustainFactor = m_sustainFactor;
-    if (vox.m_state.m_useAdsrControllers) {
-      sustainFactor = std::clamp(int(vox.getCtrlValue(vox.m_state.m_midiSustain)), 0, 127) / 127.0;
-    }
-
-    return sustainFactor;
-  }
-  case State::Release: {
-    double releaseTime = m_releaseTime;
-    if (vox.m_state.m_useAdsrControllers) {
-      releaseTime = MIDItoTIME[std::clamp(int(vox.getCtrlValue(vox.m_state.m_midiRelease)), 0, 103)] / 1000.0;
+  case State::Decay:
+    if (thisTime >= m_stageEnd) {
+      _enterStage(State::Sustain);
+      m_releaseStartFactor = m_curSustainFactor;
+      return m_curSustainFactor;
     }
-
-    if (releaseTime == 0.0) {
-      m_phase = State::Complete;
-      return 0.f;
-    }
-    double releaseFac = thisTime / releaseTime;
-    if (releaseFac >= 1.0) {
-      m_phase = State::Complete;
+    m_releaseStartFactor = m_stageBase + m_stageSlope * thisTime;
+    return m_releaseStartFactor;
+  case State::Sustain:
+    return m_curSustainFactor;
+  case State::Release:
+    if (thisTime >= m_stageEnd) {
+      _enterStage(State::Complete);
       return 0.f;
     }
-    return std::min(m_releaseStartFactor, 1.0 - releaseFac);
-  }
+    return std::min(m_releaseStartFactor, m_stageBase + m_stageSlope * thisTime);
   case State::Complete:
   default:
     return 0.f;
   }
 }
 
+float Envelope::advance(double dt, const Voice& vox) {
+  if (!m_adsrSet && !vox.m_state.m_useAdsrControllers)
+    return 1.f;
+  return _advance(dt);
+}
+
 float Envelope::advance(double dt) {
   if (!m_adsrSet)
     return 1.f;
+  return _advance(dt);
+}
 
-  double thisTime = m_curTime;
-  m_curTime += dt;
-
-  switch (m_phase) {
-  case State::Attack: {
-    double attackTime = m_attackTime;
-
-    if (attackTime == 0.0) {
-      m_phase = State::Decay;
-      m_curTime = 0.0;
-      m_releaseStartFactor = 1.f;
-      return 1.f;
-    }
-    double attackFac = thisTime / attackTime;
-    if (attackFac >= 1.0) {
-      m_phase = State::Decay;
-      m_curTime = 0.0;
-      m_releaseStartFactor = 1.f;
-      return 1.f;
-    }
-    m_releaseStartFactor = attackFac;
-    return attackFac;
-  }
-  case State::Decay: {
-    double decayTime = m_decayTime;
-    double sustainFactor = m_sustainFactor;
-
-    if (decayTime == 0.0) {
-      m_phase = State::Sustain;
-      m_curTime = 0.0;
-      m_releaseStartFactor = sustainFactor;
-      return sustainFactor;
-    }
-    double decayFac = thisTime / decayTime;
-    if (decayFac >= 1.0) {
-      m_phase = State::Sustain;
-      m_curTime = 0.0;
-      m_releaseStartFactor = sustainFactor;
-      return sustainFactor;
-    }
-    m_releaseStartFactor = (1.0 - decayFac) + decayFac * sustainFactor;
-    return m_releaseStartFactor;
+void Envelope::advanceBlock(double dt, size_t count, float* out, const Voice& vox) {
+  if (!m_adsrSet && !vox.m_state.m_useAdsrControllers) {
+    std::fill(out, out + count, 1.f);
+    return;
   }
-  case State::Sustain: {
-    return m_sustainFactor;
-  }
-  case State::Release: {
-    double releaseTime = m_releaseTime;
 
-    if (releaseTime == 0.0) {
-      m_phase = State::Complete;
-      return 0.f;
-    }
-    double releaseFac = thisTime / releaseTime;
-    if (releaseFac >= 1.0) {
-      m_phase = State::Complete;
-      return 0.f;
-    }
-    return std::min(m_releaseStartFactor, 1.0 - releaseFac);
-  }
-  case State::Complete:
-  default:
-    return 0.f;
+  size_t i = 0;
+  while (i < count) {
+    switch (m_phase) {
+    case State::Sustain:
+    case State::Complete: {
+      const float level = m_phase == State::Sustain ? float(m_curSustainFactor) : 0.f;
+      std::fill(out + i, out + count, level);
+      m_curTime += dt * double(count - i);
+      return;
+    }
+    default:
+      break;
+    }
+
+    /* Steps strictly inside the stage; one short of the estimate so rounding never overshoots it */
+    const double fit = dt > 0.0 ? std::ceil((m_stageEnd - m_curTime) / dt) - 1.0 : 0.0;
+    const size_t run = fit > 0.0 ? std::min(size_t(fit), count - i) : 0;
+    if (!run) {
+      out[i++] = _advance(dt);
+      continue;
+    }
+
+    const double base = m_stageBase + m_stageSlope * m_curTime;
+    const double step = m_stageSlope * dt;
+    if (m_phase == State::Release) {
+      const double ceiling = m_releaseStartFactor;
+      for (size_t k = 0; k < run; ++k)
+        out[i + k] = float(std::min(ceiling, base + step * double(k)));
+    } else {
+      for (size_t k = 0; k < run; ++k)
+        out[i + k] = float(base + step * double(k));
+      m_releaseStartFactor = base + step * double(run - 1);
+    }
+    m_curTime += dt * double(run);
+    i += run;
   }
 }
 
@@ -0,0 +1,80 @@
+#include "amuse/MemoryMappedFile.hpp"
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif !__SWITCH__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace amuse {
+
+MemoryMappedFile::~MemoryMappedFile() {
+#if _WIN32
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+#elif !__SWITCH__
+  if (m_data)
+    munmap(m_data, m_size);
+#endif
+}
+
+std::shared_ptr<MemoryMappedFile> MemoryMappedFile::Open(const SystemChar* path) {
+#if _WIN32
+  HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return {};
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+    CloseHandle(file);
+    return {};
+  }
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    return {};
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    return {};
+  }
+
+  std::shared_ptr<MemoryMappedFile> ret(new MemoryMappedFile);
+  ret->m_data = static_cast<unsigned char*>(data);
+  ret->m_size = size_t(size.QuadPart);
+  ret->m_mapping = mapping;
+  return ret;
+#elif !__SWITCH__
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return {};
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return {};
+  }
+
+  void* data = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return {};
+
+  std::shared_ptr<MemoryMappedFile> ret(new MemoryMappedFile);
+  ret->m_data = static_cast<unsigned char*>(data);
+  ret->m_size = size_t(st.st_size);
+  return ret;
+#else
+  return {};
+#endif
+}
+
+} // namespace amuse
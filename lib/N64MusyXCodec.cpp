@@ -3,11 +3,88 @@
 #include <cstdint>
 #include <cstring>
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* Acknowledgements:
  * SubDrag for N64 Sound Tool (http://www.goldeneyevault.com/viewfile.php?id=212)
  * Bobby Smiles for MusyX codec research
  */
 
+#if __SSE2__
+
+/* Multiply 8 int16 lanes by `coef` and accumulate into two int32x4 accumulators */
+static inline void adpcm_mac_epi16(__m128i& acc0, __m128i& acc1, __m128i x, __m128i coef) {
+  const __m128i lo = _mm_mullo_epi16(x, coef);
+  const __m128i hi = _mm_mulhi_epi16(x, coef);
+  acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(lo, hi));
+  acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(lo, hi));
+}
+
+/* Lane i accumulates book2[Lag - 1] * src[i - Lag] (the input-only part of rdot) */
+template <int Lag>
+static inline void adpcm_mac_lag(__m128i& acc0, __m128i& acc1, __m128i src, const int16_t* book2) {
+  adpcm_mac_epi16(acc0, acc1, _mm_slli_si128(src, Lag * 2), _mm_set1_epi16(book2[Lag - 1]));
+}
+
+static void adpcm_get_predicted_frame(int16_t* dst, const unsigned char* src, const unsigned char* nibbles,
+                                      unsigned rshift) {
+  *(dst++) = (src[0] << 8) | src[1];
+  *(dst++) = (src[2] << 8) | src[3];
+
+  /* Bytes 1-15 hold 30 nibbles, high nibble first */
+  const __m128i bytes = _mm_srli_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nibbles)), 1);
+  const __m128i highMask = _mm_set1_epi8(char(0xf0));
+  const __m128i hi = _mm_and_si128(bytes, highMask);
+  const __m128i lo = _mm_and_si128(_mm_slli_epi16(bytes, 4), highMask);
+  const __m128i il0 = _mm_unpacklo_epi8(hi, lo);
+  const __m128i il1 = _mm_unpackhi_epi8(hi, lo);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i shift = _mm_cvtsi32_si128(rshift);
+
+  alignas(16) int16_t samples[32];
+  _mm_store_si128(reinterpret_cast<__m128i*>(samples + 0), _mm_sra_epi16(_mm_unpacklo_epi8(zero, il0), shift));
+  _mm_store_si128(reinterpret_cast<__m128i*>(samples + 8), _mm_sra_epi16(_mm_unpackhi_epi8(zero, il0), shift));
+  _mm_store_si128(reinterpret_cast<__m128i*>(samples + 16), _mm_sra_epi16(_mm_unpacklo_epi8(zero, il1), shift));
+  _mm_store_si128(reinterpret_cast<__m128i*>(samples + 24), _mm_sra_epi16(_mm_unpackhi_epi8(zero, il1), shift));
+  memmove(dst, samples, 30 * sizeof(int16_t));
+}
+
+static unsigned adpcm_decode_upto_8_samples(int16_t* dst, const int16_t* src, const int16_t* cb_entry,
+                                            const int16_t* last_samples, unsigned size) {
+  if (size == 0)
+    return 0;
+
+  const int16_t* book1 = cb_entry;
+  const int16_t* book2 = cb_entry + 8;
+
+  /* The predictor only feeds back across groups; within a group every lane is independent */
+  const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  __m128i acc0 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16), 11);
+  __m128i acc1 = _mm_slli_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16), 11);
+  adpcm_mac_epi16(acc0, acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(book1)),
+                  _mm_set1_epi16(last_samples[0]));
+  adpcm_mac_epi16(acc0, acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(book2)),
+                  _mm_set1_epi16(last_samples[1]));
+  adpcm_mac_lag<1>(acc0, acc1, in, book2);
+  adpcm_mac_lag<2>(acc0, acc1, in, book2);
+  adpcm_mac_lag<3>(acc0, acc1, in, book2);
+  adpcm_mac_lag<4>(acc0, acc1, in, book2);
+  adpcm_mac_lag<5>(acc0, acc1, in, book2);
+  adpcm_mac_lag<6>(acc0, acc1, in, book2);
+  adpcm_mac_lag<7>(acc0, acc1, in, book2);
+
+  alignas(16) int16_t samples[8];
+  _mm_store_si128(reinterpret_cast<__m128i*>(samples),
+                  _mm_packs_epi32(_mm_srai_epi32(acc0, 11), _mm_srai_epi32(acc1, 11)));
+  memmove(dst, samples, size * sizeof(int16_t));
+
+  return size;
+}
+
+#else
+
 static int rdot(unsigned n, const int16_t* x, const int16_t* y) {
   int accu = 0;
 
@@ -62,6 +139,8 @@ static unsigned adpcm_decode_upto_8_samples(int16_t* dst, const int16_t* src, co
   return size;
 }
 
+#endif
+
 unsigned N64MusyXDecompressFrame(int16_t* out, const uint8_t* in, const int16_t coefs[8][2][8], unsigned lastSample) {
   int16_t frame[32];
 
@@ -0,0 +1,440 @@
+#include "amuse/OfflineBackend.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "amuse/Engine.hpp"
+#include "amuse/Submix.hpp"
+#include "amuse/Voice.hpp"
+
+namespace amuse {
+
+/* 4-point, 3rd-order Hermite interpolation between x1 and x2 */
+static float HermiteInterpolate(float x0, float x1, float x2, float x3, float t) {
+  const float c1 = 0.5f * (x2 - x0);
+  const float c2 = x0 - 2.5f * x1 + 2.f * x2 - 0.5f * x3;
+  const float c3 = 0.5f * (x3 - x0) + 1.5f * (x1 - x2);
+  return ((c3 * t + c2) * t + c1) * t + x1;
+}
+
+void* OfflineBackendVoice::operator new(size_t size, OfflineBackendVoiceAllocator& root) {
+  return root.m_voicePool->allocate();
+}
+
+void OfflineBackendVoice::operator delete(void* ptr, OfflineBackendVoiceAllocator& root) noexcept {
+  OfflineVoicePool::Deallocate(ptr);
+}
+
+void OfflineBackendVoice::operator delete(void* ptr) noexcept { OfflineVoicePool::Deallocate(ptr); }
+
+OfflineBackendVoice::OfflineBackendVoice(OfflineBackendVoiceAllocator& root, Voice& clientVox, double sampleRate,
+                                         bool dynamicPitch)
+: m_root(root), m_clientVox(clientVox), m_sampleRate(sampleRate), m_dynamicPitch(dynamicPitch) {
+  m_root.m_voices.push_back(this);
+}
+
+OfflineBackendVoice::~OfflineBackendVoice() {
+  /* Slot is compacted once the allocator is done iterating */
+  auto search = std::find(m_root.m_voices.begin(), m_root.m_voices.end(), this);
+  if (search != m_root.m_voices.end()) {
+    *search = nullptr;
+    m_root.m_voicesDirty = true;
+  }
+}
+
+void OfflineBackendVoice::resetSampleRate(double sampleRate) { m_sampleRate = sampleRate; }
+
+void OfflineBackendVoice::resetChannelLevels() { m_sendCount = 0; }
+
+void OfflineBackendVoice::setChannelLevels(IBackendSubmix* submix, const std::array<float, 8>& coefs, bool slew) {
+  auto* smx = static_cast<OfflineBackendSubmix*>(submix);
+  const auto sendsEnd = m_sends.begin() + m_sendCount;
+  auto search = std::find_if(m_sends.begin(), sendsEnd, [smx](const auto& s) { return s.m_submix == smx; });
+  if (search == sendsEnd) {
+    assert(m_sendCount < MaxSends && "voice routed to more submixes than a studio provides");
+    if (m_sendCount < MaxSends)
+      m_sends[m_sendCount++] = {smx, slew ? std::array<float, 8>{} : coefs, coefs};
+    return;
+  }
+  search->m_targetCoefs = coefs;
+  if (!slew)
+    search->m_curCoefs = coefs;
+}
+
+void OfflineBackendVoice::setPitchRatio(double ratio, bool slew) {
+  if (!m_dynamicPitch)
+    return;
+  m_targetPitchRatio = ratio;
+  if (!slew)
+    m_pitchRatio = ratio;
+}
+
+void OfflineBackendVoice::start() { m_running = true; }
+
+void OfflineBackendVoice::stop() { m_running = false; }
+
+void OfflineBackendVoice::_removeSubmix(OfflineBackendSubmix* submix) {
+  m_sendCount = size_t(std::remove_if(m_sends.begin(), m_sends.begin() + m_sendCount,
+                                      [submix](const auto& s) { return s.m_submix == submix; }) -
+                       m_sends.begin());
+}
+
+void OfflineBackendVoice::_pumpAndMix(size_t frames, double dt) {
+  m_clientVox.preSupplyAudio(dt);
+  if (!m_running)
+    return;
+
+  /* Determine source samples consumed this block; pitch slews linearly across the block */
+  const double rateRatio = m_sampleRate / m_root.m_sampleRate;
+  const double startStep = rateRatio * m_pitchRatio;
+  const double stepDelta = rateRatio * (m_targetPitchRatio - m_pitchRatio) / double(frames);
+  const double endPhase = m_srcPhase + startStep * frames + stepDelta * frames * (frames - 1) * 0.5;
+  const size_t freshSamples = size_t(endPhase);
+
+  std::vector<float>& srcBuf = m_root.m_resampleBuf;
+  srcBuf.resize(HistoryCount + freshSamples);
+  std::copy(m_srcHistory.cbegin(), m_srcHistory.cend(), srcBuf.begin());
+  if (freshSamples) {
+    std::vector<int16_t>& supplyBuf = m_root.m_supplyBuf;
+    supplyBuf.resize(freshSamples);
+    m_clientVox.supplyAudio(freshSamples, supplyBuf.data());
+    for (size_t i = 0; i < freshSamples; ++i)
+      srcBuf[HistoryCount + i] = supplyBuf[i] / 32768.f;
+  }
+
+  /* Resample to output rate */
+  std::vector<float>& inBuf = m_root.m_routeBuf;
+  inBuf.resize(frames * 2);
+  float* in = inBuf.data();
+  float* out = in + frames;
+  double phase = m_srcPhase;
+  for (size_t i = 0; i < frames; ++i) {
+    const size_t idx = std::min(size_t(phase), freshSamples);
+    in[i] = HermiteInterpolate(srcBuf[idx], srcBuf[idx + 1], srcBuf[idx + 2], srcBuf[idx + 3], float(phase - idx));
+    phase += startStep + stepDelta * i;
+  }
+  std::copy(srcBuf.cbegin() + freshSamples, srcBuf.cbegin() + freshSamples + HistoryCount, m_srcHistory.begin());
+  m_srcPhase = endPhase - freshSamples;
+  m_pitchRatio = m_targetPitchRatio;
+
+  /* Route through each bound submix's channel matrix */
+  const ChannelMap& chanMap = m_root.m_chanMap;
+  const float lerpFactor = 1.f / float(frames);
+  for (size_t i = 0; i < m_sendCount; ++i) {
+    SubmixLevels& send = m_sends[i];
+    m_clientVox.routeAudio(frames, dt, send.m_submix->m_busId, in, out);
+    float* mixBuf = send.m_submix->m_mixBuf.data();
+    for (unsigned c = 0; c < chanMap.m_channelCount; ++c) {
+      const size_t coefIdx = size_t(chanMap.m_channels[c]);
+      const float start = send.m_curCoefs[coefIdx];
+      const float delta = (send.m_targetCoefs[coefIdx] - start) * lerpFactor;
+      if (start == 0.f && delta == 0.f)
+        continue;
+      for (size_t f = 0; f < frames; ++f)
+        mixBuf[f * chanMap.m_channelCount + c] += out[f] * (start + delta * f);
+    }
+    send.m_curCoefs = send.m_targetCoefs;
+  }
+}
+
+OfflineBackendSubmix::OfflineBackendSubmix(OfflineBackendVoiceAllocator& root, Submix& clientSmx, bool mainOut,
+                                           int busId)
+: m_root(root), m_clientSmx(clientSmx), m_mainOut(mainOut), m_busId(busId) {
+  m_root.m_submixes.push_back(this);
+  m_root.m_submixesDirty = true;
+}
+
+OfflineBackendSubmix::~OfflineBackendSubmix() {
+  auto& submixes = m_root.m_submixes;
+  submixes.erase(std::remove(submixes.begin(), submixes.end(), this), submixes.end());
+  for (OfflineBackendSubmix* smx : submixes)
+    smx->_removeSubmix(this);
+  for (OfflineBackendVoice* vox : m_root.m_voices)
+    if (vox)
+      vox->_removeSubmix(this);
+  m_root.m_submixesDirty = true;
+}
+
+void OfflineBackendSubmix::setSendLevel(IBackendSubmix* submix, float level, bool slew) {
+  auto* smx = static_cast<OfflineBackendSubmix*>(submix);
+
+  /* Sends that would introduce a cycle are rejected */
+  if (smx->_feeds(this)) {
+    assert(false && "cyclic submix send");
+    return;
+  }
+
+  auto search = std::find_if(m_sends.begin(), m_sends.end(), [smx](const auto& s) { return s.m_submix == smx; });
+  if (search == m_sends.end()) {
+    m_sends.push_back({smx, slew ? 0.f : level, level});
+    m_root.m_submixesDirty = true;
+    return;
+  }
+  search->m_targetLevel = level;
+  if (!slew)
+    search->m_curLevel = level;
+}
+
+double OfflineBackendSubmix::getSampleRate() const { return m_root.m_sampleRate; }
+
+void OfflineBackendSubmix::_removeSubmix(OfflineBackendSubmix* submix) {
+  m_sends.erase(std::remove_if(m_sends.begin(), m_sends.end(), [submix](const auto& s) { return s.m_submix == submix; }),
+                m_sends.end());
+}
+
+bool OfflineBackendSubmix::_feeds(const OfflineBackendSubmix* target) const {
+  if (this == target)
+    return true;
+  return std::any_of(m_sends.cbegin(), m_sends.cend(), [target](const auto& s) { return s.m_submix->_feeds(target); });
+}
+
+void OfflineBackendSubmix::_applyEffects(size_t frames) {
+  if (m_clientSmx.canApplyEffect())
+    m_clientSmx.applyEffect(m_mixBuf.data(), frames, m_root.m_chanMap);
+}
+
+void OfflineBackendSubmix::_pumpAndMix(size_t frames) {
+  const ChannelMap& chanMap = m_root.m_chanMap;
+  const size_t sampleCount = frames * chanMap.m_channelCount;
+  const float lerpFactor = 1.f / float(frames);
+  for (SendLevel& send : m_sends) {
+    float* outBuf = send.m_submix->m_mixBuf.data();
+    const float start = send.m_curLevel;
+    const float delta = (send.m_targetLevel - start) * lerpFactor;
+    for (size_t s = 0; s < sampleCount; ++s)
+      outBuf[s] += m_mixBuf[s] * (start + delta * (s / chanMap.m_channelCount));
+    send.m_curLevel = send.m_targetLevel;
+  }
+}
+
+OfflineEffectWorkers::OfflineEffectWorkers(size_t threadCount) {
+  m_threads.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i)
+    m_threads.emplace_back(&OfflineEffectWorkers::_run, this);
+}
+
+OfflineEffectWorkers::~OfflineEffectWorkers() {
+  {
+    std::lock_guard<std::mutex> lk(m_lock);
+    m_running = false;
+  }
+  m_workCv.notify_all();
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+std::unique_ptr<OfflineEffectWorkers> OfflineEffectWorkers::Create(size_t threadCount) {
+  /* Leave a core for the mixing thread itself */
+  threadCount = std::min(threadCount, size_t(std::max(1u, std::thread::hardware_concurrency())) - 1);
+  if (!threadCount)
+    return {};
+  return std::make_unique<OfflineEffectWorkers>(threadCount);
+}
+
+void OfflineEffectWorkers::_drain(std::unique_lock<std::mutex>& lk) {
+  while (m_next < m_batchCount) {
+    OfflineBackendSubmix* smx = m_batch[m_next++];
+    const size_t frames = m_frames;
+    lk.unlock();
+    smx->_applyEffects(frames);
+    lk.lock();
+    if (--m_remaining == 0)
+      m_doneCv.notify_all();
+  }
+}
+
+void OfflineEffectWorkers::_run() {
+  std::unique_lock<std::mutex> lk(m_lock);
+  while (true) {
+    m_workCv.wait(lk, [this]() { return m_next < m_batchCount || !m_running; });
+    if (!m_running)
+      break;
+    _drain(lk);
+  }
+}
+
+void OfflineEffectWorkers::applyEffects(OfflineBackendSubmix* const* submixes, size_t count, size_t frames) {
+  std::unique_lock<std::mutex> lk(m_lock);
+  m_batch = submixes;
+  m_batchCount = count;
+  m_next = 0;
+  m_remaining = count;
+  m_frames = frames;
+  m_workCv.notify_all();
+
+  _drain(lk);
+  m_doneCv.wait(lk, [this]() { return m_remaining == 0; });
+  m_batch = nullptr;
+  m_batchCount = 0;
+  m_next = 0;
+}
+
+OfflineBackendVoiceAllocator::OfflineBackendVoiceAllocator(double sampleRate, AudioChannelSet channelSet,
+                                                           size_t effectWorkers)
+: m_sampleRate(sampleRate), m_channelSet(channelSet), m_5msFrames(size_t(sampleRate * 5 / 1000)) {
+  /* Interleaved in WAV channel order */
+  switch (channelSet) {
+  case AudioChannelSet::Stereo:
+  default:
+    m_channelSet = AudioChannelSet::Stereo;
+    m_chanMap.m_channelCount = 2;
+    m_chanMap.m_channels[0] = AudioChannel::FrontLeft;
+    m_chanMap.m_channels[1] = AudioChannel::FrontRight;
+    break;
+  case AudioChannelSet::Quad:
+    m_chanMap.m_channelCount = 4;
+    m_chanMap.m_channels[0] = AudioChannel::FrontLeft;
+    m_chanMap.m_channels[1] = AudioChannel::FrontRight;
+    m_chanMap.m_channels[2] = AudioChannel::RearLeft;
+    m_chanMap.m_channels[3] = AudioChannel::RearRight;
+    break;
+  case AudioChannelSet::Surround51:
+    m_chanMap.m_channelCount = 6;
+    m_chanMap.m_channels[0] = AudioChannel::FrontLeft;
+    m_chanMap.m_channels[1] = AudioChannel::FrontRight;
+    m_chanMap.m_channels[2] = AudioChannel::FrontCenter;
+    m_chanMap.m_channels[3] = AudioChannel::LFE;
+    m_chanMap.m_channels[4] = AudioChannel::RearLeft;
+    m_chanMap.m_channels[5] = AudioChannel::RearRight;
+    break;
+  case AudioChannelSet::Surround71:
+    m_chanMap.m_channelCount = 8;
+    m_chanMap.m_channels[0] = AudioChannel::FrontLeft;
+    m_chanMap.m_channels[1] = AudioChannel::FrontRight;
+    m_chanMap.m_channels[2] = AudioChannel::FrontCenter;
+    m_chanMap.m_channels[3] = AudioChannel::LFE;
+    m_chanMap.m_channels[4] = AudioChannel::RearLeft;
+    m_chanMap.m_channels[5] = AudioChannel::RearRight;
+    m_chanMap.m_channels[6] = AudioChannel::SideLeft;
+    m_chanMap.m_channels[7] = AudioChannel::SideRight;
+    break;
+  }
+
+  /* Sized for the engine's default voice budget */
+  m_voices.reserve(64);
+
+  m_ownedEffectWorkers = OfflineEffectWorkers::Create(effectWorkers);
+  m_effectWorkers = m_ownedEffectWorkers.get();
+}
+
+OfflineBackendVoiceAllocator::OfflineBackendVoiceAllocator(double sampleRate, AudioChannelSet channelSet,
+                                                           OfflineEffectWorkers* sharedWorkers)
+: OfflineBackendVoiceAllocator(sampleRate, channelSet, size_t(0)) {
+  m_effectWorkers = sharedWorkers;
+}
+
+OfflineBackendVoiceAllocator::~OfflineBackendVoiceAllocator() = default;
+
+std::unique_ptr<IBackendVoice> OfflineBackendVoiceAllocator::allocateVoice(Voice& clientVox, double sampleRate,
+                                                                           bool dynamicPitch) {
+  return std::unique_ptr<IBackendVoice>(
+      new (*this) OfflineBackendVoice(*this, clientVox, sampleRate, dynamicPitch));
+}
+
+std::unique_ptr<IBackendSubmix> OfflineBackendVoiceAllocator::allocateSubmix(Submix& clientSmx, bool mainOut,
+                                                                             int busId) {
+  return std::make_unique<OfflineBackendSubmix>(*this, clientSmx, mainOut, busId);
+}
+
+void OfflineBackendVoiceAllocator::_linearizeSubmixes() {
+  /* Reverse post-order of the send graph places every source before its targets */
+  m_linearizedSubmixes.clear();
+  m_linearizedSubmixes.reserve(m_submixes.size());
+  auto visit = [this](OfflineBackendSubmix* smx, auto& visitRef) -> void {
+    if (std::find(m_linearizedSubmixes.cbegin(), m_linearizedSubmixes.cend(), smx) != m_linearizedSubmixes.cend())
+      return;
+    for (const auto& send : smx->m_sends)
+      visitRef(send.m_submix, visitRef);
+    m_linearizedSubmixes.push_back(smx);
+  };
+  for (OfflineBackendSubmix* smx : m_submixes)
+    visit(smx, visit);
+  std::reverse(m_linearizedSubmixes.begin(), m_linearizedSubmixes.end());
+
+  /* Group into levels of submixes that never feed one another. Their effect chains may run
+   * concurrently, while sends stay in this fixed order so the summed output is deterministic. */
+  for (OfflineBackendSubmix* smx : m_linearizedSubmixes)
+    smx->m_level = 0;
+  for (OfflineBackendSubmix* smx : m_linearizedSubmixes)
+    for (const auto& send : smx->m_sends)
+      send.m_submix->m_level = std::max(send.m_submix->m_level, smx->m_level + 1);
+  std::stable_sort(m_linearizedSubmixes.begin(), m_linearizedSubmixes.end(),
+                   [](const auto* a, const auto* b) { return a->m_level < b->m_level; });
+
+  m_levelEnds.clear();
+  for (size_t i = 1; i <= m_linearizedSubmixes.size(); ++i) {
+    if (i == m_linearizedSubmixes.size() || m_linearizedSubmixes[i]->m_level != m_linearizedSubmixes[i - 1]->m_level)
+      m_levelEnds.push_back(i);
+  }
+  m_effectBatch.reserve(m_linearizedSubmixes.size());
+  m_submixesDirty = false;
+}
+
+void OfflineBackendVoiceAllocator::_pumpAndMix5Ms(size_t frames, float* dataOut) {
+  const double dt = frames / m_sampleRate;
+  if (m_cbInterface)
+    m_cbInterface->_on5MsInterval(*this, dt);
+
+  const size_t sampleCount = frames * m_chanMap.m_channelCount;
+  for (OfflineBackendSubmix* smx : m_submixes)
+    smx->m_mixBuf.assign(sampleCount, 0.f);
+
+  /* Voices allocated while pumping are appended and mixed within the same interval.
+   * Stopped voices still get their control update (as boo does); _pumpAndMix skips mixing them. */
+  for (size_t i = 0; i < m_voices.size(); ++i) {
+    if (OfflineBackendVoice* vox = m_voices[i])
+      vox->_pumpAndMix(frames, dt);
+  }
+  if (m_voicesDirty) {
+    m_voices.erase(std::remove(m_voices.begin(), m_voices.end(), nullptr), m_voices.end());
+    m_voicesDirty = false;
+  }
+
+  if (m_submixesDirty)
+    _linearizeSubmixes();
+  std::fill(dataOut, dataOut + sampleCount, 0.f);
+  size_t levelBegin = 0;
+  for (size_t levelEnd : m_levelEnds) {
+    m_effectBatch.clear();
+    for (size_t i = levelBegin; i < levelEnd; ++i)
+      if (m_linearizedSubmixes[i]->m_clientSmx.canApplyEffect())
+        m_effectBatch.push_back(m_linearizedSubmixes[i]);
+
+    if (m_effectWorkers && m_effectBatch.size() > 1) {
+      m_effectWorkers->applyEffects(m_effectBatch.data(), m_effectBatch.size(), frames);
+    } else {
+      for (OfflineBackendSubmix* smx : m_effectBatch)
+        smx->_applyEffects(frames);
+    }
+
+    for (size_t i = levelBegin; i < levelEnd; ++i) {
+      OfflineBackendSubmix* smx = m_linearizedSubmixes[i];
+      smx->_pumpAndMix(frames);
+      if (smx->m_mainOut)
+        for (size_t s = 0; s < sampleCount; ++s)
+          dataOut[s] += smx->m_mixBuf[s] * m_volume;
+    }
+    levelBegin = levelEnd;
+  }
+}
+
+void OfflineBackendVoiceAllocator::pumpAndMixVoices(size_t frames, float* dataOut) {
+  while (frames) {
+    const size_t thisFrames = std::min(frames, m_5msFrames);
+    _pumpAndMix5Ms(thisFrames, dataOut);
+    dataOut += thisFrames * m_chanMap.m_channelCount;
+    frames -= thisFrames;
+  }
+
+  if (m_cbInterface)
+    m_cbInterface->_onPumpCycleComplete(*this);
+}
+
+void OfflineBackendVoiceAllocator::pumpAndMixVoices(size_t frames, int16_t* dataOut) {
+  const size_t sampleCount = frames * m_chanMap.m_channelCount;
+  m_outBuf.resize(sampleCount);
+  pumpAndMixVoices(frames, m_outBuf.data());
+  for (size_t s = 0; s < sampleCount; ++s)
+    dataOut[s] = int16_t(std::clamp(m_outBuf[s] * 32768.f, -32768.f, 32767.f));
+}
+} // namespace amuse
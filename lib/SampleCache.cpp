@@ -0,0 +1,328 @@
+#include "amuse/SampleCache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "amuse/AudioGroup.hpp"
+#include "amuse/DSPCodec.hpp"
+#include "amuse/N64MusyXCodec.hpp"
+
+namespace amuse {
+
+/* Mirrors the sample range Voice::startSample plays before turning over or ending */
+static uint32_t LastSamplePos(const SampleEntryData& entry) {
+  uint32_t last = entry.isLooped() ? (entry.m_loopStartSample + entry.m_loopLengthSamples) : entry.getNumSamples();
+  if (last)
+    --last;
+  return last;
+}
+
+size_t SampleCache::_fill(DecodedSample& decoded, const SampleEntryData& entry, const unsigned char* data,
+                          size_t maxSamples) {
+  const uint32_t endPos = decoded.m_endPos;
+  std::vector<int16_t>& pcm = decoded.m_pcm;
+  size_t done = 0;
+
+  if (decoded.m_format == SampleFormat::N64) {
+    const auto& coefs = entry.m_ADPCMParms.vadpcm.m_coefs;
+    while (decoded.m_fillPos < endPos && done < maxSamples) {
+      const uint32_t b = decoded.m_fillPos / 64;
+      N64MusyXDecompressFrame(pcm.data() + b * 64, data + 256 + 40 * b, coefs, 64);
+      decoded.m_fillPos += 64;
+      done += 64;
+    }
+    if (decoded.m_fillPos >= endPos) {
+      pcm.resize(endPos);
+      decoded.m_ready = true;
+    }
+    return done;
+  }
+
+  const auto& coefs = entry.m_ADPCMParms.dsp.m_coefs;
+  if (!decoded.m_fillLoopPass) {
+    while (decoded.m_fillPos < endPos && done < maxSamples) {
+      const uint32_t b = decoded.m_fillPos / 14;
+      DSPDecompressFrame(pcm.data() + b * 14, data + 8 * b, coefs, &decoded.m_prev1, &decoded.m_prev2, 14);
+      decoded.m_fillPos += 14;
+      done += 14;
+    }
+    if (decoded.m_fillPos < endPos)
+      return done;
+
+    pcm.resize(endPos);
+    if (!decoded.m_hasLoopPass) {
+      decoded.m_ready = true;
+      return done;
+    }
+
+    /* Loop turnovers restart from the stored loop history, which may differ from a linear decode */
+    decoded.m_fillLoopPass = true;
+    decoded.m_fillPos = decoded.m_loopStart;
+    decoded.m_prev1 = entry.m_ADPCMParms.dsp.m_hist1;
+    decoded.m_prev2 = entry.m_ADPCMParms.dsp.m_hist2;
+  }
+
+  int16_t frame[14];
+  while (decoded.m_fillPos < endPos && done < maxSamples) {
+    const uint32_t block = decoded.m_fillPos / 14;
+    const uint32_t rem = decoded.m_fillPos % 14;
+    const unsigned decSamples = DSPDecompressFrameRanged(frame, data + 8 * block, coefs, &decoded.m_prev1,
+                                                         &decoded.m_prev2, rem, std::min(14u, endPos - block * 14));
+    if (decoded.m_loopMatches && !std::equal(frame, frame + decSamples, pcm.begin() + decoded.m_fillPos))
+      decoded.m_loopMatches = false;
+    pcm.insert(pcm.end(), frame, frame + decSamples);
+    decoded.m_fillPos += decSamples;
+    done += decSamples;
+  }
+  if (decoded.m_fillPos >= endPos) {
+    /* Drop the loop pass when the stored history matches the linear decode */
+    if (decoded.m_loopMatches) {
+      pcm.resize(endPos);
+      decoded.m_hasLoopPass = false;
+    }
+    decoded.m_ready = true;
+  }
+  return done;
+}
+
+SampleCache::SampleCache() { m_slots.reserve(SlotCount); }
+
+SampleCache::~SampleCache() {
+  if (m_worker.joinable()) {
+    m_running.store(false, std::memory_order_release);
+    _wakeWorker();
+    m_worker.join();
+  }
+}
+
+/* Bytes of PCM storage a decode needs; zero when the sample is not cacheable */
+static size_t DecodedCapacity(const SampleEntryData& entry, SampleFormat fmt, size_t& linearSize, bool& loopPass) {
+  const uint32_t endPos = LastSamplePos(entry);
+  loopPass = fmt == SampleFormat::DSP && entry.isLooped() && entry.m_loopStartSample < endPos;
+  const uint32_t blockSamples = fmt == SampleFormat::DSP ? 14 : 64;
+  linearSize = (size_t(endPos) + blockSamples - 1) / blockSamples * blockSamples;
+  if (!endPos)
+    return 0;
+  return std::max(linearSize, size_t(endPos) + (loopPass ? endPos - entry.m_loopStartSample : 0));
+}
+
+static SampleFormat CacheFormat(const SampleEntryData& entry) {
+  const SampleFormat fmt = entry.getSampleFormat();
+  return fmt == SampleFormat::DSP_DRUM ? SampleFormat::DSP : fmt;
+}
+
+void SampleCache::_wakeWorker() {
+  m_wake.fetch_add(1, std::memory_order_release);
+  m_wake.notify_one();
+}
+
+bool SampleCache::_cancelled(const Job& job) const {
+  if (!m_cancelling.load(std::memory_order_acquire))
+    return false;
+  const AudioGroup* group = m_cancelGroup.load(std::memory_order_relaxed);
+  return !group || group == job.m_group;
+}
+
+void SampleCache::_run() {
+  while (m_running.load(std::memory_order_acquire)) {
+    const uint32_t wake = m_wake.load(std::memory_order_acquire);
+
+    /* Release whatever the engine thread has let go of */
+    Job job;
+    bool worked = false;
+    while (m_retired.pop(job)) {
+      job = Job();
+      worked = true;
+    }
+
+    if (m_requests.pop(job)) {
+      worked = true;
+      const SampleEntryData& ent = *job.m_entry;
+      const SampleFormat fmt = CacheFormat(ent);
+      size_t linearSize;
+      bool loopPass;
+      const size_t capacity = DecodedCapacity(ent, fmt, linearSize, loopPass);
+
+      /* Storage is claimed up front so the decode slices never reallocate */
+      ObjToken<DecodedSample> decoded = MakeObj<DecodedSample>();
+      decoded->m_endPos = LastSamplePos(ent);
+      decoded->m_loopStart = ent.m_loopStartSample;
+      decoded->m_hasLoopPass = loopPass;
+      decoded->m_format = fmt;
+      decoded->m_pcm.reserve(capacity);
+      decoded->m_pcm.resize(linearSize);
+      while (!decoded->m_ready && !_cancelled(job) && m_running.load(std::memory_order_relaxed))
+        _fill(*decoded, ent, job.m_data, FillSamplesPerSlice);
+
+      if (decoded->m_ready) {
+        job.m_decoded = std::move(decoded);
+        while (!_cancelled(job) && m_running.load(std::memory_order_relaxed) && !m_finished.push(std::move(job)))
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      job = Job();
+      m_outstanding.fetch_sub(1, std::memory_order_release);
+    }
+
+    if (!worked)
+      m_wake.wait(wake, std::memory_order_acquire);
+  }
+}
+
+bool SampleCache::_retire(size_t idx) {
+  Slot& slot = m_slots[idx];
+  if (!m_retired.push(Job{slot.m_group, std::move(slot.m_entry), slot.m_data, std::move(slot.m_decoded)}))
+    return false;
+  m_usage.fetch_sub(slot.m_bytes, std::memory_order_relaxed);
+  if (idx != m_slots.size() - 1)
+    slot = std::move(m_slots.back());
+  m_slots.pop_back();
+  return true;
+}
+
+bool SampleCache::_trim(size_t budget) {
+  bool retired = false;
+  while (m_usage.load(std::memory_order_relaxed) > budget && !m_slots.empty()) {
+    size_t lru = 0;
+    for (size_t i = 1; i < m_slots.size(); ++i)
+      if (m_slots[i].m_lastUse < m_slots[lru].m_lastUse)
+        lru = i;
+    if (!_retire(lru))
+      break;
+    retired = true;
+  }
+  if (retired)
+    _wakeWorker();
+  return m_usage.load(std::memory_order_relaxed) <= budget;
+}
+
+void SampleCache::_publishFinished() {
+  Job job;
+  while (!m_retired.full() && m_finished.pop(job)) {
+    auto search = std::find_if(m_slots.begin(), m_slots.end(), [&](const Slot& slot) {
+      return !slot.m_decoded && slot.m_entry == job.m_entry && slot.m_data == job.m_data;
+    });
+    if (search != m_slots.end()) {
+      search->m_decoded = std::move(job.m_decoded);
+      job = Job();
+    } else {
+      /* Evicted or purged while the worker was decoding it */
+      m_retired.push(std::move(job));
+      _wakeWorker();
+    }
+  }
+}
+
+ObjToken<DecodedSample> SampleCache::lookup(const AudioGroup& group, SampleId id,
+                                            const ObjToken<SampleEntryData>& entry, const unsigned char* data) {
+  const size_t budget = m_budget.load(std::memory_order_relaxed);
+  if (!budget || !group.cachesDecodedSamples() || !data)
+    return {};
+
+  const SampleFormat fmt = CacheFormat(*entry);
+  if (fmt != SampleFormat::DSP && fmt != SampleFormat::N64)
+    return {};
+
+  auto search = std::find_if(m_slots.begin(), m_slots.end(),
+                             [&](const Slot& slot) { return slot.m_group == &group && slot.m_id == id; });
+  if (search != m_slots.end()) {
+    if (search->m_entry == entry && search->m_data == data) {
+      if (!search->m_decoded)
+        return {};
+      ++m_hits;
+      search->m_lastUse = ++m_useTick;
+      return search->m_decoded;
+    }
+    /* Sample was reloaded; the old decode is stale */
+    if (!_retire(size_t(search - m_slots.begin())))
+      return {};
+    _wakeWorker();
+  }
+
+  ++m_misses;
+
+  size_t linearSize;
+  bool loopPass;
+  const size_t bytes = DecodedCapacity(*entry, fmt, linearSize, loopPass) * sizeof(int16_t);
+  if (!bytes || bytes > budget / 4 || m_requests.full())
+    return {};
+  if (!_trim(budget - bytes))
+    return {};
+  if (m_slots.size() == SlotCount) {
+    /* Out of slots; make room by dropping the least recently used entry */
+    if (!_trim(m_usage.load(std::memory_order_relaxed) - 1))
+      return {};
+  }
+
+  m_outstanding.fetch_add(1, std::memory_order_relaxed);
+  m_requests.push(Job{&group, entry, data, {}});
+  m_slots.push_back(Slot{&group, id, entry, data, {}, bytes, ++m_useTick});
+  m_usage.fetch_add(bytes, std::memory_order_relaxed);
+  _wakeWorker();
+  return {};
+}
+
+void SampleCache::release(ObjToken<DecodedSample>& decoded) {
+  if (decoded && m_running.load(std::memory_order_relaxed) &&
+      m_retired.push(Job{nullptr, {}, nullptr, std::move(decoded)}))
+    _wakeWorker();
+  decoded.reset();
+}
+
+void SampleCache::pump() {
+  if (m_finished.empty() && m_usage.load(std::memory_order_relaxed) <= m_budget.load(std::memory_order_relaxed))
+    return;
+  _publishFinished();
+  _trim(m_budget.load(std::memory_order_relaxed));
+}
+
+void SampleCache::setBudget(size_t bytes) {
+  if (bytes) {
+    std::lock_guard<std::mutex> lk(m_workerLock);
+    if (!m_worker.joinable()) {
+      m_running.store(true, std::memory_order_release);
+      m_worker = std::thread(&SampleCache::_run, this);
+    }
+  }
+  m_budget.store(bytes, std::memory_order_relaxed);
+}
+
+void SampleCache::_cancel(const AudioGroup* group) {
+  /* The worker may still be reading the group's sample data; wait for it to drop the requests */
+  m_cancelGroup.store(group, std::memory_order_relaxed);
+  m_cancelling.store(true, std::memory_order_release);
+  while (m_outstanding.load(std::memory_order_acquire)) {
+    _publishFinished();
+    _wakeWorker();
+    std::this_thread::yield();
+  }
+  m_cancelling.store(false, std::memory_order_release);
+}
+
+void SampleCache::purgeGroup(const AudioGroup& group) {
+  _cancel(&group);
+  for (size_t i = 0; i < m_slots.size();) {
+    if (m_slots[i].m_group == &group) {
+      if (!_retire(i)) {
+        /* Retire queue is full; release here rather than wait */
+        m_usage.fetch_sub(m_slots[i].m_bytes, std::memory_order_relaxed);
+        m_slots.erase(m_slots.begin() + i);
+      }
+      continue;
+    }
+    ++i;
+  }
+  _wakeWorker();
+}
+
+void SampleCache::clear() {
+  _cancel(nullptr);
+  while (!m_slots.empty())
+    if (!_retire(m_slots.size() - 1)) {
+      m_usage.fetch_sub(m_slots.back().m_bytes, std::memory_order_relaxed);
+      m_slots.pop_back();
+    }
+  _wakeWorker();
+}
+
+} // namespace amuse
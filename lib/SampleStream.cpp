@@ -0,0 +1,353 @@
+#include "amuse/SampleStream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace amuse {
+
+FileSampleProvider::FileSampleProvider(const SystemChar* path, size_t baseOffset, size_t size)
+: m_fp(FOpen(path, _SYS_STR("rb"))), m_baseOffset(baseOffset), m_size(size) {}
+
+FileSampleProvider::~FileSampleProvider() {
+  if (m_fp)
+    fclose(m_fp);
+}
+
+size_t FileSampleProvider::read(size_t offset, size_t len, unsigned char* out) {
+  if (!m_fp || offset >= m_size)
+    return 0;
+  len = std::min(len, m_size - offset);
+
+  std::lock_guard<std::mutex> lk(m_lock);
+  if (FSeek(m_fp, int64_t(m_baseOffset + offset), SEEK_SET))
+    return 0;
+  return fread(out, 1, len, m_fp);
+}
+
+/* Byte layout of encoded frames: leading header bytes, then fixed-size frames */
+static std::pair<size_t, size_t> FrameLayout(SampleFormat fmt) {
+  switch (fmt) {
+  case SampleFormat::DSP:
+  case SampleFormat::DSP_DRUM:
+    return {0, 8};
+  case SampleFormat::N64:
+    return {256, 40};
+  default:
+    return {0, 2};
+  }
+}
+
+static uint32_t SamplesPerFrame(SampleFormat fmt) {
+  switch (fmt) {
+  case SampleFormat::DSP:
+  case SampleFormat::DSP_DRUM:
+    return 14;
+  case SampleFormat::N64:
+    return 64;
+  default:
+    return 1;
+  }
+}
+
+/* Sample-relative byte offset of the frame holding `sample` */
+static size_t FrameOffset(SampleFormat fmt, uint32_t sample) {
+  const auto [base, frame] = FrameLayout(fmt);
+  return base + sample / SamplesPerFrame(fmt) * frame;
+}
+
+/* Zeroed frames handed out while a segment is still in flight; a whole number of frames of every format */
+static const std::array<unsigned char, 960> ZeroFrames{};
+
+/* Round a span down to whole frames so no frame straddles a head or segment boundary */
+static size_t AlignSpan(size_t base, size_t frame, size_t span) {
+  return base + frame * std::max(size_t(1), (span > base ? span - base : 0) / frame);
+}
+
+size_t SampleStreamer::SampleBytes(const SampleEntryData& entry) {
+  const size_t numSamples = entry.getNumSamples();
+  switch (entry.getSampleFormat()) {
+  case SampleFormat::DSP:
+  case SampleFormat::DSP_DRUM:
+    return (numSamples + 13) / 14 * 8;
+  case SampleFormat::N64:
+    return 256 + (numSamples + 63) / 64 * 40;
+  default:
+    return numSamples * 2;
+  }
+}
+
+SampleStream::SampleStream(SampleStreamer& streamer, size_t sampleOff, size_t sampleBytes, const unsigned char* head,
+                           size_t headLen, size_t segmentLen, unsigned char* buffers)
+: m_streamer(streamer)
+, m_sampleOff(sampleOff)
+, m_sampleBytes(sampleBytes)
+, m_head(head)
+, m_headLen(headLen)
+, m_segmentLen(segmentLen)
+, m_streamEnd(sampleBytes) {
+  m_segments[0].m_data = buffers;
+  m_segments[1].m_data = buffers + segmentLen;
+  m_loopSegment.m_data = buffers + segmentLen * 2;
+}
+
+void SampleStream::operator delete(void* ptr) noexcept {
+  /* m_storage leads the slot, so the object's address is the slot's */
+  static_cast<SampleStreamer::StreamSlot*>(ptr)->m_inUse.store(false, std::memory_order_release);
+}
+
+void SampleStream::_fill(Segment& seg) {
+  const size_t read = m_streamer.m_provider->read(m_sampleOff + seg.m_start, seg.m_len, seg.m_data);
+  if (read < seg.m_len)
+    memset(seg.m_data + read, 0, seg.m_len - read);
+}
+
+SampleStream::Segment* SampleStream::_findSegment(size_t start) {
+  for (Segment& seg : m_segments)
+    if (seg.m_start == start && seg.m_state.load(std::memory_order_acquire) != SegmentState::Empty)
+      return &seg;
+  return nullptr;
+}
+
+void SampleStream::_requestSegment(size_t index, const Segment* inUse) {
+  const size_t start = m_headLen + index * m_segmentLen;
+  if (_findSegment(start))
+    return;
+
+  /* Only a slot that is neither being read nor owned by the I/O thread may be retargeted */
+  for (Segment& seg : m_segments) {
+    if (&seg == inUse || seg.m_state.load(std::memory_order_acquire) == SegmentState::Pending)
+      continue;
+    seg.m_start = start;
+    seg.m_len = std::min(m_segmentLen, m_sampleBytes - start);
+    seg.m_state.store(SegmentState::Pending, std::memory_order_release);
+    if (!m_streamer._request(*this, seg))
+      seg.m_state.store(SegmentState::Empty, std::memory_order_relaxed); /* Queue full; retried on the next read */
+    return;
+  }
+}
+
+void SampleStream::_requestLoopSegment() {
+  m_loopSegment.m_state.store(SegmentState::Pending, std::memory_order_release);
+  if (!m_streamer._request(*this, m_loopSegment))
+    m_loopSegment.m_state.store(SegmentState::Empty, std::memory_order_relaxed);
+}
+
+void SampleStream::_prefetch(size_t index, const Segment* inUse) {
+  size_t next = index + 1;
+  if (m_headLen + next * m_segmentLen >= m_streamEnd) {
+    if (!m_looped)
+      return;
+    /* Turnover goes back through the head when the loop starts inside it */
+    next = m_loopIndex == NoLoopSegment ? 0 : m_loopIndex;
+  }
+  if (next != m_loopIndex && m_headLen + next * m_segmentLen < m_streamEnd)
+    _requestSegment(next, inUse);
+}
+
+const unsigned char* SampleStream::acquire(size_t offset, size_t& avail) {
+  if (offset >= m_sampleBytes) {
+    avail = 0;
+    return nullptr;
+  }
+
+  if (offset < m_headLen) {
+    avail = m_headLen - offset;
+    /* Keep the first segment in flight while the head plays (e.g. after a loop turnover) */
+    if (m_headLen < m_streamEnd && m_loopIndex != 0)
+      _requestSegment(0, nullptr);
+    return m_head + offset;
+  }
+
+  const size_t index = (offset - m_headLen) / m_segmentLen;
+  const size_t start = m_headLen + index * m_segmentLen;
+  Segment* seg = index == m_loopIndex ? &m_loopSegment : _findSegment(start);
+  if (!seg || seg->m_state.load(std::memory_order_acquire) != SegmentState::Ready) {
+    /* Prefetch missed (a seek or a stalled read); play silence until the I/O thread catches up */
+    if (!seg)
+      _requestSegment(index, nullptr);
+    else if (seg == &m_loopSegment && seg->m_state.load(std::memory_order_relaxed) == SegmentState::Empty)
+      _requestLoopSegment();
+    avail = std::min(ZeroFrames.size(), m_sampleBytes - offset);
+    return ZeroFrames.data();
+  }
+
+  /* Keep the next segment in flight while this one is consumed */
+  _prefetch(index, seg);
+
+  avail = seg->m_start + seg->m_len - offset;
+  return seg->m_data + (offset - seg->m_start);
+}
+
+const unsigned char* SampleStream::resident(size_t offset) {
+  if (offset >= m_sampleBytes)
+    return nullptr;
+  if (offset < m_headLen)
+    return m_head + offset;
+
+  const size_t index = (offset - m_headLen) / m_segmentLen;
+  const Segment* seg = index == m_loopIndex ? &m_loopSegment : _findSegment(m_headLen + index * m_segmentLen);
+  if (!seg || seg->m_state.load(std::memory_order_acquire) != SegmentState::Ready)
+    return nullptr;
+  return seg->m_data + (offset - seg->m_start);
+}
+
+SampleStreamer::SampleStreamer(std::shared_ptr<ISampleProvider> provider, const AudioGroupSampleDirectory& sdir,
+                               size_t headBytes, size_t segmentBytes, size_t streamCount)
+: m_provider(std::move(provider))
+, m_headBytes(headBytes)
+, m_segmentBytes(segmentBytes)
+, m_slots(std::make_unique<StreamSlot[]>(streamCount))
+, m_slotCount(streamCount) {
+  m_heads.reserve(sdir.sampleEntries().size());
+  for (const auto& [id, entry] : sdir.sampleEntries()) {
+    const SampleEntryData& data = *entry->m_data;
+    if (data.m_looseData)
+      continue;
+    const auto [base, frame] = FrameLayout(data.getSampleFormat());
+    const size_t headLen = std::min(AlignSpan(base, frame, m_headBytes), SampleBytes(data));
+    std::vector<unsigned char>& head = m_heads[id];
+    head.resize(headLen);
+    const size_t read = m_provider->read(data.m_sampleOff, headLen, head.data());
+    if (read < headLen)
+      memset(head.data() + read, 0, headLen - read);
+  }
+
+  /* Two ring segments and the loop segment per stream; a frame never exceeds the zero-frame span */
+  const size_t bufferBytes = std::max(m_segmentBytes, ZeroFrames.size()) * 3;
+  for (size_t i = 0; i < m_slotCount; ++i)
+    m_slots[i].m_buffers = std::make_unique<unsigned char[]>(bufferBytes);
+
+  for (const auto& [id, entry] : sdir.sampleEntries())
+    if (!entry->m_data->m_looseData && entry->m_data->needsDSPSeekTable())
+      m_seekBuilds.push_back(entry->m_data);
+  if (!m_seekBuilds.empty())
+    m_seekChunk.resize(AlignSpan(0, 8, m_segmentBytes));
+
+  m_thread = std::thread(&SampleStreamer::_run, this);
+}
+
+SampleStreamer::~SampleStreamer() {
+  m_running.store(false, std::memory_order_release);
+  m_wake.fetch_add(1, std::memory_order_release);
+  m_wake.notify_one();
+  m_thread.join();
+}
+
+void SampleStreamer::_run() {
+  while (m_running.load(std::memory_order_acquire)) {
+    const uint32_t wake = m_wake.load(std::memory_order_acquire);
+    if (_serviceRequests())
+      continue;
+    if (m_nextSeekBuild < m_seekBuilds.size()) {
+      _buildSeekTable(*m_seekBuilds[m_nextSeekBuild++]);
+      continue;
+    }
+    m_wake.wait(wake, std::memory_order_acquire);
+  }
+}
+
+bool SampleStreamer::_serviceRequests() {
+  bool serviced = false;
+  Request req;
+  while (m_requests.pop(req)) {
+    req.m_stream->_fill(*req.m_segment);
+    req.m_segment->m_state.store(SampleStream::SegmentState::Ready, std::memory_order_release);
+    req.m_stream.reset();
+    serviced = true;
+  }
+  return serviced;
+}
+
+void SampleStreamer::_buildSeekTable(const SampleEntryData& entry) {
+  /* Read a chunk at a time and let queued segment reads go first every few blocks,
+   * so indexing never holds up a voice for longer than a short decode */
+  const size_t sampleBytes = SampleBytes(entry);
+  size_t chunkStart = 0;
+  size_t chunkLen = 0;
+  entry.buildDSPSeekTable([&](uint32_t b) -> const unsigned char* {
+    if (b % SampleEntryData::DSPSeekBlocks == 0) {
+      _serviceRequests();
+      if (!m_running.load(std::memory_order_acquire))
+        return nullptr;
+    }
+    const size_t offset = size_t(b) * 8;
+    if (offset >= chunkStart + chunkLen) {
+      chunkStart = offset;
+      chunkLen = std::min(m_seekChunk.size(), sampleBytes - offset);
+      const size_t read = m_provider->read(entry.m_sampleOff + offset, chunkLen, m_seekChunk.data());
+      if (read < chunkLen)
+        memset(m_seekChunk.data() + read, 0, chunkLen - read);
+    }
+    return m_seekChunk.data() + (offset - chunkStart);
+  });
+}
+
+bool SampleStreamer::_request(SampleStream& stream, SampleStream::Segment& seg) {
+  if (!m_requests.push(Request{ObjToken<SampleStream>(&stream), &seg}))
+    return false;
+  m_wake.fetch_add(1, std::memory_order_release);
+  m_wake.notify_one();
+  return true;
+}
+
+ObjToken<SampleStream> SampleStreamer::openStream(SampleId id, const SampleEntryData& entry) {
+  auto search = m_heads.find(id);
+  if (search == m_heads.end())
+    return {};
+
+  StreamSlot* slot = nullptr;
+  for (size_t i = 0; i < m_slotCount && !slot; ++i)
+    if (!m_slots[i].m_inUse.load(std::memory_order_relaxed) &&
+        !m_slots[i].m_inUse.exchange(true, std::memory_order_acquire))
+      slot = &m_slots[i];
+  if (!slot)
+    return {};
+
+  const size_t sampleBytes = SampleBytes(entry);
+  const size_t segmentLen = AlignSpan(0, FrameLayout(entry.getSampleFormat()).second, m_segmentBytes);
+  ObjToken<SampleStream> ret(new (slot->m_storage) SampleStream(
+      *this, entry.m_sampleOff, sampleBytes, search->second.data(), search->second.size(), segmentLen,
+      slot->m_buffers.get()));
+
+  if (search->second.size() < sampleBytes) {
+    const SampleFormat fmt = entry.getSampleFormat();
+    if (entry.isLooped()) {
+      const size_t frame = FrameLayout(fmt).second;
+      ret->m_looped = true;
+      ret->m_streamEnd = std::min(sampleBytes, FrameOffset(fmt, entry.getLoopEndSample()) + frame);
+
+      /* The segment turned over into stays resident; the ring then carries on from the one after */
+      const size_t loopOff = FrameOffset(fmt, entry.m_loopStartSample);
+      if (loopOff >= search->second.size() && loopOff < ret->m_streamEnd) {
+        ret->m_loopIndex = (loopOff - search->second.size()) / segmentLen;
+        SampleStream::Segment& loop = ret->m_loopSegment;
+        loop.m_start = search->second.size() + ret->m_loopIndex * segmentLen;
+        loop.m_len = std::min(segmentLen, sampleBytes - loop.m_start);
+        ret->_requestLoopSegment();
+      }
+    }
+
+    /* The resident head covers the latency of fetching the first segment */
+    if (search->second.size() < ret->m_streamEnd && ret->m_loopIndex != 0)
+      ret->_requestSegment(0, nullptr);
+  }
+
+  return ret;
+}
+
+const unsigned char* SampleStreamer::residentData(SampleId id, const SampleEntryData& entry) {
+  std::lock_guard<std::mutex> lk(m_toolingLock);
+  auto search = m_toolingData.find(id);
+  if (search != m_toolingData.end())
+    return search->second.data();
+
+  std::vector<unsigned char>& data = m_toolingData[id];
+  data.resize(SampleBytes(entry));
+  const size_t read = m_provider->read(entry.m_sampleOff, data.size(), data.data());
+  if (read < data.size())
+    memset(data.data() + read, 0, data.size() - read);
+  return data.data();
+}
+
+} // namespace amuse
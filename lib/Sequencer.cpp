@@ -1,5 +1,6 @@
 #include "amuse/Sequencer.hpp"
 
+#include <algorithm>
 #include <map>
 
 #include "amuse/Engine.hpp"
@@ -27,8 +28,6 @@ void Sequencer::ChannelState::_bringOutYourDead() {
     }
     ++it;
   }
-  std::unordered_set<ObjToken<Voice>> newSet = m_keyoffVoxs;
-  m_keyoffVoxs = newSet;
 }
 
 void Sequencer::_bringOutYourDead() {
@@ -74,6 +73,10 @@ Sequencer::Sequencer(Engine& engine, const AudioGroup& group, GroupId groupId, c
 Sequencer::ChannelState::~ChannelState() = default;
 
 Sequencer::ChannelState::ChannelState(Sequencer& parent, uint8_t chanId) : m_parent(&parent), m_chanId(chanId) {
+  /* One voice per key; released voices ring out alongside at most as many again before reuse */
+  m_chanVoxs.reserve(128);
+  m_keyoffVoxs.reserve(128);
+
   if (m_parent->m_songGroup) {
     if (m_parent->m_midiSetup) {
       m_setup = &m_parent->m_midiSetup[chanId];
@@ -158,6 +161,17 @@ void Sequencer::advance(double dt) {
   }
 }
 
+std::vector<std::pair<uint8_t, ObjToken<Voice>>>::iterator Sequencer::ChannelState::_findKey(uint8_t note) {
+  return std::find_if(m_chanVoxs.begin(), m_chanVoxs.end(), [note](const auto& v) { return v.first == note; });
+}
+
+void Sequencer::ChannelState::_setKey(uint8_t note, ObjToken<Voice> vox) {
+  if (auto search = _findKey(note); search != m_chanVoxs.end())
+    search->second = std::move(vox);
+  else
+    m_chanVoxs.emplace_back(note, std::move(vox));
+}
+
 size_t Sequencer::ChannelState::getVoiceCount() const {
   size_t ret = 0;
   for (const auto& vox : m_chanVoxs)
@@ -186,63 +200,71 @@ ObjToken<Voice> Sequencer::ChannelState::keyOn(uint8_t note, uint8_t velocity) {
   if (ObjToken<Voice> lastVoice = m_lastVoice) {
     uint8_t lastNote = lastVoice->getLastNote();
     if (lastVoice->doPortamento(note)) {
-      m_chanVoxs.erase(lastNote);
-      m_chanVoxs[note] = lastVoice;
+      if (auto lastSearch = _findKey(lastNote); lastSearch != m_chanVoxs.end())
+        m_chanVoxs.erase(lastSearch);
+      _setKey(note, lastVoice);
       return lastVoice;
     }
   }
 
   /* Ensure keyoff sent first */
-  auto keySearch = m_chanVoxs.find(note);
-  if (keySearch != m_chanVoxs.cend()) {
+  auto keySearch = _findKey(note);
+  if (keySearch != m_chanVoxs.end()) {
     if (keySearch->second == m_lastVoice)
       m_lastVoice.reset();
     keySearch->second->keyOff();
     keySearch->second->setPedal(false);
-    m_keyoffVoxs.emplace(keySearch->second);
+    m_keyoffVoxs.push_back(keySearch->second);
     m_chanVoxs.erase(keySearch);
   }
 
-  std::list<ObjToken<Voice>>::iterator ret = m_parent->m_engine._allocateVoice(
-      m_parent->m_audioGroup, m_parent->m_groupId, NativeSampleRate, true, false, m_parent->m_studio);
-  if (*ret) {
-    (*ret)->m_sequencer = m_parent;
-    m_chanVoxs[note] = *ret;
-    (*ret)->installCtrlValues(m_ctrlVals.data());
-
-    ObjectId oid;
-    bool res;
-    if (m_parent->m_songGroup) {
-      oid = m_page->objId;
-      res = (*ret)->loadPageObject(oid, m_ticksPerSec, note, velocity, m_ctrlVals[1]);
-    } else if (m_parent->m_sfxMappings.size()) {
-      size_t lookupIdx = note % m_parent->m_sfxMappings.size();
-      const SFXGroupIndex::SFXEntry* sfxEntry = m_parent->m_sfxMappings[lookupIdx];
-      oid = sfxEntry->objId;
-      note = sfxEntry->defKey;
-      res = (*ret)->loadPageObject(oid, m_ticksPerSec, note, velocity, m_ctrlVals[1]);
-    } else
-      return {};
+  /* Resolve page object and voice budget before claiming a voice */
+  ObjectId oid;
+  uint8_t pageKey = note;
+  VoiceBudget budget;
+  if (m_parent->m_songGroup) {
+    oid = m_page->objId;
+    budget = {m_page->priority, m_page->maxVoices, m_page};
+  } else if (m_parent->m_sfxMappings.size()) {
+    size_t lookupIdx = note % m_parent->m_sfxMappings.size();
+    const SFXGroupIndex::SFXEntry* sfxEntry = m_parent->m_sfxMappings[lookupIdx];
+    oid = sfxEntry->objId;
+    pageKey = sfxEntry->defKey;
+    budget = {sfxEntry->priority, sfxEntry->maxVoices, sfxEntry};
+  } else
+    return {};
+
+  if (!m_parent->m_engine._reserveVoice(budget))
+    return {};
+
+  ObjToken<Voice> ret = m_parent->m_engine._allocateVoice(m_parent->m_audioGroup, m_parent->m_groupId,
+                                                         NativeSampleRate, true, false, m_parent->m_studio, budget);
+  if (ret) {
+    ret->m_sequencer = m_parent;
+    _setKey(note, ret);
+    ret->installCtrlValues(m_ctrlVals.data());
+
+    const bool res = ret->loadPageObject(oid, m_ticksPerSec, pageKey, velocity, m_ctrlVals[1]);
 
     if (!res) {
-      m_parent->m_engine._destroyVoice(ret);
+      m_parent->m_engine._destroyVoice(ret.get());
       return {};
     }
-    (*ret)->setVolume(m_parent->m_curVol * m_curVol);
-    (*ret)->setReverbVol(m_ctrlVals[0x5b] / 127.f);
-    (*ret)->setAuxBVol(m_ctrlVals[0x5d] / 127.f);
-    (*ret)->setPan(m_curPan);
-    (*ret)->setPitchWheel(m_curPitchWheel);
+    ret->setVolume(m_parent->m_curVol * m_curVol);
+    ret->setReverbVol(m_ctrlVals[0x5b] / 127.f);
+    ret->setAuxBVol(m_ctrlVals[0x5d] / 127.f);
+    ret->setPan(m_curPan);
+    ret->setPitchWheel(m_curPitchWheel);
     if (m_pitchWheelRange != -1)
-      (*ret)->setPitchWheelRange(m_pitchWheelRange, m_pitchWheelRange);
+      ret->setPitchWheelRange(m_pitchWheelRange, m_pitchWheelRange);
 
     if (m_ctrlVals[64] > 64)
-      (*ret)->setPedal(true);
+      ret->setPedal(true);
 
-    m_lastVoice = *ret;
+    m_lastVoice = ret;
   }
 
-  return *ret;
+  return ret;
 }
 
 ObjToken<Voice> Sequencer::keyOn(uint8_t chan, uint8_t note, uint8_t velocity) {
@@ -254,18 +276,23 @@ ObjToken<Voice> Sequencer::keyOn(uint8_t chan, uint8_t note, uint8_t velocity) {
     m_chanStates[chan] = ChannelState(*this, chan);
   }
 
+  if (m_seeking) {
+    m_chanStates[chan].m_seekKeys[note & 0x7f] = 0x80 | (velocity & 0x7f);
+    return {};
+  }
+
   return m_chanStates[chan].keyOn(note, velocity);
 }
 
 void Sequencer::ChannelState::keyOff(uint8_t note, uint8_t velocity) {
-  auto keySearch = m_chanVoxs.find(note);
-  if (keySearch == m_chanVoxs.cend())
+  auto keySearch = _findKey(note);
+  if (keySearch == m_chanVoxs.end())
     return;
 
   if ((m_lastVoice && m_lastVoice->isDestroyed()) || keySearch->second == m_lastVoice)
     m_lastVoice.reset();
   keySearch->second->keyOff();
-  m_keyoffVoxs.emplace(keySearch->second);
+  m_keyoffVoxs.push_back(keySearch->second);
   m_chanVoxs.erase(keySearch);
 }
 
@@ -274,6 +301,11 @@ void Sequencer::keyOff(uint8_t chan, uint8_t note, uint8_t velocity) {
     return;
   }
 
+  if (m_seeking) {
+    m_chanStates[chan].m_seekKeys[note & 0x7f] = 0;
+    return;
+  }
+
   m_chanStates[chan].keyOff(note, velocity);
 }
 
@@ -405,7 +437,7 @@ void Sequencer::ChannelState::allOff() {
     if (it->second == m_lastVoice)
       m_lastVoice.reset();
     it->second->keyOff();
-    m_keyoffVoxs.emplace(it->second);
+    m_keyoffVoxs.push_back(it->second);
     it = m_chanVoxs.erase(it);
   }
 }
@@ -462,7 +494,7 @@ void Sequencer::ChannelState::killKeygroup(uint8_t kg, bool now) {
         continue;
       }
       vox->keyOff();
-      m_keyoffVoxs.emplace(it->second);
+      m_keyoffVoxs.push_back(it->second);
       it = m_chanVoxs.erase(it);
       continue;
     }
@@ -536,6 +568,55 @@ void Sequencer::playSong(const unsigned char* arrData, bool loop, bool dieOnEnd)
   m_state = SequencerState::Playing;
 }
 
+void Sequencer::seek(double seconds, bool retrigger) {
+  if (!m_arrData)
+    return;
+
+  /* Replay from the start so controller state never leaks back from a later position */
+  allOff(true);
+  for (size_t i = 0; i < m_chanStates.size(); ++i)
+    if (m_chanStates[i])
+      m_chanStates[i] = ChannelState(*this, uint8_t(i));
+  m_songState.initialize(m_arrData, m_songState.isLooping());
+  setTempo(m_songState.getInitialTempo() * 384 / 60.0);
+
+  /* Step in the engine's 5ms intervals so tempo turnovers and note-offs land exactly as in realtime;
+   * with no voices to update each step is only a walk over the compiled event arrays */
+  constexpr double Step = 0.005;
+  m_seeking = true;
+  bool ended = false;
+  for (double remaining = seconds; remaining > 0.0 && !ended; remaining -= Step)
+    ended = m_songState.advance(*this, std::min(Step, remaining));
+  m_seeking = false;
+  m_engine.setEventOffset(0.0);
+
+  if (ended) {
+    for (auto& chan : m_chanStates)
+      chan.m_seekKeys.fill(0);
+    m_arrData = nullptr;
+    m_state = SequencerState::Interactive;
+    return;
+  }
+
+  for (size_t i = 0; i < m_chanStates.size(); ++i) {
+    ChannelState& chan = m_chanStates[i];
+    if (!chan)
+      continue;
+    for (uint8_t note = 0; note < 128; ++note) {
+      const uint8_t key = chan.m_seekKeys[note];
+      chan.m_seekKeys[note] = 0;
+      if (key && retrigger)
+        chan.keyOn(note, key & 0x7f);
+    }
+  }
+}
+
+void Sequencer::seekTicks(uint32_t ticks, bool retrigger) {
+  if (!m_arrData)
+    return;
+  seek(m_songState.getTickTime(ticks), retrigger);
+}
+
 void Sequencer::stopSong(float fadeTime, bool now) {
   if (fadeTime == 0.f) {
     allOff(now);
@@ -1,8 +1,11 @@
 #include "amuse/SongState.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
 
 #include "amuse/Common.hpp"
+#include "amuse/Engine.hpp"
 #include "amuse/Sequencer.hpp"
 
 namespace amuse {
@@ -110,6 +113,13 @@ SongState::Header& SongState::Header::operator=(const Header& other) {
   return *this;
 }
 
+void SongState::TrackRegion::swapBig() {
+  m_startTick = SBig(m_startTick);
+  m_unk2 = SBig(m_unk2);
+  m_regionIndex = SBig(m_regionIndex);
+  m_loopToRegion = SBig(m_loopToRegion);
+}
+
 bool SongState::TrackRegion::indexDone(bool bigEndian, bool loop) const {
   int16_t idx = (bigEndian ? SBig(m_regionIndex) : m_regionIndex);
   return loop ? (idx == -1) : (idx < 0);
@@ -146,6 +156,16 @@ SongState::Track::Track(SongState& parent, uint8_t midiChan, uint32_t loopStart,
 , m_loopStartTick(loopStart)
 , m_tempo(tempo) {
   resetTempo();
+
+  /* Native copy of the region list, through its terminating entry */
+  for (const TrackRegion* region = regions;; ++region) {
+    TrackRegion native = *region;
+    if (parent.m_bigEndian)
+      native.swapBig();
+    m_regions.push_back(native);
+    if (!native.indexValid(false))
+      break;
+  }
 }
 
 void SongState::Track::setRegion(const TrackRegion* region) {
@@ -197,10 +217,103 @@ void SongState::Track::setRegion(const TrackRegion* region) {
     m_lastN64EventTick = absTick;
     m_data += 4;
   }
+
+  m_compiled = &m_parent->m_compiledRegions[regionIdx];
+  m_eventIdx = 0;
+  m_pitchIdx = 0;
+  m_modIdx = 0;
+  m_regionElapsed = 0;
+  m_regionBaseTick = m_curTick;
 }
 
 void SongState::Track::advanceRegion() { setRegion(m_nextRegion); }
 
+const SongState::TrackRegion& SongState::Track::_nextRegion() const {
+  const size_t idx = size_t(m_nextRegion - m_initRegion);
+  return idx < m_regions.size() ? m_regions[idx] : m_regions.back();
+}
+
+void SongState::_compileRegion(CompiledRegion& out, uint32_t regionIdx) const {
+  const unsigned char* data = m_songData + (m_bigEndian ? SBig(m_regionIdx[regionIdx]) : m_regionIdx[regionIdx]);
+
+  Track::Header header = *reinterpret_cast<const Track::Header*>(data);
+  if (m_bigEndian)
+    header.swapBig();
+  data += 12;
+
+  /* Continuous wheel data, accumulated into ticks from region start */
+  auto compileDeltas = [this](std::vector<std::pair<uint32_t, int32_t>>& deltas, uint32_t off) {
+    if (!off)
+      return;
+    const unsigned char* dptr = m_songData + off;
+    uint32_t tick = 0;
+    while (dptr[0] != 0x80 || dptr[1] != 0x00) {
+      auto delta = DecodeDelta(dptr);
+      tick += delta.first;
+      deltas.emplace_back(tick, delta.second);
+    }
+  };
+  compileDeltas(out.m_pitch, header.m_pitchOff);
+  compileDeltas(out.m_mod, header.m_modOff);
+
+  using EventType = CompiledRegion::EventType;
+  if (m_sngVersion == 1) {
+    /* Revision */
+    int32_t tick = int32_t(DecodeTime(data));
+    while (true) {
+      if (*reinterpret_cast<const uint16_t*>(data) == 0xffff) {
+        /* End of channel */
+        out.m_events.push_back({tick, EventType::End, 0, 0, 0});
+        break;
+      } else if (data[0] & 0x80 && data[1] & 0x80) {
+        /* Control change */
+        out.m_events.push_back({tick, EventType::Control, uint8_t(data[1] & 0x7f), uint8_t(data[0] & 0x7f), 0});
+        data += 2;
+      } else if (data[0] & 0x80) {
+        /* Program change */
+        out.m_events.push_back({tick, EventType::Program, uint8_t(data[0] & 0x7f), 0, 0});
+        data += 2;
+      } else {
+        /* Note */
+        uint16_t length = (m_bigEndian ? SBig(*reinterpret_cast<const uint16_t*>(data + 2))
+                                       : *reinterpret_cast<const uint16_t*>(data + 2));
+        out.m_events.push_back({tick, EventType::Note, uint8_t(data[0] & 0x7f), uint8_t(data[1] & 0x7f), length});
+        data += 4;
+      }
+
+      /* Next delta-time */
+      tick += int32_t(DecodeTime(data));
+    }
+  } else {
+    /* Legacy; command times are absolute */
+    int32_t tick = (m_bigEndian ? SBig(*reinterpret_cast<const int32_t*>(data)) : *reinterpret_cast<const int32_t*>(data));
+    data += 4;
+    while (true) {
+      if (*reinterpret_cast<const uint16_t*>(&data[2]) == 0xffff) {
+        /* End of channel */
+        out.m_events.push_back({tick, EventType::End, 0, 0, 0});
+        break;
+      } else if ((data[2] & 0x80) != 0x80) {
+        /* Note */
+        uint16_t length =
+            (m_bigEndian ? SBig(*reinterpret_cast<const uint16_t*>(data)) : *reinterpret_cast<const uint16_t*>(data));
+        out.m_events.push_back({tick, EventType::Note, uint8_t(data[2] & 0x7f), uint8_t(data[3] & 0x7f), length});
+      } else if (data[2] & 0x80 && data[3] & 0x80) {
+        /* Control change */
+        out.m_events.push_back({tick, EventType::Control, uint8_t(data[3] & 0x7f), uint8_t(data[2] & 0x7f), 0});
+      } else if (data[2] & 0x80) {
+        /* Program change */
+        out.m_events.push_back({tick, EventType::Program, uint8_t(data[2] & 0x7f), 0, 0});
+      }
+      data += 4;
+
+      /* Next command time */
+      tick = (m_bigEndian ? SBig(*reinterpret_cast<const int32_t*>(data)) : *reinterpret_cast<const int32_t*>(data));
+      data += 4;
+    }
+  }
+}
+
 int SongState::DetectVersion(const unsigned char* ptr, bool& isBig) {
   isBig = ptr[0] == 0;
   Header header = *reinterpret_cast<const Header*>(ptr);
@@ -358,6 +471,20 @@ bool SongState::initialize(const unsigned char* ptr, bool loop) {
   m_regionIdx = reinterpret_cast<const uint32_t*>(ptr + m_header.m_regionIdxOff);
   const uint8_t* chanMap = reinterpret_cast<const uint8_t*>(ptr + m_header.m_chanMapOff);
 
+  /* Native tempo table */
+  m_tempoChanges.clear();
+  if (m_header.m_tempoTableOff) {
+    for (const TempoChange* change = reinterpret_cast<const TempoChange*>(ptr + m_header.m_tempoTableOff);;
+         ++change) {
+      TempoChange native = *change;
+      if (m_bigEndian)
+        native.swapBig();
+      m_tempoChanges.push_back(native);
+      if (native.m_tick == 0xffffffff)
+        break;
+    }
+  }
+
   /* Initialize all tracks */
   for (int i = 0; i < 64; ++i) {
     if (trackIdx[i]) {
@@ -371,18 +498,66 @@ bool SongState::initialize(const unsigned char* ptr, bool loop) {
       m_tracks[i] = Track();
   }
 
+  /* Compile every region referenced by a track so playback never parses SNG data */
+  std::vector<bool> referenced;
+  for (const Track& trk : m_tracks) {
+    if (!trk)
+      continue;
+    for (const TrackRegion& region : trk.m_regions) {
+      if (!region.indexValid(false))
+        break;
+      if (size_t(region.m_regionIndex) >= referenced.size())
+        referenced.resize(region.m_regionIndex + 1);
+      referenced[region.m_regionIndex] = true;
+    }
+  }
+  m_compiledRegions.clear();
+  m_compiledRegions.resize(referenced.size());
+  for (size_t i = 0; i < referenced.size(); ++i)
+    if (referenced[i])
+      _compileRegion(m_compiledRegions[i], uint32_t(i));
+
   m_songState = SongPlayState::Playing;
 
   return true;
 }
 
 void SongState::Track::resetTempo() {
-  if (m_parent->m_header.m_tempoTableOff)
-    m_tempoPtr = reinterpret_cast<const TempoChange*>(m_parent->m_songData + m_parent->m_header.m_tempoTableOff);
+  if (!m_parent->m_tempoChanges.empty())
+    m_tempoPtr = m_parent->m_tempoChanges.data();
   else
     m_tempoPtr = nullptr;
 }
 
+/* Place the next dispatched event at its position inside the interval just advanced;
+ * the cycle's last elapsed tick falls m_remDt seconds before the interval ends */
+void SongState::Track::_placeEvent(Sequencer& seq, double dt, double ticksPerSecond, int32_t ticksBeforeEnd) const {
+  double offset = 0.0;
+  if (ticksPerSecond > 0.0)
+    offset = std::clamp(dt - m_remDt - std::max(0, ticksBeforeEnd) / ticksPerSecond, 0.0, dt);
+  seq.getEngine().setEventOffset(offset);
+}
+
+/* Note-off times are compared by signed distance so clock wraparound behaves like per-note countdowns */
+void SongState::Track::_stopDueNotes(Sequencer& seq, double dt, double ticksPerSecond) {
+  int32_t nextRem = INT32_MAX;
+  for (size_t w = 0; w < m_activeNotes.size(); ++w) {
+    for (uint64_t bits = m_activeNotes[w]; bits; bits &= bits - 1) {
+      const int bit = std::countr_zero(bits);
+      const int note = int(w * 64) + bit;
+      const int32_t rem = int32_t(m_noteOffTicks[note] - m_noteClock);
+      if (rem <= 0) {
+        _placeEvent(seq, dt, ticksPerSecond, -rem);
+        seq.keyOff(m_midiChan, note, 0);
+        m_activeNotes[w] &= ~(uint64_t(1) << bit);
+      } else {
+        nextRem = std::min(nextRem, rem);
+      }
+    }
+  }
+  m_nextNoteOff = m_noteClock + uint32_t(nextRem);
+}
+
 bool SongState::Track::advance(Sequencer& seq, double dt) {
   m_remDt += dt;
 
@@ -392,9 +567,7 @@ bool SongState::Track::advance(Sequencer& seq, double dt) {
 
   /* See if there's an upcoming tempo change in this interval */
   while (m_tempoPtr && m_tempoPtr->m_tick != 0xffffffff) {
-    TempoChange change = *m_tempoPtr;
-    if (m_parent->m_bigEndian)
-      change.swapBig();
+    const TempoChange& change = *m_tempoPtr;
 
     if (m_curTick + ticks > change.m_tick)
       ticks = change.m_tick - m_curTick;
@@ -415,162 +588,75 @@ bool SongState::Track::advance(Sequencer& seq, double dt) {
   uint32_t endTick = m_curTick + ticks;
 
   /* Advance region if needed */
-  while (m_nextRegion->indexValid(m_parent->m_bigEndian)) {
-    uint32_t nextRegTick = (m_parent->m_bigEndian ? SBig(m_nextRegion->m_startTick) : m_nextRegion->m_startTick);
-    if (uint32_t(endTick) > nextRegTick)
-      advanceRegion();
-    else
+  while (true) {
+    const TrackRegion& next = _nextRegion();
+    if (!next.indexValid(false) || endTick <= next.m_startTick)
       break;
+    advanceRegion();
   }
 
   /* Stop finished notes */
-  for (int i = 0; i < 128; ++i) {
-    if (m_remNoteLengths[i] > 0) {
-      m_remNoteLengths[i] -= ticks;
-      if (m_remNoteLengths[i] <= 0)
-        seq.keyOff(m_midiChan, i, 0);
-    }
-  }
+  m_noteClock += ticks;
+  if ((m_activeNotes[0] | m_activeNotes[1]) && int32_t(m_nextNoteOff - m_noteClock) <= 0)
+    _stopDueNotes(seq, dt, ticksPerSecond);
 
   if (m_data) {
+    const CompiledRegion& region = *m_compiled;
+
+    /* Wheel changes falling before the end of this cycle (signed, as the SNG tick arithmetic is) */
+    auto due = [&](uint32_t regionTick) {
+      return int32_t(m_curTick) < int32_t(endTick) && int32_t(m_regionBaseTick + regionTick) < int32_t(endTick);
+    };
+
     /* Update continuous pitch data */
-    if (m_pitchWheelData) {
-      int32_t pitchTick = m_curTick;
-      int32_t remPitchTicks = ticks;
-      while (pitchTick < int32_t(endTick)) {
-        /* See if there's an upcoming pitch change in this interval */
-        int32_t nextTick = m_nextPitchTick;
-        if (pitchTick + remPitchTicks > nextTick) {
-          /* Update pitch */
-          m_pitchVal += m_nextPitchDelta;
-          seq.setPitchWheel(m_midiChan, std::clamp(m_pitchVal / 8191.f, -1.f, 1.f));
-          if (m_pitchWheelData[0] != 0x80 || m_pitchWheelData[1] != 0x00) {
-            auto delta = DecodeDelta(m_pitchWheelData);
-            m_nextPitchTick += delta.first;
-            m_nextPitchDelta = delta.second;
-          } else {
-            m_nextPitchTick = 0x7fffffff;
-          }
-        }
-        remPitchTicks -= (nextTick - pitchTick);
-        pitchTick = nextTick;
-      }
+    for (; m_pitchIdx < region.m_pitch.size() && due(region.m_pitch[m_pitchIdx].first); ++m_pitchIdx) {
+      m_pitchVal += region.m_pitch[m_pitchIdx].second;
+      seq.setPitchWheel(m_midiChan, std::clamp(m_pitchVal / 8191.f, -1.f, 1.f));
     }
 
     /* Update continuous modulation data */
-    if (m_modWheelData) {
-      int32_t modTick = m_curTick;
-      int32_t remModTicks = ticks;
-      while (modTick < int32_t(endTick)) {
-        /* See if there's an upcoming modulation change in this interval */
-        int32_t nextTick = m_nextModTick;
-        if (modTick + remModTicks > nextTick) {
-          /* Update modulation */
-          m_modVal += m_nextModDelta;
-          seq.setCtrlValue(m_midiChan, 1, int8_t(std::clamp(m_modVal / 127, 0, 127)));
-          if (m_modWheelData[0] != 0x80 || m_modWheelData[1] != 0x00) {
-            auto delta = DecodeDelta(m_modWheelData);
-            m_nextModTick += delta.first;
-            m_nextModDelta = delta.second;
-          } else {
-            m_nextModTick = 0x7fffffff;
-          }
-        }
-        remModTicks -= (nextTick - modTick);
-        modTick = nextTick;
-      }
+    for (; m_modIdx < region.m_mod.size() && due(region.m_mod[m_modIdx].first); ++m_modIdx) {
+      m_modVal += region.m_mod[m_modIdx].second;
+      seq.setCtrlValue(m_midiChan, 1, int8_t(std::clamp(m_modVal / 127, 0, 127)));
     }
 
-    /* Loop through as many commands as we can for this time period */
-    if (m_parent->m_sngVersion == 1) {
-      /* Revision */
-      while (true) {
-        /* Advance wait timer if active, returning if waiting */
-        if (m_eventWaitCountdown) {
-          m_eventWaitCountdown -= ticks;
-          ticks = 0;
-          if (m_eventWaitCountdown > 0)
-            break;
-        }
-
-        /* Load next command */
-        if (*reinterpret_cast<const uint16_t*>(m_data) == 0xffff) {
-          /* End of channel */
-          m_data = nullptr;
+    /* Dispatch commands that have come due; as with the SNG wait countdown,
+     * this cycle's ticks are applied at the first command not already due */
+    while (m_data && m_eventIdx < region.m_events.size()) {
+      const CompiledRegion::Event& ev = region.m_events[m_eventIdx];
+      if (uint32_t(ev.m_tick) != m_regionElapsed) {
+        m_regionElapsed += ticks;
+        ticks = 0;
+        if (int32_t(uint32_t(ev.m_tick) - m_regionElapsed) > 0)
           break;
-        } else if (m_data[0] & 0x80 && m_data[1] & 0x80) {
-          /* Control change */
-          uint8_t val = m_data[0] & 0x7f;
-          uint8_t ctrl = m_data[1] & 0x7f;
-          seq.setCtrlValue(m_midiChan, ctrl, val);
-          m_data += 2;
-        } else if (m_data[0] & 0x80) {
-          /* Program change */
-          uint8_t prog = m_data[0] & 0x7f;
-          seq.setChanProgram(m_midiChan, prog);
-          m_data += 2;
-        } else {
-          /* Note */
-          uint8_t note = m_data[0] & 0x7f;
-          uint8_t vel = m_data[1] & 0x7f;
-          uint16_t length = (m_parent->m_bigEndian ? SBig(*reinterpret_cast<const uint16_t*>(m_data + 2))
-                                                   : *reinterpret_cast<const uint16_t*>(m_data + 2));
-          seq.keyOn(m_midiChan, note, vel);
-          if (length == 0)
-            seq.keyOff(m_midiChan, note, 0);
-          m_remNoteLengths[note] = length;
-          m_data += 4;
-        }
-
-        /* Set next delta-time */
-        m_eventWaitCountdown += int32_t(DecodeTime(m_data));
       }
-    } else {
-      /* Legacy */
-      while (true) {
-        /* Advance wait timer if active, returning if waiting */
-        if (m_eventWaitCountdown) {
-          m_eventWaitCountdown -= ticks;
-          ticks = 0;
-          if (m_eventWaitCountdown > 0)
-            break;
-        }
-
-        /* Load next command */
-        if (*reinterpret_cast<const uint16_t*>(&m_data[2]) == 0xffff) {
-          /* End of channel */
-          m_data = nullptr;
-          break;
+      ++m_eventIdx;
+
+      switch (ev.m_type) {
+      case CompiledRegion::EventType::Note:
+        _placeEvent(seq, dt, ticksPerSecond, int32_t(m_regionElapsed + ticks - uint32_t(ev.m_tick)));
+        seq.keyOn(m_midiChan, ev.m_a, ev.m_b);
+        if (ev.m_length == 0) {
+          seq.keyOff(m_midiChan, ev.m_a, 0);
+          m_activeNotes[ev.m_a / 64] &= ~(uint64_t(1) << (ev.m_a % 64));
         } else {
-          if ((m_data[2] & 0x80) != 0x80) {
-            /* Note */
-            uint16_t length = (m_parent->m_bigEndian ? SBig(*reinterpret_cast<const uint16_t*>(m_data))
-                                                     : *reinterpret_cast<const uint16_t*>(m_data));
-            uint8_t note = m_data[2] & 0x7f;
-            uint8_t vel = m_data[3] & 0x7f;
-            seq.keyOn(m_midiChan, note, vel);
-            if (length == 0)
-              seq.keyOff(m_midiChan, note, 0);
-            m_remNoteLengths[note] = length;
-          } else if (m_data[2] & 0x80 && m_data[3] & 0x80) {
-            /* Control change */
-            uint8_t val = m_data[2] & 0x7f;
-            uint8_t ctrl = m_data[3] & 0x7f;
-            seq.setCtrlValue(m_midiChan, ctrl, val);
-          } else if (m_data[2] & 0x80) {
-            /* Program change */
-            uint8_t prog = m_data[2] & 0x7f;
-            seq.setChanProgram(m_midiChan, prog);
-          }
-          m_data += 4;
+          const uint32_t offTick = m_noteClock + ev.m_length;
+          if (!(m_activeNotes[0] | m_activeNotes[1]) || int32_t(offTick - m_nextNoteOff) < 0)
+            m_nextNoteOff = offTick;
+          m_activeNotes[ev.m_a / 64] |= uint64_t(1) << (ev.m_a % 64);
+          m_noteOffTicks[ev.m_a] = offTick;
         }
-
-        /* Set next delta-time */
-        int32_t absTick = (m_parent->m_bigEndian ? SBig(*reinterpret_cast<const int32_t*>(m_data))
-                                                 : *reinterpret_cast<const int32_t*>(m_data));
-        m_eventWaitCountdown += absTick - m_lastN64EventTick;
-        m_lastN64EventTick = absTick;
-        m_data += 4;
+        break;
+      case CompiledRegion::EventType::Control:
+        seq.setCtrlValue(m_midiChan, ev.m_a, ev.m_b);
+        break;
+      case CompiledRegion::EventType::Program:
+        seq.setChanProgram(m_midiChan, ev.m_a);
+        break;
+      case CompiledRegion::EventType::End:
+        /* End of channel */
+        m_data = nullptr;
+        break;
       }
     }
   }
@@ -579,10 +665,10 @@ bool SongState::Track::advance(Sequencer& seq, double dt) {
 
   /* Handle loop end */
   if (m_parent->m_loop) {
+    const TrackRegion& next = _nextRegion();
     int loopTo;
-    if ((loopTo = m_nextRegion->indexLoop(m_parent->m_bigEndian)) != -1) {
-      uint32_t loopEndTick = (m_parent->m_bigEndian ? SBig(m_nextRegion->m_startTick) : m_nextRegion->m_startTick);
-      if (uint32_t(endTick) > loopEndTick) {
+    if ((loopTo = next.indexLoop(false)) != -1) {
+      if (endTick > next.m_startTick) {
         m_nextRegion = &m_initRegion[loopTo];
         m_curRegion = nullptr;
         m_data = nullptr;
@@ -594,11 +680,28 @@ bool SongState::Track::advance(Sequencer& seq, double dt) {
   }
 
   if (!m_data)
-    return m_nextRegion->indexDone(m_parent->m_bigEndian, m_parent->m_loop);
+    return _nextRegion().indexDone(false, m_parent->m_loop);
 
   return false;
 }
 
+double SongState::getTickTime(uint32_t tick) const {
+  /* Same integer ticks-per-second rounding as Track::advance */
+  auto tickRate = [](uint32_t tempo) { return double(std::max(1u, tempo * 384 / 60)); };
+
+  uint32_t tempo = getInitialTempo();
+  uint32_t lastTick = 0;
+  double time = 0.0;
+  for (const TempoChange& change : m_tempoChanges) {
+    if (change.m_tick == 0xffffffff || change.m_tick >= tick)
+      break;
+    time += (change.m_tick - lastTick) / tickRate(tempo);
+    lastTick = change.m_tick;
+    tempo = change.m_tempo & 0x7fffffff;
+  }
+  return time + (tick - lastTick) / tickRate(tempo);
+}
+
 bool SongState::advance(Sequencer& seq, double dt) {
   /* Stopped */
   if (m_songState == SongPlayState::Stopped)
@@ -376,7 +376,8 @@ const SoundMacro::CmdIntrospection SoundMacro::CmdPlayMacro::Introspective = {
      {FIELD_HEAD(SoundMacro::CmdPlayMacro, priority), "Priority"sv, 0, 127, 50},
      {FIELD_HEAD(SoundMacro::CmdPlayMacro, maxVoices), "Max Voices"sv, 0, 255, 255}}}};
 bool SoundMacro::CmdPlayMacro::Do(SoundMacroState& st, Voice& vox) const {
-  ObjToken<Voice> sibVox = vox.startChildMacro(addNote, macro.id, macroStep.step);
+  ObjToken<Voice> sibVox = vox._startChildMacro(macro.id, macroStep.step, 1000.0, st.m_initKey + addNote, st.m_initVel,
+                                                st.m_initMod, false, {priority, maxVoices, this});
   if (sibVox)
     st.m_lastPlayMacroVid = sibVox->vid();
 
@@ -1070,14 +1071,20 @@ const SoundMacro::CmdIntrospection SoundMacro::CmdSetPriority::Introspective = {
     "Set Priority"sv,
     "Sets the priority of the current voice."sv,
     {{{FIELD_HEAD(SoundMacro::CmdSetPriority, prio), "Priority"sv, 0, 254, 50}}}};
-bool SoundMacro::CmdSetPriority::Do(SoundMacroState& st, Voice& vox) const { return false; }
+bool SoundMacro::CmdSetPriority::Do(SoundMacroState& st, Voice& vox) const {
+  vox.m_priority = prio;
+  return false;
+}
 
 const SoundMacro::CmdIntrospection SoundMacro::CmdAddPriority::Introspective = {
     CmdType::Special,
     "Add Priority"sv,
     "Adds to the priority of the current voice."sv,
     {{{FIELD_HEAD(SoundMacro::CmdAddPriority, prio), "Priority"sv, -255, 255, 1}}}};
-bool SoundMacro::CmdAddPriority::Do(SoundMacroState& st, Voice& vox) const { return false; }
+bool SoundMacro::CmdAddPriority::Do(SoundMacroState& st, Voice& vox) const {
+  vox.m_priority = uint8_t(std::clamp(vox.m_priority + prio, 0, 255));
+  return false;
+}
 
 const SoundMacro::CmdIntrospection SoundMacro::CmdAgeCntSpeed::Introspective = {
     CmdType::Special,
@@ -14,12 +14,21 @@ bool Studio::_cyclicCheck(const Studio* leaf) const {
 }
 #endif
 
-Studio::Studio(Engine& engine, bool mainOut) : m_engine(engine), m_master(engine), m_auxA(engine), m_auxB(engine) {
+Studio::Studio(Engine& engine, bool mainOut)
+: m_engine(engine), m_master(engine), m_auxA(engine), m_auxB(engine), m_mainOut(mainOut) {
   if (mainOut && engine.m_defaultStudioReady)
     addStudioSend(engine.getDefaultStudio(), 1.f, 1.f, 1.f);
 }
 
 void Studio::addStudioSend(ObjToken<Studio> studio, float dry, float auxA, float auxB) {
+  /* Main-out studios already reach the output directly; others are routed into the target's busses
+   * by backends that mix the studio graph themselves */
+  if (!m_mainOut) {
+    m_master.m_backendSubmix->addStudioSend(studio->m_master.m_backendSubmix.get(), dry);
+    m_auxA.m_backendSubmix->addStudioSend(studio->m_auxA.m_backendSubmix.get(), auxA);
+    m_auxB.m_backendSubmix->addStudioSend(studio->m_auxB.m_backendSubmix.get(), auxB);
+  }
+
   m_studiosOut.emplace_back(std::move(studio), dry, auxA, auxB);
 
   /* Cyclic check */
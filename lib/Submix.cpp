@@ -1,5 +1,10 @@
 #include "amuse/Submix.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
 namespace amuse {
 
 Submix::Submix(Engine& engine) : m_root(engine) {}
@@ -29,22 +34,114 @@ EffectReverbHi& Submix::makeReverbHi(float coloration, float mix, float time, fl
 
 EffectReverbHi& Submix::makeReverbHi(const EffectReverbHiInfo& info) { return makeEffect<EffectReverbHi>(info); }
 
+size_t Submix::getEffectTailFrames() const {
+  /* Effects run in series, so their tails add up */
+  size_t tail = 0;
+  for (const std::unique_ptr<EffectBaseTypeless>& effect : m_effectStack) {
+    const size_t effectTail = effect->tailFrames();
+    if (effectTail > std::numeric_limits<size_t>::max() - tail)
+      return std::numeric_limits<size_t>::max();
+    tail += effectTail;
+  }
+  return tail;
+}
+
+template <typename T>
+bool Submix::_effectsIdle(const T* audio, size_t frameCount, const ChannelMap& chanMap) const {
+  /* Any signal resumes processing immediately */
+  if (!std::all_of(audio, audio + frameCount * chanMap.m_channelCount, [](T s) { return s == T(0); })) {
+    m_silentFrames = 0;
+    return false;
+  }
+
+  /* Keep running on silent input until every effect has rung out */
+  if (m_silentFrames >= getEffectTailFrames())
+    return true;
+  m_silentFrames += frameCount;
+  return false;
+}
+
+void Submix::setPlanarEffects(bool planar) {
+  assert(m_effectStack.empty() && "effect stack built for the other processing mode");
+  m_planarEffects = planar;
+  if (planar) {
+    _sizePlanarBuf(m_backendSubmix->getSampleRate());
+  } else {
+    m_planarBuf = {};
+    m_planarFrames = 0;
+  }
+}
+
+void Submix::_sizePlanarBuf(double sampleRate) {
+  /* One 5ms mixing interval; longer calls are processed in pieces so applyEffect never allocates */
+  m_planarFrames = std::max(size_t(1), size_t(std::ceil(sampleRate * 5.0 / 1000.0)));
+  m_planarBuf.assign(m_planarFrames * NumChannels, 0.f);
+}
+
+template <typename T>
+void Submix::_applyEffectPlanar(T* audio, size_t frameCount, const ChannelMap& chanMap) const {
+  const unsigned chanCount = std::min(chanMap.m_channelCount, unsigned(NumChannels));
+  std::array<float*, NumChannels> chans{};
+  for (unsigned c = 0; c < chanCount; ++c)
+    chans[c] = m_planarBuf.data() + c * m_planarFrames;
+
+  while (frameCount) {
+    const size_t frames = std::min(frameCount, m_planarFrames);
+
+    /* De-interleave and convert once on entry */
+    for (size_t f = 0; f < frames; ++f)
+      for (unsigned c = 0; c < chanCount; ++c)
+        chans[c][f] = audio[f * chanMap.m_channelCount + c];
+
+    for (const std::unique_ptr<EffectBaseTypeless>& effect : m_effectStack)
+      static_cast<EffectBase<float>&>(*effect).applyEffectPlanar(chans.data(), frames, chanMap);
+
+    /* Re-interleave and clamp once on exit */
+    for (size_t f = 0; f < frames; ++f)
+      for (unsigned c = 0; c < chanCount; ++c)
+        audio[f * chanMap.m_channelCount + c] = ClampFull<T>(chans[c][f]);
+
+    audio += frames * chanMap.m_channelCount;
+    frameCount -= frames;
+  }
+}
+
 void Submix::applyEffect(int16_t* audio, size_t frameCount, const ChannelMap& chanMap) const {
+  if (_effectsIdle(audio, frameCount, chanMap))
+    return;
+  if (m_planarEffects) {
+    _applyEffectPlanar(audio, frameCount, chanMap);
+    return;
+  }
   for (const std::unique_ptr<EffectBaseTypeless>& effect : m_effectStack)
     ((EffectBase<int16_t>&)*effect).applyEffect(audio, frameCount, chanMap);
 }
 
 void Submix::applyEffect(int32_t* audio, size_t frameCount, const ChannelMap& chanMap) const {
+  if (_effectsIdle(audio, frameCount, chanMap))
+    return;
+  if (m_planarEffects) {
+    _applyEffectPlanar(audio, frameCount, chanMap);
+    return;
+  }
   for (const std::unique_ptr<EffectBaseTypeless>& effect : m_effectStack)
     ((EffectBase<int32_t>&)*effect).applyEffect(audio, frameCount, chanMap);
 }
 
 void Submix::applyEffect(float* audio, size_t frameCount, const ChannelMap& chanMap) const {
+  if (_effectsIdle(audio, frameCount, chanMap))
+    return;
+  if (m_planarEffects) {
+    _applyEffectPlanar(audio, frameCount, chanMap);
+    return;
+  }
   for (const std::unique_ptr<EffectBaseTypeless>& effect : m_effectStack)
     ((EffectBase<float>&)*effect).applyEffect(audio, frameCount, chanMap);
 }
 
 void Submix::resetOutputSampleRate(double sampleRate) {
+  if (m_planarEffects)
+    _sizePlanarBuf(sampleRate);
   for (const std::unique_ptr<EffectBaseTypeless>& effect : m_effectStack)
     effect->resetOutputSampleRate(sampleRate);
 }
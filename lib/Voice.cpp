@@ -1,5 +1,6 @@
 #include "amuse/Voice.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -15,6 +16,17 @@
 
 namespace amuse {
 
+void* Voice::operator new(size_t size, Engine& engine) { return engine.m_voicePool->allocate(); }
+
+void Voice::operator delete(void* ptr, Engine& engine) noexcept { VoicePool::Deallocate(ptr); }
+
+void Voice::operator delete(void* ptr) noexcept { VoicePool::Deallocate(ptr); }
+
+/* Duration of the fade-out applied to stolen voices */
+constexpr double StealFadeTime = 0.01;
+
+static uint8_t OffsetPriority(uint8_t prio, int offset) { return uint8_t(std::clamp(prio + offset, 0, 255)); }
+
 float Voice::VolumeCache::getVolume(float vol, bool dls) {
   if (vol != m_curVolLUTKey || dls != m_curDLS) {
     m_curVolLUTKey = vol;
@@ -36,6 +48,8 @@ void Voice::_destroy() {
   m_studio.reset();
   m_backendVoice.reset();
   m_curSample.reset();
+  m_engine.m_sampleCache.release(m_curDecoded);
+  m_curStream.reset();
   m_sequencer.reset();
 }
 
@@ -75,7 +89,9 @@ bool Voice::_checkSamplePos(bool& looped) {
     if (m_curSample->isLooped()) {
       /* Turn over looped sample */
       m_curSamplePos = m_curSample->m_loopStartSample;
-      if (m_curFormat == SampleFormat::DSP) {
+      if (m_curDecoded) {
+        m_curSampleData = reinterpret_cast<const unsigned char*>(m_curDecoded->getLoopData());
+      } else if (m_curFormat == SampleFormat::DSP) {
         m_prev1 = m_curSample->m_ADPCMParms.dsp.m_hist1;
         m_prev2 = m_curSample->m_ADPCMParms.dsp.m_hist2;
       }
@@ -84,6 +100,8 @@ bool Voice::_checkSamplePos(bool& looped) {
       /* Notify sample end */
       _macroSampleEnd();
       m_curSample = nullptr;
+      m_engine.m_sampleCache.release(m_curDecoded);
+      m_curStream.reset();
       return true;
     }
   }
@@ -92,12 +110,21 @@ bool Voice::_checkSamplePos(bool& looped) {
   if (m_volAdsr.isComplete(*this)) {
     _macroSampleEnd();
     m_curSample = nullptr;
+    m_engine.m_sampleCache.release(m_curDecoded);
+    m_curStream.reset();
     return true;
   }
 
   return false;
 }
 
+const unsigned char* Voice::_sampleBytes(size_t offset, size_t& avail) {
+  if (m_curStream)
+    return m_curStream->acquire(offset, avail);
+  avail = UINT32_MAX;
+  return m_curSampleData + offset;
+}
+
 void Voice::_doKeyOff() {
   m_voxState = VoiceState::KeyOff;
   if (m_state.m_inWait && m_state.m_keyoffWait) {
@@ -117,6 +144,7 @@ void Voice::_setTotalPitch(int32_t cents, bool slew) {
   const int32_t interval = std::clamp(cents, 0, 12700) - m_curSample->getPitch() * 100;
   const double ratio = std::exp2(interval / 1200.0) * m_dopplerRatio;
   m_sampleRate = m_curSample->m_sampleRate * ratio;
+  m_pitchRatio = ratio;
   m_backendVoice->setPitchRatio(ratio, slew);
 }
 
@@ -154,25 +182,28 @@ ObjToken<Voice> Voice::_findVoice(int vid, ObjToken<Voice> thisPtr) {
   return {};
 }
 
-std::unique_ptr<int8_t[]>& Voice::_ensureCtrlVals() {
-  if (m_ctrlValsSelf) {
-    return m_ctrlValsSelf;
-  }
+void Voice::_steal() {
+  if (m_destroyed || m_stolen)
+    return;
 
-  m_ctrlValsSelf = std::make_unique<int8_t[]>(128);
-  return m_ctrlValsSelf;
+  m_stolen = true;
+  for (ObjToken<Voice>& vox : m_childVoices)
+    vox->_steal();
 }
 
-std::list<ObjToken<Voice>>::iterator Voice::_allocateVoice(double sampleRate, bool dynamicPitch) {
-  amuse::ObjToken<Voice> tok =
-      MakeObj<Voice>(m_engine, m_audioGroup, m_groupId, m_engine.m_nextVid++, m_emitter, m_studio);
-  auto it = m_childVoices.emplace(m_childVoices.end(), tok);
-  m_childVoices.back()->m_backendVoice =
-      m_engine.getBackend().allocateVoice(*m_childVoices.back(), sampleRate, dynamicPitch);
-  return it;
+ObjToken<Voice> Voice::_allocateVoice(double sampleRate, bool dynamicPitch, const VoiceBudget& budget) {
+  ObjToken<Voice> vox =
+      new (m_engine) Voice(m_engine, m_audioGroup, m_groupId, m_engine.m_nextVid++, m_emitter, m_studio);
+  vox->m_priority = budget.priority;
+  vox->m_budgetSource = budget.source;
+  vox->m_startTick = m_engine.m_pumpTick;
+  vox->m_startDelay = m_startDelay;
+  vox->m_backendVoice = m_engine.getBackend().allocateVoice(*vox, sampleRate, dynamicPitch);
+  m_childVoices.push_back(vox);
+  return vox;
 }
 
-std::list<ObjToken<Voice>>::iterator Voice::_destroyVoice(std::list<ObjToken<Voice>>::iterator it) {
+std::vector<ObjToken<Voice>>::iterator Voice::_destroyVoice(std::vector<ObjToken<Voice>>::iterator it) {
   if ((*it)->m_destroyed)
     return m_childVoices.begin();
 
@@ -180,40 +211,19 @@ std::list<ObjToken<Voice>>::iterator Voice::_destroyVoice(std::list<ObjToken<Voi
   return m_childVoices.erase(it);
 }
 
+void Voice::_destroyVoice(Voice* vox) {
+  auto search = std::find_if(m_childVoices.rbegin(), m_childVoices.rend(),
+                             [vox](const ObjToken<Voice>& other) { return other.get() == vox; });
+  if (search != m_childVoices.rend())
+    _destroyVoice(std::next(search).base());
+}
+
 template <typename T>
 static T ApplyVolume(float vol, T samp) {
   return samp * vol;
 }
 
-void Voice::_procSamplePre(int16_t& samp) {
-  double dt = 0.0;
-
-  /* Block linearized will use a larger `dt` for amplitude sampling;
-   * significantly reducing the processing expense */
-  switch (m_engine.m_ampMode) {
-  case AmplitudeMode::PerSample:
-    m_voiceSamples += 1;
-    dt = 1.0 / m_sampleRate;
-    break;
-  case AmplitudeMode::BlockLinearized: {
-    uint32_t rem = m_voiceSamples % 160;
-    m_voiceSamples += 1;
-    dt = m_sampleRate * 160;
-    if (rem != 0) {
-      /* Lerp within 160-sample block */
-      const float t = rem / 160.f;
-      const float l = std::clamp(m_lastLevel * (1.f - t) + m_nextLevel * t, 0.f, 1.f);
-
-      /* Apply total volume to sample using decibel scale */
-      samp = ApplyVolume(m_lerpedCache.getVolume(l * m_engine.m_masterVolume, m_dlsVol), samp);
-      return;
-    }
-
-    dt = 160.0 / m_sampleRate;
-    break;
-  }
-  }
-
+float Voice::_advanceLevel(double dt, float adsr) {
   m_voiceTime += dt;
 
   /* Process active envelope */
@@ -258,10 +268,15 @@ void Voice::_procSamplePre(int16_t& samp) {
     m_curUserVol = m_targetUserVol;
 
   /* Factor in ADSR envelope state */
-  float adsr = m_volAdsr.advance(dt, *this);
   m_lastLevel = m_nextLevel;
   m_nextLevel = m_curUserVol * m_curVol * m_envelopeVol * adsr * (m_state.m_curVel / 127.f);
 
+  /* Rapidly fade out stolen voice */
+  if (m_stolen) {
+    m_stealFadeVol = std::max(0.f, m_stealFadeVol - float(dt / StealFadeTime));
+    m_nextLevel *= m_stealFadeVol;
+  }
+
   /* Apply tremolo */
   if (m_state.m_tremoloSel && (m_tremoloScale || m_tremoloModScale)) {
     float t = m_state.m_tremoloSel.evaluate(m_voiceTime, *this, m_state) / 127.f;
@@ -283,31 +298,98 @@ void Voice::_procSamplePre(int16_t& samp) {
   }
 
   m_nextLevel = std::clamp(m_nextLevel, 0.f, 1.f);
+  return m_nextLevel;
+}
+
+void Voice::_procSamplesPre(int16_t* data, size_t count) {
+  /* Gains are built into a block buffer stage by stage, then applied in one pass */
+  constexpr size_t ChunkSamples = 256;
+  float gains[ChunkSamples];
+
+  for (size_t start = 0; start < count; start += ChunkSamples) {
+    const size_t n = std::min(ChunkSamples, count - start);
+
+    switch (m_engine.m_ampMode) {
+    case AmplitudeMode::PerSample: {
+      const double dt = 1.0 / m_sampleRate;
+      m_voiceSamples += n;
+      m_volAdsr.advanceBlock(dt, n, gains, *this);
+      for (size_t i = 0; i < n; ++i)
+        gains[i] = _advanceLevel(dt, gains[i]);
+      for (size_t i = 0; i < n; ++i)
+        gains[i] = m_nextLevelCache.getVolume(gains[i] * m_engine.m_masterVolume, m_dlsVol);
+      break;
+    }
+    case AmplitudeMode::BlockLinearized:
+      /* Block linearized uses a larger `dt` for amplitude sampling;
+       * significantly reducing the processing expense */
+      for (size_t i = 0; i < n; ++i) {
+        const uint32_t rem = m_voiceSamples % 160;
+        m_voiceSamples += 1;
+        if (rem != 0) {
+          /* Lerp within 160-sample block */
+          const float t = rem / 160.f;
+          const float l = std::clamp(m_lastLevel * (1.f - t) + m_nextLevel * t, 0.f, 1.f);
+          gains[i] = m_lerpedCache.getVolume(l * m_engine.m_masterVolume, m_dlsVol);
+        } else {
+          const double dt = 160.0 / m_sampleRate;
+          const float level = _advanceLevel(dt, m_volAdsr.advance(dt, *this));
+          gains[i] = m_nextLevelCache.getVolume(level * m_engine.m_masterVolume, m_dlsVol);
+        }
+      }
+      break;
+    }
 
-  /* Apply total volume to sample using decibel scale */
-  samp = ApplyVolume(m_nextLevelCache.getVolume(m_nextLevel * m_engine.m_masterVolume, m_dlsVol), samp);
+    /* Apply total volume to samples using decibel scale */
+    ApplyGains(data + start, gains, n);
+  }
 }
 
-template <typename T>
-T Voice::_procSampleMaster(double time, T samp) {
+float Voice::_evaluateBusGain(int bus, double time) {
   const float evalVol = m_state.m_volumeSel ? (m_state.m_volumeSel.evaluate(time, *this, m_state) / 127.f) : 1.f;
-  return ApplyVolume(m_masterCache.getVolume(std::clamp(evalVol, 0.f, 1.f), m_dlsVol), samp);
+  switch (bus) {
+  case 0:
+  default:
+    return m_masterCache.getVolume(std::clamp(evalVol, 0.f, 1.f), m_dlsVol);
+  case 1: {
+    float auxVol =
+        evalVol * (m_state.m_reverbSel ? (m_state.m_reverbSel.evaluate(time, *this, m_state) / 127.f) : m_curReverbVol);
+    auxVol += m_state.m_preAuxASel ? (m_state.m_preAuxASel.evaluate(time, *this, m_state) / 127.f) : 0.f;
+    return m_auxACache.getVolume(std::clamp(auxVol, 0.f, 1.f), m_dlsVol);
+  }
+  case 2: {
+    float auxVol =
+        evalVol * (m_state.m_postAuxB ? (m_state.m_postAuxB.evaluate(time, *this, m_state) / 127.f) : m_curAuxBVol);
+    auxVol += m_state.m_preAuxBSel ? (m_state.m_preAuxBSel.evaluate(time, *this, m_state) / 127.f) : 0.f;
+    return m_auxBCache.getVolume(std::clamp(auxVol, 0.f, 1.f), m_dlsVol);
+  }
+  }
 }
 
 template <typename T>
-T Voice::_procSampleAuxA(double time, T samp) {
-  float evalVol = m_state.m_volumeSel ? (m_state.m_volumeSel.evaluate(time, *this, m_state) / 127.f) : 1.f;
-  evalVol *= m_state.m_reverbSel ? (m_state.m_reverbSel.evaluate(time, *this, m_state) / 127.f) : m_curReverbVol;
-  evalVol += m_state.m_preAuxASel ? (m_state.m_preAuxASel.evaluate(time, *this, m_state) / 127.f) : 0.f;
-  return ApplyVolume(m_auxACache.getVolume(std::clamp(evalVol, 0.f, 1.f), m_dlsVol), samp);
-}
+void Voice::_routeAudio(size_t frames, double dt, int busId, const T* in, T* out) {
+  if (!frames)
+    return;
 
-template <typename T>
-T Voice::_procSampleAuxB(double time, T samp) {
-  float evalVol = m_state.m_volumeSel ? (m_state.m_volumeSel.evaluate(time, *this, m_state) / 127.f) : 1.f;
-  evalVol *= m_state.m_postAuxB ? (m_state.m_postAuxB.evaluate(time, *this, m_state) / 127.f) : m_curAuxBVol;
-  evalVol += m_state.m_preAuxBSel ? (m_state.m_preAuxBSel.evaluate(time, *this, m_state) / 127.f) : 0.f;
-  return ApplyVolume(m_auxBCache.getVolume(std::clamp(evalVol, 0.f, 1.f), m_dlsVol), samp);
+  /* Controllers are evaluated at control rate and linearly ramped in between */
+  const int bus = (busId == 1 || busId == 2) ? busId : 0;
+  const size_t period = m_engine.m_controlPeriod ? m_engine.m_controlPeriod : frames;
+  dt /= double(frames);
+
+  float gain = m_busGainsValid[bus] ? m_busGains[bus] : _evaluateBusGain(bus, m_voiceTime);
+  for (size_t start = 0; start < frames; start += period) {
+    const size_t count = std::min(period, frames - start);
+    const float target = _evaluateBusGain(bus, m_voiceTime + dt * double(start + count));
+    const float step = (target - gain) / float(count);
+    const T* segIn = in + start;
+    T* segOut = out + start;
+    for (size_t i = 0; i < count; ++i)
+      segOut[i] = ApplyVolume(gain + step * float(i), segIn[i]);
+    gain = target;
+  }
+
+  m_busGains[bus] = gain;
+  m_busGainsValid[bus] = true;
 }
 
 uint32_t Voice::_GetBlockSampleCount(SampleFormat fmt) {
@@ -332,10 +414,19 @@ static float TriangleWave(float t) {
 }
 
 void Voice::preSupplyAudio(double dt) {
+  /* A keyoff still pending from an earlier interval was never reached by supplyAudio
+   * (voice stalled or not rendering); release it now rather than hanging the note */
+  if (m_keyOffDelay >= 0.0 && m_keyOffTick != m_engine.m_pumpTick) {
+    m_keyOffDelay = -1.0;
+    _keyOffNow();
+  }
+
   /* Process SoundMacro; bootstrapping sample if needed */
   bool dead = m_state.advance(*this, dt);
 
   /* Process per-block evaluators here */
+  m_volAdsr.update(*this);
+
   if (m_state.m_pedalSel) {
     bool pedal = m_state.m_pedalSel.evaluate(m_voiceTime, *this, m_state) >= 64.f;
     if (pedal != m_sustained)
@@ -464,14 +555,51 @@ void Voice::preSupplyAudio(double dt) {
     m_voxState = VoiceState::Dead;
     m_backendVoice->stop();
   }
+
+  /* Stolen voice is released once its fade-out completes */
+  if (m_stolen && (!m_curSample || m_stealFadeVol <= 0.f)) {
+    m_voxState = VoiceState::Dead;
+    m_backendVoice->stop();
+  }
 }
 
 size_t Voice::supplyAudio(size_t samples, int16_t* data) {
+  /* Delays are output-time seconds; the backend pulls source samples at the reset rate scaled by
+   * the current pitch ratio, so one output second spans srcRate samples of this buffer */
+  const double srcRate = m_backendRate * m_pitchRatio;
+  size_t pos = 0;
+  if (m_startDelay > 0.0) {
+    pos = std::min(samples, size_t(m_startDelay * srcRate));
+    m_startDelay = pos == samples ? m_startDelay - samples / srcRate : 0.0;
+    memset(data, 0, sizeof(int16_t) * pos);
+  }
+
+  if (m_keyOffDelay >= 0.0) {
+    const size_t keyOffPos = size_t(m_keyOffDelay * srcRate);
+    if (keyOffPos < samples) {
+      m_keyOffDelay = -1.0;
+      if (keyOffPos > pos) {
+        _renderSamples(keyOffPos - pos, data + pos);
+        pos = keyOffPos;
+      }
+      _keyOffNow();
+    } else {
+      m_keyOffDelay -= samples / srcRate;
+    }
+  }
+
+  if (pos < samples)
+    _renderSamples(samples - pos, data + pos);
+  return samples;
+}
+
+void Voice::_renderSamples(size_t samples, int16_t* data) {
   uint32_t samplesRem = samples;
 
   if (m_curSample) {
     uint32_t blockSampleCount = _GetBlockSampleCount(m_curFormat);
     uint32_t block;
+    size_t avail;
 
     bool looped = true;
     while (looped && samplesRem) {
@@ -485,40 +613,38 @@ size_t Voice::supplyAudio(size_t samples, int16_t* data) {
         switch (m_curFormat) {
         case SampleFormat::DSP: {
           decSamples =
-              DSPDecompressFrameRanged(data, m_curSampleData + 8 * block, m_curSample->m_ADPCMParms.dsp.m_coefs,
+              DSPDecompressFrameRanged(data, _sampleBytes(8 * block, avail), m_curSample->m_ADPCMParms.dsp.m_coefs,
                                        &m_prev1, &m_prev2, rem, remCount);
           break;
         }
         case SampleFormat::N64: {
-          decSamples = N64MusyXDecompressFrameRanged(data, m_curSampleData + 256 + 40 * block,
+          decSamples = N64MusyXDecompressFrameRanged(data, _sampleBytes(256 + 40 * block, avail),
                                                      m_curSample->m_ADPCMParms.vadpcm.m_coefs, rem, remCount);
           break;
         }
         case SampleFormat::PCM: {
-          const int16_t* pcm = reinterpret_cast<const int16_t*>(m_curSampleData);
-          remCount = std::min(samplesRem, m_lastSamplePos - m_curSamplePos);
+          const int16_t* pcm = reinterpret_cast<const int16_t*>(_sampleBytes(m_curSamplePos * 2, avail));
+          remCount = std::min({samplesRem, m_lastSamplePos - m_curSamplePos, uint32_t(avail / 2)});
           for (uint32_t i = 0; i < remCount; ++i)
-            data[i] = SBig(pcm[m_curSamplePos + i]);
+            data[i] = SBig(pcm[i]);
           decSamples = remCount;
           break;
         }
         case SampleFormat::PCM_PC: {
-          const int16_t* pcm = reinterpret_cast<const int16_t*>(m_curSampleData);
-          remCount = std::min(samplesRem, m_lastSamplePos - m_curSamplePos);
-          memmove(data, pcm + m_curSamplePos, remCount * sizeof(int16_t));
+          const int16_t* pcm = reinterpret_cast<const int16_t*>(_sampleBytes(m_curSamplePos * 2, avail));
+          remCount = std::min({samplesRem, m_lastSamplePos - m_curSamplePos, uint32_t(avail / 2)});
+          memmove(data, pcm, remCount * sizeof(int16_t));
           decSamples = remCount;
           break;
         }
         default:
           memset(data, 0, sizeof(int16_t) * samples);
-          return samples;
+          return;
         }
 
-        /* Per-sample processing */
-        for (uint32_t i = 0; i < decSamples; ++i) {
-          ++m_curSamplePos;
-          _procSamplePre(data[i]);
-        }
+        /* Block gain stage */
+        m_curSamplePos += decSamples;
+        _procSamplesPre(data, decSamples);
 
         samplesRem -= decSamples;
         data += decSamples;
@@ -527,7 +653,7 @@ size_t Voice::supplyAudio(size_t samples, int16_t* data) {
       if (_checkSamplePos(looped)) {
         if (samplesRem)
           memset(data, 0, sizeof(int16_t) * samplesRem);
-        return samples;
+        return;
       }
       if (looped)
         continue;
@@ -539,40 +665,38 @@ size_t Voice::supplyAudio(size_t samples, int16_t* data) {
 
         switch (m_curFormat) {
         case SampleFormat::DSP: {
-          decSamples = DSPDecompressFrame(data, m_curSampleData + 8 * block, m_curSample->m_ADPCMParms.dsp.m_coefs,
+          decSamples = DSPDecompressFrame(data, _sampleBytes(8 * block, avail), m_curSample->m_ADPCMParms.dsp.m_coefs,
                                           &m_prev1, &m_prev2, remCount);
           break;
         }
         case SampleFormat::N64: {
-          decSamples = N64MusyXDecompressFrame(data, m_curSampleData + 256 + 40 * block,
+          decSamples = N64MusyXDecompressFrame(data, _sampleBytes(256 + 40 * block, avail),
                                                m_curSample->m_ADPCMParms.vadpcm.m_coefs, remCount);
           break;
         }
         case SampleFormat::PCM: {
-          const int16_t* pcm = reinterpret_cast<const int16_t*>(m_curSampleData);
-          remCount = std::min(samplesRem, m_lastSamplePos - m_curSamplePos);
+          const int16_t* pcm = reinterpret_cast<const int16_t*>(_sampleBytes(m_curSamplePos * 2, avail));
+          remCount = std::min({samplesRem, m_lastSamplePos - m_curSamplePos, uint32_t(avail / 2)});
           for (uint32_t i = 0; i < remCount; ++i)
-            data[i] = SBig(pcm[m_curSamplePos + i]);
+            data[i] = SBig(pcm[i]);
           decSamples = remCount;
           break;
         }
         case SampleFormat::PCM_PC: {
-          const int16_t* pcm = reinterpret_cast<const int16_t*>(m_curSampleData);
-          remCount = std::min(samplesRem, m_lastSamplePos - m_curSamplePos);
-          memmove(data, pcm + m_curSamplePos, remCount * sizeof(int16_t));
+          const int16_t* pcm = reinterpret_cast<const int16_t*>(_sampleBytes(m_curSamplePos * 2, avail));
+          remCount = std::min({samplesRem, m_lastSamplePos - m_curSamplePos, uint32_t(avail / 2)});
+          memmove(data, pcm, remCount * sizeof(int16_t));
           decSamples = remCount;
           break;
         }
         default:
           memset(data, 0, sizeof(int16_t) * samples);
-          return samples;
+          return;
         }
 
-        /* Per-sample processing */
-        for (uint32_t i = 0; i < decSamples; ++i) {
-          ++m_curSamplePos;
-          _procSamplePre(data[i]);
-        }
+        /* Block gain stage */
+        m_curSamplePos += decSamples;
+        _procSamplesPre(data, decSamples);
 
         samplesRem -= decSamples;
         data += decSamples;
@@ -580,7 +704,7 @@ size_t Voice::supplyAudio(size_t samples, int16_t* data) {
         if (_checkSamplePos(looped)) {
           if (samplesRem)
             memset(data, 0, sizeof(int16_t) * samplesRem);
-          return samples;
+          return;
         }
         if (looped)
           break;
@@ -593,77 +717,18 @@ size_t Voice::supplyAudio(size_t samples, int16_t* data) {
 
   if (m_voxState == VoiceState::Dead)
     m_curSample.reset();
-
-  return samples;
 }
 
 void Voice::routeAudio(size_t frames, double dt, int busId, int16_t* in, int16_t* out) {
-  dt /= double(frames);
-
-  switch (busId) {
-  case 0:
-  default: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleMaster(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  case 1: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleAuxA(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  case 2: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleAuxB(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  }
+  _routeAudio(frames, dt, busId, in, out);
 }
 
 void Voice::routeAudio(size_t frames, double dt, int busId, int32_t* in, int32_t* out) {
-  dt /= double(frames);
-
-  switch (busId) {
-  case 0:
-  default: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleMaster(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  case 1: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleAuxA(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  case 2: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleAuxB(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  }
+  _routeAudio(frames, dt, busId, in, out);
 }
 
 void Voice::routeAudio(size_t frames, double dt, int busId, float* in, float* out) {
-  dt /= double(frames);
-
-  switch (busId) {
-  case 0:
-  default: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleMaster(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  case 1: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleAuxA(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  case 2: {
-    for (uint32_t i = 0; i < frames; ++i)
-      out[i] = _procSampleAuxB(dt * i + m_voiceTime, in[i]);
-    break;
-  }
-  }
+  _routeAudio(frames, dt, busId, in, out);
 }
 
 int Voice::maxVid() const {
@@ -674,23 +739,25 @@ int Voice::maxVid() const {
 }
 
 ObjToken<Voice> Voice::_startChildMacro(ObjectId macroId, int macroStep, double ticksPerSec, uint8_t midiKey,
-                                        uint8_t midiVel, uint8_t midiMod, bool pushPc) {
-  std::list<ObjToken<Voice>>::iterator vox = _allocateVoice(NativeSampleRate, true);
-  if (!(*vox)->loadMacroObject(macroId, macroStep, ticksPerSec, midiKey, midiVel, midiMod, pushPc)) {
-    _destroyVoice(vox);
+                                        uint8_t midiVel, uint8_t midiMod, bool pushPc, const VoiceBudget& budget) {
+  if (!m_engine._reserveVoice(budget))
+    return {};
+  ObjToken<Voice> vox = _allocateVoice(NativeSampleRate, true, budget);
+  if (!vox->loadMacroObject(macroId, macroStep, ticksPerSec, midiKey, midiVel, midiMod, pushPc)) {
+    _destroyVoice(vox.get());
     return {};
   }
-  (*vox)->setVolume(m_targetUserVol);
-  (*vox)->setPan(m_curPan);
-  (*vox)->setSurroundPan(m_curSpan);
+  vox->setVolume(m_targetUserVol);
+  vox->setPan(m_curPan);
+  vox->setSurroundPan(m_curSpan);
   if (m_extCtrlVals)
-    (*vox)->installCtrlValues(m_extCtrlVals);
-  return *vox;
+    vox->installCtrlValues(m_extCtrlVals);
+  return vox;
 }
 
 ObjToken<Voice> Voice::startChildMacro(int8_t addNote, ObjectId macroId, int macroStep) {
   return _startChildMacro(macroId, macroStep, 1000.0, m_state.m_initKey + addNote, m_state.m_initVel,
-                          m_state.m_initMod);
+                          m_state.m_initMod, false, {m_priority});
 }
 
 bool Voice::_loadSoundMacro(SoundMacroId id, const SoundMacro* macroData, int macroStep, double ticksPerSec,
@@ -714,6 +781,7 @@ bool Voice::_loadKeymap(const Keymap* keymap, double ticksPerSec, uint8_t midiKe
                         bool pushPc) {
   const Keymap& km = keymap[midiKey];
   midiKey += km.transpose;
+  m_priority = OffsetPriority(m_priority, km.prioOffset);
   bool ret = loadMacroObject(km.macro.id, 0, ticksPerSec, midiKey, midiVel, midiMod, pushPc);
   m_curVol = 1.f;
   if (km.pan == -128) {
@@ -728,16 +796,20 @@ bool Voice::_loadKeymap(const Keymap* keymap, double ticksPerSec, uint8_t midiKe
 bool Voice::_loadLayer(const std::vector<LayerMapping>& layer, double ticksPerSec, uint8_t midiKey, uint8_t midiVel,
                        uint8_t midiMod, bool pushPc) {
   bool ret = false;
+  const uint8_t basePriority = m_priority;
   for (const LayerMapping& mapping : layer) {
     if (midiKey >= mapping.keyLo && midiKey <= mapping.keyHi) {
       uint8_t mappingKey = midiKey + mapping.transpose;
+      const uint8_t priority = OffsetPriority(basePriority, mapping.prioOffset);
       if (m_voxState != VoiceState::Playing) {
+        m_priority = priority;
         ret |= loadMacroObject(mapping.macro.id, 0, ticksPerSec, mappingKey, midiVel, midiMod, pushPc);
         m_curUserVol = m_targetUserVol = mapping.volume / 127.f;
         _setPan((mapping.pan - 64) / 64.f);
         _setSurroundPan((mapping.span - 64) / 64.f);
       } else {
-        ObjToken<Voice> vox = _startChildMacro(mapping.macro.id, 0, ticksPerSec, mappingKey, midiVel, midiMod, pushPc);
+        ObjToken<Voice> vox = _startChildMacro(mapping.macro.id, 0, ticksPerSec, mappingKey, midiVel, midiMod, pushPc,
+                                               {priority, 255, m_budgetSource});
         if (vox) {
           vox->m_curUserVol = vox->m_targetUserVol = mapping.volume / 127.f;
           vox->_setPan((mapping.pan - 64) / 64.f);
@@ -807,6 +879,21 @@ void Voice::keyOff() {
   if (m_destroyed)
     return;
 
+  /* Keyoffs dispatched partway into the interval release at their frame in supplyAudio; a voice
+   * not playing a sample has no frame to align to (and may never be pulled), so it releases now */
+  if (const double offset = m_engine.getEventOffset(); offset > 0.0 && m_curSample) {
+    m_keyOffDelay = offset;
+    m_keyOffTick = m_engine.m_pumpTick;
+  } else {
+    m_keyOffDelay = -1.0;
+    _keyOffNow();
+  }
+
+  for (const ObjToken<Voice>& vox : m_childVoices)
+    vox->keyOff();
+}
+
+void Voice::_keyOffNow() {
   if (m_keyoffTrap.macroId != 0xffff) {
     if (m_keyoffTrap.macroId == std::get<0>(m_state.m_pc.back())) {
       std::get<2>(m_state.m_pc.back()) = std::get<1>(m_state.m_pc.back())->assertPC(m_keyoffTrap.macroStep);
@@ -816,9 +903,6 @@ void Voice::keyOff() {
                       m_state.m_initVel, m_state.m_initMod);
   } else
     _macroKeyOff();
-
-  for (const ObjToken<Voice>& vox : m_childVoices)
-    vox->keyOff();
 }
 
 void Voice::message(int32_t val) {
@@ -841,14 +925,25 @@ void Voice::startSample(SampleId sampId, int32_t offset) {
     return;
 
   if (const SampleEntry* sample = m_audioGroup.getSample(sampId)) {
-    std::tie(m_curSample, m_curSampleData) = m_audioGroup.getSampleData(sampId, sample);
+    /* Streamed groups page sample data in behind the play position */
+    if ((m_curStream = m_audioGroup.openSampleStream(sampId, sample))) {
+      m_curSample = sample->m_data;
+      m_curSampleData = nullptr;
+    } else if (m_audioGroup.isStreamed() && !sample->m_data->m_looseData) {
+      /* Every stream is playing; paging the whole sample in here would read the provider */
+      stopSample();
+      return;
+    } else {
+      std::tie(m_curSample, m_curSampleData) = m_audioGroup.getSampleData(sampId, sample);
+    }
 
     m_state.m_sampleEnd = false;
     m_sampleRate = m_curSample->m_sampleRate;
     m_curPitch = m_curSample->getPitch();
     m_pitchDirty = true;
     _setPitchWheel(m_curPitchWheel);
-    m_backendVoice->resetSampleRate(m_curSample->m_sampleRate);
+    m_backendRate = m_curSample->m_sampleRate;
+    m_backendVoice->resetSampleRate(m_backendRate);
     m_needsSlew = false;
 
     const int32_t numSamples = m_curSample->getNumSamples();
@@ -875,24 +970,40 @@ void Voice::startSample(SampleId sampId, int32_t offset) {
       --m_lastSamplePos;
 
     bool looped;
+    m_engine.m_sampleCache.release(m_curDecoded);
     _checkSamplePos(looped);
 
+    /* Stream decoded PCM when the engine has it cached */
+    if (m_curSample && (m_curFormat == SampleFormat::DSP || m_curFormat == SampleFormat::N64)) {
+      if ((m_curDecoded = m_engine.m_sampleCache.lookup(m_audioGroup, sampId, m_curSample, m_curSampleData))) {
+        m_curFormat = SampleFormat::PCM_PC;
+        m_curSampleData = reinterpret_cast<const unsigned char*>(m_curDecoded->getData());
+      }
+    }
+
     /* Seek DSPADPCM state if needed */
     if (m_curSample && m_curSamplePos && m_curFormat == SampleFormat::DSP) {
       uint32_t block = m_curSamplePos / 14;
       uint32_t rem = m_curSamplePos % 14;
-      for (uint32_t b = 0; b < block; ++b)
-        DSPDecompressFrameStateOnly(m_curSampleData + 8 * b, m_curSample->m_ADPCMParms.dsp.m_coefs, &m_prev1, &m_prev2,
-                                    14);
+      /* Only resident bytes; a stream's placeholder frames would leave the history decoded from silence */
+      auto blockBytes = [&](uint32_t b) -> const unsigned char* {
+        return m_curStream ? m_curStream->resident(8 * b) : m_curSampleData + 8 * b;
+      };
+      m_curSample->seekDSP(block, m_prev1, m_prev2, blockBytes);
 
-      if (rem)
-        DSPDecompressFrameStateOnly(m_curSampleData + 8 * block, m_curSample->m_ADPCMParms.dsp.m_coefs, &m_prev1,
-                                    &m_prev2, rem);
+      if (rem) {
+        if (const unsigned char* bytes = blockBytes(block))
+          DSPDecompressFrameStateOnly(bytes, m_curSample->m_ADPCMParms.dsp.m_coefs, &m_prev1, &m_prev2, rem);
+      }
     }
   }
 }
 
-void Voice::stopSample() { m_curSample.reset(); }
+void Voice::stopSample() {
+  m_curSample.reset();
+  m_engine.m_sampleCache.release(m_curDecoded);
+  m_curStream.reset();
+}
 
 void Voice::setVolume(float vol) {
   if (m_destroyed)
@@ -1188,6 +1299,8 @@ void Voice::setPitchFrequency(uint32_t hz, uint16_t fine) {
     return;
 
   m_sampleRate = hz + fine / 65536.0;
+  m_backendRate = m_sampleRate;
+  m_pitchRatio = 1.0;
   m_backendVoice->setPitchRatio(1.0, false);
   m_backendVoice->resetSampleRate(m_sampleRate);
 }
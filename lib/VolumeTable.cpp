@@ -4,6 +4,10 @@
 #include <array>
 #include <cmath>
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace amuse {
 
 constexpr std::array<float, 129> VolumeTable{
@@ -64,4 +68,20 @@ float LookupDLSVolume(float vol) {
   return (1.f - t) * DLSVolumeTable[int(f)] + t * DLSVolumeTable[int(c)];
 }
 
+void ApplyGains(int16_t* data, const float* gains, size_t count) {
+  size_t i = 0;
+#if __SSE2__
+  for (; i + 8 <= count; i += 8) {
+    const __m128i samps = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samps, samps), 16));
+    const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samps, samps), 16));
+    const __m128i loOut = _mm_cvttps_epi32(_mm_mul_ps(lo, _mm_loadu_ps(gains + i)));
+    const __m128i hiOut = _mm_cvttps_epi32(_mm_mul_ps(hi, _mm_loadu_ps(gains + i + 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_packs_epi32(loOut, hiOut));
+  }
+#endif
+  for (; i < count; ++i)
+    data[i] = int16_t(std::clamp(float(data[i]) * gains[i], -32768.f, 32767.f));
+}
+
 } // namespace amuse
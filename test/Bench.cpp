@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "amuse/EffectReverb.hpp"
+#include "amuse/VolumeTable.hpp"
+
+#include "CodecReference.hpp"
+#include "ReverbReference.hpp"
+#include "TestUtil.hpp"
+
+using namespace amuse;
+using namespace amuse::test;
+
+/* Throughput of the hot DSP paths, each against its scalar reference where one exists.
+ * `amuse-bench [scale]` multiplies the amount of work per measurement (default 1). */
+
+static double Scale = 1.0;
+
+static size_t Scaled(size_t count) { return std::max(size_t(1), size_t(count * Scale)); }
+
+static void Report(const char* name, double ns, double items, const char* unit) {
+  std::printf("%-40s %10.3f ms %10.2f M%s/s\n", name, ns / 1e6, items / ns * 1e3, unit);
+}
+
+static void BenchDSPDecode() {
+  const size_t frameCount = Scaled(200000);
+  Rng rng(6);
+  int16_t coefs[8][2];
+  for (auto& pair : coefs) {
+    pair[0] = int16_t(rng.range(-4096, 4095));
+    pair[1] = int16_t(rng.range(-4096, 4095));
+  }
+  std::vector<uint8_t> data(frameCount * 8);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = uint8_t(i % 8 == 0 ? (rng.below(8) << 4) | rng.below(12) : rng.below(256));
+  std::vector<int16_t> out(frameCount * 14);
+  const double samples = double(frameCount) * 14;
+
+  Report("DSP decode (scalar reference)", TimeNs([&]() {
+           int16_t p1 = 0, p2 = 0;
+           for (size_t f = 0; f < frameCount; ++f)
+             RefDSPDecodeFrame(out.data() + f * 14, 1, data.data() + f * 8, coefs, &p1, &p2, 0, 14);
+           Consume(p1 + p2);
+         }),
+         samples, "samples");
+  Report("DSP decode", TimeNs([&]() {
+           int16_t p1 = 0, p2 = 0;
+           for (size_t f = 0; f < frameCount; ++f)
+             DSPDecompressFrame(out.data() + f * 14, data.data() + f * 8, coefs, &p1, &p2, 14);
+           Consume(p1 + p2);
+         }),
+         samples, "samples");
+}
+
+static void BenchN64Decode() {
+  const size_t frameCount = Scaled(50000);
+  Rng rng(64);
+  int16_t coefs[8][2][8];
+  for (auto& book : coefs)
+    for (auto& row : book)
+      for (int16_t& c : row)
+        c = int16_t(rng.range(-2048, 2047));
+  std::vector<uint8_t> data(frameCount * 40);
+  for (uint8_t& b : data)
+    b = uint8_t(rng.below(256));
+  std::vector<int16_t> out(frameCount * 64);
+  const double samples = double(frameCount) * 64;
+
+  Report("N64 decode (scalar reference)", TimeNs([&]() {
+           for (size_t f = 0; f < frameCount; ++f)
+             RefN64DecodeFrame(out.data() + f * 64, data.data() + f * 40, coefs, 64);
+           Consume(out.back());
+         }),
+         samples, "samples");
+  Report("N64 decode", TimeNs([&]() {
+           for (size_t f = 0; f < frameCount; ++f)
+             N64MusyXDecompressFrame(out.data() + f * 64, data.data() + f * 40, coefs, 64);
+           Consume(out.back());
+         }),
+         samples, "samples");
+}
+
+static void BenchDSPEncode() {
+  const size_t sampleCount = Scaled(32000 * 10);
+  Rng rng(16);
+  std::vector<float> tone = TestTone(sampleCount, rng);
+  std::vector<int16_t> pcm(sampleCount);
+  for (size_t i = 0; i < sampleCount; ++i)
+    pcm[i] = int16_t(tone[i] * 24000.f);
+  std::vector<uint8_t> adpcm((sampleCount + 13) / 14 * 8);
+
+  short coefs[8][2];
+  Report("DSP correlate coefficients", TimeNs([&]() { DSPCorrelateCoefs(pcm.data(), int(sampleCount), coefs); }, 3),
+         double(sampleCount), "samples");
+  Report("DSP encode (scalar reference)", TimeNs([&]() {
+           EncodeDSPStream(DSPEncodeFrameReference, pcm.data(), sampleCount, coefs, adpcm.data());
+           Consume(adpcm.back());
+         }, 3),
+         double(sampleCount), "samples");
+  Report("DSP encode", TimeNs([&]() {
+           EncodeDSPStream(DSPEncodeFrame, pcm.data(), sampleCount, coefs, adpcm.data());
+           Consume(adpcm.back());
+         }, 3),
+         double(sampleCount), "samples");
+}
+
+/* Gain stage of Voice::_procSamplesPre for a bank of voices, one 5ms block each per pass.
+ * Levels glide linearly across each block through the decibel table, as BlockLinearized
+ * mode does; envelope and controller evaluation need a live Voice and are not included. */
+static void BenchVoiceGain() {
+  constexpr size_t VoiceCount = 64;
+  constexpr size_t BlockSamples = 160;
+  const size_t passes = Scaled(2000);
+  Rng rng(20);
+  std::vector<int16_t> source(VoiceCount * BlockSamples);
+  for (int16_t& samp : source)
+    samp = int16_t(rng.range(-32768, 32767));
+  std::vector<float> levels(VoiceCount + 1);
+  for (float& level : levels)
+    level = rng.below(1000) / 1000.f;
+  std::vector<int16_t> data(source.size());
+  const double samples = double(passes) * VoiceCount * BlockSamples;
+
+  auto levelAt = [&](size_t v, size_t i) {
+    const float t = i / float(BlockSamples);
+    return levels[v] * (1.f - t) + levels[v + 1] * t;
+  };
+
+  const double perSample = TimeNs([&]() {
+    for (size_t p = 0; p < passes; ++p) {
+      data = source;
+      for (size_t v = 0; v < VoiceCount; ++v) {
+        int16_t* block = data.data() + v * BlockSamples;
+        for (size_t i = 0; i < BlockSamples; ++i)
+          block[i] = int16_t(std::clamp(float(block[i]) * LookupVolume(levelAt(v, i)), -32768.f, 32767.f));
+      }
+    }
+    Consume(data.back());
+  });
+  const double block = TimeNs([&]() {
+    float gains[BlockSamples];
+    for (size_t p = 0; p < passes; ++p) {
+      data = source;
+      for (size_t v = 0; v < VoiceCount; ++v) {
+        for (size_t i = 0; i < BlockSamples; ++i)
+          gains[i] = LookupVolume(levelAt(v, i));
+        ApplyGains(data.data() + v * BlockSamples, gains, BlockSamples);
+      }
+    }
+    Consume(data.back());
+  });
+  const double applyOnly = TimeNs([&]() {
+    std::vector<float> gains(BlockSamples, 0.7f);
+    for (size_t p = 0; p < passes; ++p) {
+      data = source;
+      for (size_t v = 0; v < VoiceCount; ++v)
+        ApplyGains(data.data() + v * BlockSamples, gains.data(), BlockSamples);
+    }
+    Consume(data.back());
+  });
+
+  auto report = [&](const char* name, double ns) {
+    Report(name, ns, samples, "samples");
+    std::printf("%-40s %10.1f ns per voice block\n", "", ns / (double(passes) * VoiceCount));
+  };
+  report("voice gain per sample (reference)", perSample);
+  report("voice gain block stage", block);
+  report("ApplyGains only", applyOnly);
+}
+
+/* Float reverbs over 5ms blocks at 48kHz, against the per-channel scalar model */
+static void BenchReverb() {
+  constexpr double SampleRate = 48000.0;
+  constexpr size_t BlockFrames = 240;
+  const size_t frameCount = Scaled(size_t(SampleRate) * 4) / BlockFrames * BlockFrames + BlockFrames;
+  Rng rng(21);
+  const std::vector<float> tone = TestTone(frameCount, rng, SampleRate);
+
+  for (bool hi : {false, true}) {
+    for (unsigned chanCount : {2u, 6u, 8u}) {
+      std::vector<float> source(frameCount * chanCount);
+      for (size_t i = 0; i < source.size(); ++i)
+        source[i] = tone[i / chanCount] * 20000.f;
+      std::vector<float> audio(source.size());
+      ChannelMap chanMap{};
+      chanMap.m_channelCount = chanCount;
+
+      char name[64];
+      std::snprintf(name, sizeof(name), "reverb %s %u ch (scalar reference)", hi ? "hi" : "std", chanCount);
+      Report(name, TimeNs([&]() {
+               audio = source;
+               RefReverb<float>(hi, 0.6f, 0.7f, 2.5f, 0.4f, 0.02f, 0.5f, SampleRate, chanCount)
+                   .process(audio.data(), frameCount);
+               Consume(int64_t(audio.back()));
+             }, 3),
+             double(frameCount), "frames");
+
+      std::snprintf(name, sizeof(name), "reverb %s %u ch", hi ? "hi" : "std", chanCount);
+      Report(name, TimeNs([&]() {
+               audio = source;
+               std::unique_ptr<EffectBase<float>> fx;
+               if (hi)
+                 fx = std::make_unique<EffectReverbHiImp<float>>(0.6f, 0.7f, 2.5f, 0.4f, 0.02f, 0.5f, SampleRate);
+               else
+                 fx = std::make_unique<EffectReverbStdImp<float>>(0.6f, 0.7f, 2.5f, 0.4f, 0.02f, SampleRate);
+               for (size_t f = 0; f < frameCount; f += BlockFrames)
+                 fx->applyEffect(audio.data() + f * chanCount, BlockFrames, chanMap);
+               Consume(int64_t(audio.back()));
+             }, 3),
+             double(frameCount), "frames");
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1)
+    Scale = std::max(0.0, std::atof(argv[1]));
+
+  BenchDSPDecode();
+  BenchN64Decode();
+  BenchDSPEncode();
+  BenchVoiceGain();
+  BenchReverb();
+  return 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "amuse/DSPCodec.hpp"
+#include "amuse/N64MusyXCodec.hpp"
+
+namespace amuse::test {
+
+/* Plain one-sample-at-a-time decoders written straight from the formats. The library's
+ * vectorized decoders must match them bit for bit. */
+
+/** Decode DSP-ADPCM samples [firstSample, min(14, lastSample)) to `out`, `stride` samples apart.
+ *  The predictor starts from the passed history at `firstSample`, like the Ranged decoders. */
+inline unsigned RefDSPDecodeFrame(int16_t* out, unsigned stride, const uint8_t* in, const int16_t coefs[8][2],
+                                  int16_t* prev1, int16_t* prev2, unsigned firstSample, unsigned lastSample) {
+  const int32_t factor1 = coefs[(in[0] >> 4) & 0xf][0];
+  const int32_t factor2 = coefs[(in[0] >> 4) & 0xf][1];
+  const int32_t exp = in[0] & 0xf;
+  int32_t hist1 = *prev1;
+  int32_t hist2 = *prev2;
+  unsigned ret = 0;
+  for (unsigned s = firstSample; s < 14 && s < lastSample; ++s) {
+    const uint8_t byte = in[s / 2 + 1];
+    const int32_t nibble = (s & 1) ? (byte & 0xf) : (byte >> 4);
+    const int32_t residual = (nibble >= 8 ? nibble - 16 : nibble) * (int32_t(1) << (exp + 11)) + 1024;
+    const int16_t sample = DSPSampClamp((residual + factor1 * hist1 + factor2 * hist2) >> 11);
+    if (out)
+      out[ret * stride] = sample;
+    hist2 = hist1;
+    hist1 = sample;
+    ++ret;
+  }
+  *prev1 = hist1;
+  *prev2 = hist2;
+  return ret;
+}
+
+/** Decode up to `lastSample` of the 64 samples in a 40-byte N64 MusyX frame */
+inline unsigned RefN64DecodeFrame(int16_t* out, const uint8_t* in, const int16_t coefs[8][2][8],
+                                  unsigned lastSample) {
+  /* Predicted samples restart from the last two outputs at each of these group boundaries */
+  static const unsigned GroupStart[] = {2, 8, 16, 24, 32};
+  unsigned samples = 0;
+  for (unsigned half = 0; half < 2; ++half) {
+    const uint8_t* header = in + half * 4;
+    const uint8_t* nibbles = in + (half ? 0x18 : 0x8);
+    const uint8_t c2 = nibbles[0] % 0x80;
+    const int16_t* book1 = coefs[c2 >> 4][0];
+    const int16_t* book2 = coefs[c2 >> 4][1];
+    const unsigned rshift = c2 & 0xf;
+
+    int16_t frame[32];
+    frame[0] = int16_t((header[0] << 8) | header[1]);
+    frame[1] = int16_t((header[2] << 8) | header[3]);
+    for (unsigned i = 1; i < 16; ++i) {
+      frame[i * 2] = int16_t(int16_t((nibbles[i] & 0xf0) << 8) >> rshift);
+      frame[i * 2 + 1] = int16_t(int16_t((nibbles[i] & 0x0f) << 12) >> rshift);
+    }
+
+    int16_t* dst = out + half * 32;
+    for (unsigned s = 0; s < 2; ++s) {
+      if (samples == lastSample)
+        return samples;
+      dst[s] = frame[s];
+      ++samples;
+    }
+    for (unsigned g = 0; g < 4; ++g) {
+      const unsigned start = GroupStart[g];
+      const int32_t l1 = dst[start - 2];
+      const int32_t l2 = dst[start - 1];
+      for (unsigned i = 0; i < GroupStart[g + 1] - start; ++i) {
+        if (samples == lastSample)
+          return samples;
+        int32_t accu = int32_t(frame[start + i]) * 2048 + book1[i] * l1 + book2[i] * l2;
+        for (unsigned k = 0; k < i; ++k)
+          accu += book2[k] * frame[start + i - 1 - k];
+        dst[start + i] = N64MusyXSampClamp(accu >> 11);
+        ++samples;
+      }
+    }
+  }
+  return samples;
+}
+
+using DSPEncodeFunc = void (*)(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8],
+                              const short coefsIn[8][2]);
+
+/** Encode a whole sample frame by frame the way the sample directory exporter does, carrying the
+ *  encoder's reconstruction forward as history. Writes 8 bytes per 14 samples. */
+inline void EncodeDSPStream(DSPEncodeFunc encode, const int16_t* pcm, size_t samples, const int16_t coefs[8][2],
+                            uint8_t* adpcmOut) {
+  short convSamps[16] = {};
+  for (size_t cur = 0; cur < samples; cur += 14, adpcmOut += 8) {
+    const int sampleCount = int(std::min(size_t(14), samples - cur));
+    convSamps[0] = convSamps[14];
+    convSamps[1] = convSamps[15];
+    std::memcpy(convSamps + 2, pcm + cur, sampleCount * sizeof(short));
+    encode(convSamps, sampleCount, adpcmOut, coefs);
+  }
+}
+
+} // namespace amuse::test
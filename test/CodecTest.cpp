@@ -0,0 +1,141 @@
+#include <cstring>
+
+#include "CodecReference.hpp"
+#include "TestUtil.hpp"
+
+using namespace amuse::test;
+
+/* Random frames, predictor tables and histories through every decoder entry point, compared
+ * bit for bit against the scalar reference at every frame length */
+
+static void RandomDSPCoefs(Rng& rng, int16_t coefs[8][2]) {
+  for (unsigned i = 0; i < 8; ++i) {
+    coefs[i][0] = int16_t(rng.range(-4096, 4095));
+    coefs[i][1] = int16_t(rng.range(-4096, 4095));
+  }
+}
+
+static void RandomDSPFrame(Rng& rng, uint8_t frame[8]) {
+  /* Predictor index must address one of the 8 coefficient pairs; any scale is decodable */
+  frame[0] = uint8_t((rng.below(8) << 4) | rng.below(16));
+  for (unsigned i = 1; i < 8; ++i)
+    frame[i] = uint8_t(rng.below(256));
+}
+
+static void TestDSPDecode() {
+  Rng rng(6);
+  int16_t coefs[8][2];
+  uint8_t frame[8];
+  for (unsigned iter = 0; iter < 20000; ++iter) {
+    RandomDSPCoefs(rng, coefs);
+    RandomDSPFrame(rng, frame);
+    const int16_t hist1 = int16_t(rng.range(-32768, 32767));
+    const int16_t hist2 = int16_t(rng.range(-32768, 32767));
+    const unsigned last = rng.below(16);
+    const unsigned first = rng.below(15);
+
+    int16_t ref[28] = {};
+    int16_t refP1 = hist1, refP2 = hist2;
+    const unsigned refCount = RefDSPDecodeFrame(ref, 1, frame, coefs, &refP1, &refP2, 0, last);
+
+    auto expectFrame = [&](const char* name, unsigned count, int16_t p1, int16_t p2, const int16_t* out,
+                           unsigned stride, unsigned copies, const int16_t* expect, unsigned expectCount,
+                           int16_t expectP1, int16_t expectP2) {
+      Check(count == expectCount, "%s: iteration %u returned %u samples, expected %u", name, iter, count,
+            expectCount);
+      Check(p1 == expectP1 && p2 == expectP2, "%s: iteration %u history (%d, %d), expected (%d, %d)", name, iter,
+            p1, p2, expectP1, expectP2);
+      if (!out)
+        return;
+      for (unsigned s = 0; s < expectCount; ++s)
+        for (unsigned c = 0; c < copies; ++c)
+          if (!Check(out[s * stride + c] == expect[s], "%s: iteration %u sample %u is %d, expected %d", name, iter,
+                     s, out[s * stride + c], expect[s]))
+            return;
+    };
+
+    {
+      int16_t out[28] = {};
+      int16_t p1 = hist1, p2 = hist2;
+      const unsigned count = DSPDecompressFrame(out, frame, coefs, &p1, &p2, last);
+      expectFrame("DSPDecompressFrame", count, p1, p2, out, 1, 1, ref, refCount, refP1, refP2);
+    }
+    {
+      int16_t out[28] = {};
+      int16_t p1 = hist1, p2 = hist2;
+      const unsigned count = DSPDecompressFrameStereoStride(out, frame, coefs, &p1, &p2, last);
+      expectFrame("DSPDecompressFrameStereoStride", count, p1, p2, out, 2, 1, ref, refCount, refP1, refP2);
+    }
+    {
+      int16_t out[28] = {};
+      int16_t p1 = hist1, p2 = hist2;
+      const unsigned count = DSPDecompressFrameStereoDupe(out, frame, coefs, &p1, &p2, last);
+      expectFrame("DSPDecompressFrameStereoDupe", count, p1, p2, out, 2, 2, ref, refCount, refP1, refP2);
+    }
+    {
+      int16_t p1 = hist1, p2 = hist2;
+      const unsigned count = DSPDecompressFrameStateOnly(frame, coefs, &p1, &p2, last);
+      expectFrame("DSPDecompressFrameStateOnly", count, p1, p2, nullptr, 1, 1, ref, refCount, refP1, refP2);
+    }
+
+    int16_t rangedRef[14] = {};
+    int16_t rangedP1 = hist1, rangedP2 = hist2;
+    const unsigned rangedCount = RefDSPDecodeFrame(rangedRef, 1, frame, coefs, &rangedP1, &rangedP2, first, last);
+    {
+      int16_t out[14] = {};
+      int16_t p1 = hist1, p2 = hist2;
+      const unsigned count = DSPDecompressFrameRanged(out, frame, coefs, &p1, &p2, first, last);
+      expectFrame("DSPDecompressFrameRanged", count, p1, p2, out, 1, 1, rangedRef, rangedCount, rangedP1, rangedP2);
+    }
+    {
+      int16_t p1 = hist1, p2 = hist2;
+      const unsigned count = DSPDecompressFrameRangedStateOnly(frame, coefs, &p1, &p2, first, last);
+      expectFrame("DSPDecompressFrameRangedStateOnly", count, p1, p2, nullptr, 1, 1, rangedRef, rangedCount,
+                  rangedP1, rangedP2);
+    }
+  }
+}
+
+static void TestN64Decode() {
+  Rng rng(64);
+  int16_t coefs[8][2][8];
+  uint8_t frame[40];
+  for (unsigned iter = 0; iter < 20000; ++iter) {
+    for (auto& book : coefs)
+      for (auto& row : book)
+        for (int16_t& c : row)
+          c = int16_t(rng.range(-4096, 4095));
+    for (uint8_t& b : frame)
+      b = uint8_t(rng.below(256));
+    const unsigned last = rng.below(66);
+
+    int16_t ref[64] = {};
+    const unsigned refCount = RefN64DecodeFrame(ref, frame, coefs, last);
+    int16_t out[64] = {};
+    const unsigned count = N64MusyXDecompressFrame(out, frame, coefs, last);
+    Check(count == refCount, "N64MusyXDecompressFrame: iteration %u returned %u samples, expected %u", iter, count,
+          refCount);
+    for (unsigned s = 0; s < refCount; ++s)
+      if (!Check(out[s] == ref[s], "N64MusyXDecompressFrame: iteration %u sample %u is %d, expected %d", iter, s,
+                 out[s], ref[s]))
+        break;
+
+    /* Ranged decoding drops the first samples of a full decode */
+    const unsigned first = rng.below(64);
+    const unsigned ranged = rng.below(65 - first);
+    int16_t full[64] = {};
+    const unsigned fullCount = RefN64DecodeFrame(full, frame, coefs, first + ranged);
+    int16_t rangedOut[64] = {};
+    const unsigned rangedCount = N64MusyXDecompressFrameRanged(rangedOut, frame, coefs, first, ranged);
+    Check(rangedCount == fullCount - first, "N64MusyXDecompressFrameRanged: iteration %u returned %u samples", iter,
+          rangedCount);
+    Check(std::memcmp(rangedOut, full + first, (fullCount - first) * sizeof(int16_t)) == 0,
+          "N64MusyXDecompressFrameRanged: iteration %u samples differ", iter);
+  }
+}
+
+int main() {
+  TestDSPDecode();
+  TestN64Decode();
+  return Finish("amuse-codec-test");
+}
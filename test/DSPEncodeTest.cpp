@@ -0,0 +1,107 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "CodecReference.hpp"
+#include "TestUtil.hpp"
+
+using namespace amuse::test;
+
+/* DSPEncodeFrame must pick the same predictor, scale and nibbles as DSPEncodeFrameReference,
+ * and a correlated, encoded and decoded tone must come back close to the source. */
+
+static void FillFrame(Rng& rng, unsigned kind, short pcm[16]) {
+  switch (kind) {
+  case 0: /* Full-scale noise */
+    for (unsigned i = 0; i < 16; ++i)
+      pcm[i] = short(rng.range(-32768, 32767));
+    break;
+  case 1: /* Quiet noise, exercising the small scales */
+    for (unsigned i = 0; i < 16; ++i)
+      pcm[i] = short(rng.range(-40, 40));
+    break;
+  case 2: /* Rail-to-rail swings that saturate the predictor */
+    for (unsigned i = 0; i < 16; ++i)
+      pcm[i] = rng.below(2) ? short(32767) : short(-32768);
+    break;
+  default: { /* A sinusoid at a random pitch, level and phase */
+    const double w = 0.01 + 0.5 * (rng.below(1000) / 1000.0);
+    const double amp = 100.0 + rng.below(32000);
+    const double phase = rng.below(628) / 100.0;
+    for (unsigned i = 0; i < 16; ++i)
+      pcm[i] = short(amp * std::sin(w * i + phase));
+    break;
+  }
+  }
+}
+
+static void TestMatchesReference() {
+  Rng rng(16);
+  short coefs[8][2];
+  for (unsigned iter = 0; iter < 50000; ++iter) {
+    /* Mostly typical predictors, sometimes up to the +/-2.0 a stable two-pole filter can need */
+    const int coefRange = rng.below(4) ? 4096 : 8192;
+    for (auto& pair : coefs) {
+      pair[0] = short(rng.range(-coefRange, coefRange - 1));
+      pair[1] = short(rng.range(-coefRange, coefRange - 1));
+    }
+    const unsigned kind = rng.below(4);
+    const int sampleCount = int(rng.range(1, 14));
+
+    short refPcm[16], pcm[16];
+    FillFrame(rng, kind, refPcm);
+    std::memcpy(pcm, refPcm, sizeof(pcm));
+    unsigned char refOut[8] = {}, out[8] = {};
+    DSPEncodeFrameReference(refPcm, sampleCount, refOut, coefs);
+    DSPEncodeFrame(pcm, sampleCount, out, coefs);
+
+    Check(std::memcmp(refOut, out, sizeof(out)) == 0, "iteration %u (kind %u, %d samples): ADPCM bytes differ", iter,
+          kind, sampleCount);
+    Check(std::memcmp(refPcm, pcm, sizeof(pcm)) == 0,
+          "iteration %u (kind %u, %d samples): reconstructed samples differ", iter, kind, sampleCount);
+  }
+}
+
+static void TestRoundTrip() {
+  Rng rng(1600);
+  const size_t sampleCount = 32000 * 4 + 5;
+  std::vector<float> tone = TestTone(sampleCount, rng);
+  std::vector<int16_t> pcm(sampleCount);
+  for (size_t i = 0; i < sampleCount; ++i)
+    pcm[i] = int16_t(tone[i] * 24000.f);
+
+  short coefs[8][2];
+  DSPCorrelateCoefs(pcm.data(), int(sampleCount), coefs);
+
+  /* Correlation splits long samples into ranges; the result must not depend on how they are scheduled */
+  short coefsAgain[8][2];
+  DSPCorrelateCoefs(pcm.data(), int(sampleCount), coefsAgain);
+  Check(std::memcmp(coefs, coefsAgain, sizeof(coefs)) == 0, "DSPCorrelateCoefs is not deterministic");
+
+  const size_t frameCount = (sampleCount + 13) / 14;
+  std::vector<uint8_t> adpcm(frameCount * 8), refAdpcm(frameCount * 8);
+  EncodeDSPStream(DSPEncodeFrame, pcm.data(), sampleCount, coefs, adpcm.data());
+  EncodeDSPStream(DSPEncodeFrameReference, pcm.data(), sampleCount, coefs, refAdpcm.data());
+  Check(adpcm == refAdpcm, "encoded stream differs from the reference encoder");
+
+  std::vector<int16_t> decoded(frameCount * 14);
+  int16_t hist1 = 0, hist2 = 0;
+  for (size_t f = 0; f < frameCount; ++f)
+    DSPDecompressFrame(decoded.data() + f * 14, adpcm.data() + f * 8, coefs, &hist1, &hist2, 14);
+
+  double signal = 0.0, noise = 0.0;
+  for (size_t i = 0; i < sampleCount; ++i) {
+    const double err = double(decoded[i]) - pcm[i];
+    signal += double(pcm[i]) * pcm[i];
+    noise += err * err;
+  }
+  const double snr = 10.0 * std::log10(signal / std::max(noise, 1.0));
+  std::printf("round-trip SNR %.1f dB\n", snr);
+  Check(snr > 30.0, "round-trip SNR %.1f dB is below 30 dB", snr);
+}
+
+int main() {
+  TestMatchesReference();
+  TestRoundTrip();
+  return Finish("amuse-dsp-encode-test");
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "amuse/Common.hpp"
+#include "amuse/IBackendVoice.hpp"
+
+namespace amuse::test {
+
+/** Scalar model of EffectReverbStd/EffectReverbHi with fixed parameters, running each channel's
+ *  network one sample at a time the way the effects did before their channels moved into SIMD lanes */
+template <typename T>
+class RefReverb {
+  static constexpr std::array<size_t, 3> CTapDelays{1789, 1999, 2333};
+  static constexpr std::array<size_t, 2> APTapDelays{433, 149};
+  static constexpr std::array<size_t, 8> LPTapDelays{47, 73, 67, 57, 43, 57, 83, 73};
+
+  /** Ring returning the value written `delay` samples before the current one */
+  struct Line {
+    std::vector<float> m_buf;
+    size_t m_pos = 0;
+    size_t m_delay = 0;
+
+    void init(size_t delay) {
+      m_buf.assign(delay + 1, 0.f);
+      m_pos = 0;
+      m_delay = delay;
+    }
+
+    float tap(float in) {
+      m_buf[m_pos] = in;
+      const float out = m_buf[(m_pos + m_buf.size() - m_delay) % m_buf.size()];
+      m_pos = (m_pos + 1) % m_buf.size();
+      return out;
+    }
+  };
+
+  struct Channel {
+    Line m_preDelay;
+    std::array<Line, 3> m_comb;
+    std::array<Line, 2> m_allPass;
+    Line m_lowPass;
+    std::array<float, 3> m_lastComb{};
+    std::array<float, 2> m_lastAllPass{};
+    float m_lastLowPass = 0.f;
+    float m_lpLastOut = 0.f;
+  };
+
+  bool m_hi;
+  unsigned m_chanCount;
+  std::array<Channel, NumChannels> m_chans;
+  std::array<float, 3> m_combCoef{};
+  float m_allPassCoef;
+  float m_damping;
+  float m_wet;
+  float m_dry;
+  float m_crosstalk;
+
+public:
+  RefReverb(bool hi, float coloration, float mix, float time, float damping, float preDelay, float crosstalk,
+            double sampleRate, unsigned chanCount)
+  : m_hi(hi), m_chanCount(chanCount) {
+    coloration = std::clamp(coloration, 0.f, 1.f);
+    mix = std::clamp(mix, 0.f, 1.f);
+    time = std::clamp(time, 0.01f, 10.f);
+    damping = std::clamp(damping, 0.f, 1.f);
+    preDelay = std::clamp(preDelay, 0.f, 0.1f);
+
+    const float timeSamples = time * sampleRate;
+    const double rateRatio = sampleRate / NativeSampleRate;
+    const int32_t preDelayTime = preDelay != 0.f ? int32_t(sampleRate * preDelay) : 0;
+    for (size_t c = 0; c < NumChannels; ++c) {
+      Channel& chan = m_chans[c];
+      chan.m_preDelay.init(preDelayTime != 0 ? preDelayTime - 1 : 0);
+      for (size_t t = 0; t < 3; ++t)
+        chan.m_comb[t].init(size_t(CTapDelays[t] * rateRatio));
+      for (size_t t = 0; t < 2; ++t)
+        chan.m_allPass[t].init(size_t(APTapDelays[t] * rateRatio));
+      chan.m_lowPass.init(size_t(LPTapDelays[c] * rateRatio));
+    }
+    for (size_t t = 0; t < 3; ++t) {
+      const size_t tapDelay = CTapDelays[t] * rateRatio;
+      m_combCoef[t] = std::pow(10.f, tapDelay * -3.f / timeSamples);
+    }
+
+    m_allPassCoef = coloration;
+    m_damping = std::max(damping, 0.05f);
+    m_damping = 1.f - (m_damping * 0.8f + 0.05);
+    m_wet = mix * 0.6f;
+    m_dry = 0.6f - m_wet;
+    m_crosstalk = hi ? std::clamp(crosstalk, 0.f, 1.f) : 0.f;
+  }
+
+  /** Process interleaved frames in place */
+  void process(T* audio, size_t frameCount) {
+    std::array<float, NumChannels> frame{};
+    for (size_t f = 0; f < frameCount; ++f, audio += m_chanCount) {
+      for (unsigned c = 0; c < m_chanCount; ++c)
+        frame[c] = audio[c];
+
+      if (m_crosstalk != 0.f) {
+        const float wet = m_crosstalk * 0.5;
+        const float dry = 1.f - wet;
+        float allWet = 0.f;
+        for (unsigned c = 0; c < m_chanCount; ++c) {
+          allWet += frame[c] * wet;
+          frame[c] = T(frame[c] * dry);
+        }
+        for (unsigned c = 0; c < m_chanCount; ++c)
+          frame[c] = ClampFull<T>(frame[c] + allWet);
+      }
+
+      for (unsigned c = 0; c < m_chanCount; ++c)
+        audio[c] = ClampFull<T>(m_hi ? _hiSample(m_chans[c], frame[c]) : _stdSample(m_chans[c], frame[c]));
+    }
+  }
+
+private:
+  float _stdSample(Channel& chan, float sample) {
+    const float sample2 = chan.m_preDelay.tap(sample);
+    auto& lastC = chan.m_lastComb;
+    auto& lastAP = chan.m_lastAllPass;
+    lastC[0] = chan.m_comb[0].tap(m_combCoef[0] * lastC[0] + sample2);
+    lastC[1] = chan.m_comb[1].tap(m_combCoef[1] * lastC[1] + sample2);
+
+    const float inAP0 = m_allPassCoef * lastAP[0] + lastC[0] + lastC[1];
+    const float lowPass = lastAP[0] - m_allPassCoef * inAP0;
+    lastAP[0] = chan.m_allPass[0].tap(inAP0);
+
+    chan.m_lpLastOut = m_damping * chan.m_lpLastOut + lowPass * 0.3f;
+    const float inAP1 = m_allPassCoef * lastAP[1] + chan.m_lpLastOut;
+    const float allPass = lastAP[1] - m_allPassCoef * inAP1;
+    lastAP[1] = chan.m_allPass[1].tap(inAP1);
+
+    return m_wet * allPass + m_dry * sample;
+  }
+
+  float _hiSample(Channel& chan, float sample) {
+    const float sample2 = chan.m_preDelay.tap(sample);
+    auto& lastC = chan.m_lastComb;
+    auto& lastAP = chan.m_lastAllPass;
+    lastC[0] = chan.m_comb[0].tap(m_combCoef[0] * lastC[0] + sample2);
+    lastC[1] = chan.m_comb[1].tap(m_combCoef[1] * lastC[1] + sample2);
+    lastC[2] = chan.m_comb[2].tap(m_combCoef[2] * lastC[2] + sample2);
+
+    const float inAP0 = m_allPassCoef * lastAP[0] + lastC[0] + lastC[1] + lastC[2];
+    const float inAP1 = m_allPassCoef * lastAP[1] - (m_allPassCoef * inAP0 - lastAP[0]);
+    const float lowPass = lastAP[1] - m_allPassCoef * inAP1;
+    lastAP[0] = chan.m_allPass[0].tap(inAP0);
+    lastAP[1] = chan.m_allPass[1].tap(inAP1);
+
+    chan.m_lpLastOut = m_damping * chan.m_lpLastOut + lowPass * 0.3f;
+    const float inLP = m_allPassCoef * chan.m_lastLowPass + chan.m_lpLastOut;
+    const float allPass = chan.m_lastLowPass - m_allPassCoef * inLP;
+    chan.m_lastLowPass = chan.m_lowPass.tap(inLP);
+
+    return m_wet * allPass + m_dry * sample;
+  }
+};
+
+} // namespace amuse::test
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace amuse::test {
+
+/** Deterministic xorshift generator so every run checks the same inputs */
+struct Rng {
+  uint64_t m_state;
+
+  explicit Rng(uint64_t seed = 0x9E3779B97F4A7C15ull) : m_state(seed ? seed : 1) {}
+
+  uint64_t next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 7;
+    m_state ^= m_state << 17;
+    return m_state;
+  }
+
+  /** Uniform value in [0, bound) */
+  uint32_t below(uint32_t bound) { return uint32_t(next() % bound); }
+
+  /** Uniform value in [lo, hi] */
+  int32_t range(int32_t lo, int32_t hi) { return lo + int32_t(next() % uint64_t(int64_t(hi) - lo + 1)); }
+
+  /** Uniform float in [-1, 1) */
+  float unit() { return float(next() >> 40) / float(1 << 23) - 1.f; }
+};
+
+/** Two partials under a slow swell plus a little noise; music-like material in [-1, 1] */
+inline std::vector<float> TestTone(size_t frames, Rng& rng, double sampleRate = 32000.0) {
+  std::vector<float> ret(frames);
+  const double w1 = 2.0 * M_PI * 220.0 / sampleRate;
+  const double w2 = 2.0 * M_PI * 331.0 / sampleRate;
+  const double swell = 2.0 * M_PI * 0.5 / sampleRate;
+  for (size_t i = 0; i < frames; ++i) {
+    const double env = 0.55 + 0.35 * std::sin(swell * i);
+    ret[i] = float(env * (0.6 * std::sin(w1 * i) + 0.3 * std::sin(w2 * i)) + 0.02 * rng.unit());
+  }
+  return ret;
+}
+
+/** Count of failed checks; tests return non-zero from main when it is set */
+inline unsigned Failures = 0;
+
+/** Record a failed check with a printf-style message. Only the first few failures of a run are printed. */
+inline bool Check(bool cond, const char* fmt, ...) {
+  if (cond)
+    return true;
+  if (Failures++ < 16) {
+    std::va_list args;
+    va_start(args, fmt);
+    std::fputs("FAIL: ", stderr);
+    std::vfprintf(stderr, fmt, args);
+    std::fputc('\n', stderr);
+    va_end(args);
+  }
+  return false;
+}
+
+/** Report the run and produce the process exit code */
+inline int Finish(const char* name) {
+  if (Failures) {
+    std::fprintf(stderr, "%s: %u check(s) failed\n", name, Failures);
+    return 1;
+  }
+  std::printf("%s: all checks passed\n", name);
+  return 0;
+}
+
+/** Best-of-`runs` wall time in nanoseconds of calling `func` */
+template <typename F>
+double TimeNs(F&& func, unsigned runs = 5) {
+  double best = 0.0;
+  for (unsigned r = 0; r < runs; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (r == 0 || ns < best)
+      best = ns;
+  }
+  return best;
+}
+
+/** Keep a benchmark result observable so the work producing it is not optimized away */
+inline volatile int64_t BenchSink = 0;
+inline void Consume(int64_t value) { BenchSink = value; }
+
+} // namespace amuse::test